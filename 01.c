@@ -7,8 +7,15 @@
  */
 #include <errno.h>
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
 
 struct Node {
 	uint_fast16_t value;
@@ -17,27 +24,16 @@ struct Node {
 
 typedef struct Node Node;
 
-static Node *head = NULL;
-
-static void
-freelist(void)
-{
-	while (head != NULL) {
-		Node * const next = head->next;
-		free(head);
-		head = next;
-	}
-}
-
 int
-day01(FILE * const in)
+day01(Input * const in, AdventResult * const out)
 {
-	if (atexit(freelist) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
-	Node *tail = NULL;
-	uint_fast16_t input;
-	while (fscanf(in, "%" SCNuFAST16 "\n", &input) == 1) {
-		Node * const node = malloc(sizeof(Node));
+	Arena * const arena = scratch(out);
+	Node *head = NULL, *tail = NULL;
+	uintmax_t input;
+	inspace(in);
+	while (inuint(in, &input) && input <= UINT_FAST16_MAX) {
+		inspace(in);
+		Node * const node = aralloc(arena, sizeof(Node));
 		if (node == NULL) {
 			if (errno != 0)
 				perror("Could not parse puzzle input");
@@ -53,7 +49,7 @@ day01(FILE * const in)
 			head = node;
 		tail = node;
 	}
-	if (!feof(in)) {
+	if (!ineof(in)) {
 		fputs("Bad input format\n", stderr);
 		return EXIT_FAILURE;
 	}
@@ -61,24 +57,87 @@ day01(FILE * const in)
 		fputs("Linked list is empty\n", stderr);
 		return EXIT_FAILURE;
 	}
+	parsed(out);
 	for (const Node *i = head; i->next != NULL; i = i->next) {
 		for (const Node *j = i->next; j != NULL; j = j->next) {
 			if (i->value + j->value == 2020) {
-				printf("2\t%" PRIuFAST32 "\n",
-				       ((uint_fast32_t) i->value)
-				       * ((uint_fast32_t) j->value));
+				answeruint(out,
+				           0,
+				           "2",
+				           (uint_fast32_t) i->value
+				           * (uint_fast32_t) j->value);
 			}
 			if (j->next == NULL)
 				continue;
 			for (const Node *k = j->next; k != NULL; k = k->next) {
 				if (i->value + j->value + k->value != 2020)
 					continue;
-				printf("3\t%" PRIuFAST64 "\n",
-				       (uint_fast64_t) i->value
-				       * (uint_fast64_t) j->value
-				       * (uint_fast64_t) k->value);
+				answeruint(out,
+				           1,
+				           "3",
+				           (uint_fast64_t) i->value
+				           * (uint_fast64_t) j->value
+				           * (uint_fast64_t) k->value);
 			}
 		}
 	}
 	return EXIT_SUCCESS;
 }
+
+/* Sum the entries must add up to */
+#define TARGET 2020
+
+/*
+ * Counts how many times each value up to TARGET appears, then looks up the
+ * value completing each pair of distinct values in increasing order. Lookups
+ * never need more than 3 of a value, so counts stop there rather than wrap.
+ */
+static int
+fast(Input * const in, AdventResult * const out)
+{
+	uint_fast16_t count[TARGET + 1] = { 0 }, value[TARGET + 1];
+	size_t n = 0, nvalues = 0;
+	uintmax_t input;
+	inspace(in);
+	while (inuint(in, &input) && input <= UINT_FAST16_MAX) {
+		inspace(in);
+		if (input <= TARGET && count[input] < 3
+		    && count[input]++ == 0)
+			nvalues++;
+		n++;
+	}
+	if (!ineof(in)) {
+		fputs("Bad input format\n", stderr);
+		return EXIT_FAILURE;
+	}
+	if (n == 0) {
+		fputs("Linked list is empty\n", stderr);
+		return EXIT_FAILURE;
+	}
+	parsed(out);
+	for (uint_fast16_t v = 0, i = 0; i < nvalues; v++) {
+		if (count[v] > 0)
+			value[i++] = v;
+	}
+	for (size_t i = 0; i < nvalues; i++) {
+		const uint_fast16_t a = value[i], b = TARGET - a;
+		if (a <= b && count[b] > (a == b))
+			answeruint(out, 0, "2", (uint_fast32_t) a * b);
+		for (size_t j = i; j < nvalues && 2 * value[j] <= b; j++) {
+			const uint_fast16_t c = value[j], d = b - c;
+			/* Since a <= c <= d, equal values share count[c] */
+			if (count[c] >= 1u + (a == c) + (c == d) && count[d] > 0)
+				answeruint(out,
+				           1,
+				           "3",
+				           (uint_fast64_t) a * c * d);
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+const Engine engines01[] = {
+	{ .name = "reference", .solve = day01 },
+	{ .name = "fast", .solve = fast },
+	{ .name = NULL }
+};
@@ -9,33 +9,75 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-int
-day02(FILE * const in)
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+
+typedef struct {
+	uintmax_t numbers, positions;
+} Policies;
+
+static bool
+fold(void * const state, Input * const in)
 {
-	size_t low, high;
-	char c, *pass;
-	uintmax_t numbers = 0, positions = 0;
-	while (fscanf(in, "%zu-%zu %c: %m[a-z]", &low, &high, &c, &pass) == 4) {
+	Policies * const pol = state;
+	uintmax_t low, high;
+	while (!ineof(in)) {
+		if (!inuint(in, &low) || !inchar(in, '-') || !inuint(in, &high)
+		    || !inchar(in, ' ') || ineof(in)) {
+			fputs("Could not parse input\n", stderr);
+			return false;
+		}
+		const char c = *in->p++;
+		if (!inlit(in, ": ")) {
+			fputs("Could not parse input\n", stderr);
+			return false;
+		}
+		const Span pass = inlower(in);
+		if (pass.len == 0 || !ineol(in)) {
+			fputs("Could not parse input\n", stderr);
+			return false;
+		}
 		size_t occurences = 0;
-		for (const char *it = pass; *it != 0; it++) {
-			if (*it == c)
+		for (size_t i = 0; i < pass.len; i++) {
+			if (pass.s[i] == c)
 				occurences++;
 		}
 		if (low <= occurences && occurences <= high)
-			numbers++;
-		const bool fmatch = pass[low - 1] == c;
-		const bool smatch = pass[high - 1] == c;
-		free(pass);
+			pol->numbers++;
+		const bool fmatch = low - 1 < pass.len
+		                    && pass.s[low - 1] == c;
+		const bool smatch = high - 1 < pass.len
+		                    && pass.s[high - 1] == c;
 		if ((fmatch || smatch) && !(fmatch && smatch))
-			positions++;
-		if (fgetc(in) != '\n')
-			break;
+			pol->positions++;
 	}
-	if (!feof(in)) {
-		perror("Could not parse input");
-		return EXIT_FAILURE;
-	}
-	printf("Numbers: %ju\nPositions: %ju\n", numbers, positions);
+	return true;
+}
+
+static int
+finish(void * const state, AdventResult * const out)
+{
+	const Policies * const pol = state;
+	answeruint(out, 0, "Numbers", pol->numbers);
+	answeruint(out, 1, "Positions", pol->positions);
 	return EXIT_SUCCESS;
 }
+
+const Stream stream02 = {
+	.sep = "\n",
+	.size = sizeof(Policies),
+	.begin = NULL,
+	.fold = fold,
+	.finish = finish,
+	.release = NULL
+};
+
+int
+day02(Input * const in, AdventResult * const out)
+{
+	return foldinput(&stream02, in, out);
+}
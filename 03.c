@@ -5,93 +5,77 @@
  * To Public License, Version 2, as published by Sam Hocevar. See
  * http://www.wtfpl.net/ for more details.
  */
-#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-#define PATTERN_WIDTH 31
-
-struct Node {
-	uint_fast32_t line;
-	struct Node *next;
-};
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+#include "grid.h"
 
-typedef struct Node Node;
+#define PATTERN_WIDTH 31
 
 typedef struct {
 	uint_fast8_t right;
 	uint_fast8_t down;
 } Slope;
 
-static Node *head = NULL;
-
-static void
-freelist(void)
-{
-	while (head != NULL) {
-		Node * const next = head->next;
-		free(head);
-		head = next;
-	}
-}
-
-static const Node *
-advance(const Node *node, uint_fast8_t steps)
+/* Lines of the input, the last one counting even without a line break */
+static size_t
+countlines(const Input * const in)
 {
-	while (node != NULL && steps-- > 0)
-		node = node->next;
-	return node;
+	size_t lines = in->p < in->end && in->end[-1] != '\n';
+	for (const char *p = in->p; p < in->end; p++)
+		lines += *p == '\n';
+	return lines;
 }
 
-int
-day03(FILE * const in)
+static bool
+parse(Input * const restrict in,
+      Arena * const restrict arena,
+      Grid * const restrict trees)
 {
-	Node *tail = NULL;
-	char input[PATTERN_WIDTH + 2];
-	if (atexit(freelist) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
-	errno = 0;
-	while (fgets(input, PATTERN_WIDTH + 2, in) != NULL) {
-		uint_fast32_t line = 0;
-		for (uint_fast8_t i = 0; i < PATTERN_WIDTH; i++) {
-			switch (input[i]) {
+	const size_t height = countlines(in);
+	uint64_t * const w = aralloc(arena,
+	                             gridwords(PATTERN_WIDTH, height)
+	                             * sizeof(uint64_t));
+	if (w == NULL) {
+		fputs("Could not allocate the map\n", stderr);
+		return false;
+	}
+	gridinit(trees, w, PATTERN_WIDTH, height);
+	for (size_t y = 0; y < height; y++) {
+		for (uint_fast8_t x = 0; x < PATTERN_WIDTH; x++) {
+			switch (inget(in)) {
 			case '#':
-				line |= 1 << i;
+				gridset(trees, x, y, true);
 			case '.':
 				break;
 			default:
 				fputs("Bad input format\n", stderr);
-				return EXIT_FAILURE;
+				return false;
 			}
 		}
-		if (input[PATTERN_WIDTH] != '\n') {
+		if (!ineol(in)) {
 			fputs("Bad input format\n", stderr);
-			return EXIT_FAILURE;
+			return false;
 		}
-		Node * const node = malloc(sizeof(Node));
-		if (node == NULL) {
-			if (errno != 0)
-				perror("Could not allocate new node");
-			else
-				fputs("Could not allocate new node\n", stderr);
-			return EXIT_FAILURE;
-		}
-		node->line = line;
-		node->next = NULL;
-		if (head == NULL)
-			head = node;
-		else
-			tail->next = node;
-		tail = node;
 	}
-	if (!feof(in)) {
-		if (errno != 0)
-			perror("Could not parse puzzle input");
-		else
-			fputs("Could not parse puzzle input\n", stderr);
+	return true;
+}
+
+int
+day03(Input * const in, AdventResult * const out)
+{
+	Grid trees;
+	if (!parse(in, scratch(out), &trees))
 		return EXIT_FAILURE;
-	}
+	parsed(out);
 	Slope slopes[] = {
 		{ .right = 1, .down = 1 },
 		{ .right = 3, .down = 1 },
@@ -101,17 +85,15 @@ day03(FILE * const in)
 	};
 	uintmax_t product = 1;
 	for (uint_fast8_t s = 0; s < sizeof(slopes) / sizeof(Slope); s++) {
-		uintmax_t trees = 0, x = 0;
-		const Node *node;
-		for (node = head; node; node = advance(node, slopes[s].down)) {
-			if ((node->line >> (x % PATTERN_WIDTH)) & 1)
-				trees++;
+		uintmax_t count = 0, x = 0;
+		for (size_t y = 0; y < trees.height; y += slopes[s].down) {
+			count += gridget(&trees, x % PATTERN_WIDTH, y);
 			x += slopes[s].right;
 		}
 		if (s == 1)
-			printf("R3D1\t%ju\n", trees);
-		product *= trees;
+			answeruint(out, 0, "R3D1", count);
+		product *= count;
 	}
-	printf("Product\t%ju\n", product);
+	answeruint(out, 1, "Product", product);
 	return EXIT_SUCCESS;
 }
@@ -6,7 +6,6 @@
  * http://www.wtfpl.net/ for more details.
  */
 #include <ctype.h>
-#include <errno.h>
 #include <regex.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -14,13 +13,19 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+
+#define NFIELDS (sizeof(fielddefs) / sizeof(Field))
+
 typedef struct {
 	const char *name;
 	const char *regex;
-	regex_t pattern;
 } Field;
 
-static Field fielddefs[] = {
+static const Field fielddefs[] = {
 	{ .name = "byr", .regex = "^19([2-9][0-9])|200[0-2]$" },
 	{ .name = "iyr", .regex = "^20(1[0-9]|20)$" },
 	{ .name = "eyr", .regex = "^20(2[0-9]|30)$" },
@@ -33,10 +38,10 @@ static Field fielddefs[] = {
 };
 
 static void
-freefields(void)
+freefields(regex_t pattern[const], const uint_fast8_t n)
 {
-	for (uint_fast8_t f = 0; f < sizeof(fielddefs) / sizeof(Field); f++)
-		regfree(&fielddefs[f].pattern);
+	for (uint_fast8_t f = 0; f < n; f++)
+		regfree(&pattern[f]);
 }
 
 static void
@@ -53,15 +58,20 @@ checkpassport(const uint_fast8_t fields,
 }
 
 static void
-tryfields(const char * const restrict name,
-          const char * const restrict value,
+tryfields(const regex_t pattern[const restrict],
+          const Span name,
+          const Span value,
           uint_fast8_t * const restrict fields,
           bool * const restrict error)
 {
-	for (uint_fast8_t f = 0; f < sizeof(fielddefs) / sizeof(Field); f++) {
-		if (strcmp(name, fielddefs[f].name) != 0)
+	for (uint_fast8_t f = 0; f < NFIELDS; f++) {
+		if (name.len != 3 || memcmp(name.s, fielddefs[f].name, 3) != 0)
 			continue;
-		if (regexec(&fielddefs[f].pattern, value, 0, NULL, 0) != 0
+		/* regexec needs a string; values are short */
+		char str[value.len + 1];
+		memcpy(str, value.s, value.len);
+		str[value.len] = 0;
+		if (regexec(&pattern[f], str, 0, NULL, 0) != 0
 		    || (*fields & (1u << f)) != 0)
 			*error = true;
 		*fields |= 1u << f;
@@ -69,58 +79,104 @@ tryfields(const char * const restrict name,
 	}
 }
 
-int
-day04(FILE * const in)
+static bool
+compilefields(regex_t pattern[const])
 {
-	if (atexit(freefields) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
-	for (uint_fast8_t f = 0; f < sizeof(fielddefs) / sizeof(Field); f++) {
-		const int err = regcomp(&fielddefs[f].pattern,
+	for (uint_fast8_t f = 0; f < NFIELDS; f++) {
+		const int err = regcomp(&pattern[f],
 		                        fielddefs[f].regex,
 		                        REG_EXTENDED | REG_NOSUB); 
 		if (err != 0) {
-			const size_t n = regerror(err,
-			                          &fielddefs[f].pattern,
-			                          NULL,
-			                          0);
+			const size_t n = regerror(err, &pattern[f], NULL, 0);
 			char errbuf[n];
-			regerror(err, &fielddefs[f].pattern, errbuf, n);
+			regerror(err, &pattern[f], errbuf, n);
 			fprintf(stderr,
 			        "Could not compile regex: %s\n",
 			        errbuf);
-			return EXIT_FAILURE;
+			freefields(pattern, f);
+			return false;
 		}
 	}
-	uint_fast8_t fields = 0;
-	bool error = false;
-	uintmax_t present = 0, valid = 0;
-	char field[4], *value;
-	while (!feof(in) && !ferror(in)) {
-		if (fscanf(in, "%3[a-z]:%m[#0-9a-z]", field, &value) != 2) {
-			if (errno != 0)
-				perror("Failed to read from standard input");
-			else
-				fputs("Bad input format\n", stderr);
-			return EXIT_FAILURE;
+	return true;
+}
+
+typedef struct {
+	regex_t pattern[NFIELDS];
+	uint_fast8_t fields;
+	bool error;
+	uintmax_t present, valid;
+} Passports;
+
+static bool
+begin(void * const state, AdventResult * const out)
+{
+	(void) out;
+	Passports * const p = state;
+	return compilefields(p->pattern);
+}
+
+static bool
+fold(void * const state, Input * const in)
+{
+	Passports * const p = state;
+	/* Chunks may start with the rest of a run of blank lines */
+	inspace(in);
+	while (!ineof(in)) {
+		const Span field = inlower(in);
+		if (field.len == 0 || field.len > 3 || !inchar(in, ':')) {
+			fputs("Bad input format\n", stderr);
+			return false;
+		}
+		const char * const from = in->p;
+		for (int c; islower(c = inpeek(in)) || isdigit(c) || c == '#';)
+			in->p++;
+		const Span value = { .s = from, .len = in->p - from };
+		if (value.len == 0) {
+			fputs("Bad input format\n", stderr);
+			return false;
 		}
-		tryfields(field, value, &fields, &error);
-		free(value);
-		int end;
-		size_t lines = 0;
-		do {
-			end = fgetc(in);
-			if (end == '\n')
-				lines++;
-		} while (isspace(end));
-		ungetc(end, in);
-		if (lines > 1) {
-			checkpassport(fields, error, &present, &valid);
-			fields = 0;
-			error = false;
+		tryfields(p->pattern, field, value, &p->fields, &p->error);
+		if (inspace(in) > 1) {
+			checkpassport(p->fields,
+			              p->error,
+			              &p->present,
+			              &p->valid);
+			p->fields = 0;
+			p->error = false;
 		}
 	}
-	checkpassport(fields, error, &present, &valid);
-	printf("Present\t%ju\n", present);
-	printf("Valid\t%ju\n", valid);
+	return true;
+}
+
+static int
+finish(void * const state, AdventResult * const out)
+{
+	Passports * const p = state;
+	checkpassport(p->fields, p->error, &p->present, &p->valid);
+	answeruint(out, 0, "Present", p->present);
+	answeruint(out, 1, "Valid", p->valid);
 	return EXIT_SUCCESS;
 }
+
+static void
+release(void * const state)
+{
+	Passports * const p = state;
+	freefields(p->pattern, NFIELDS);
+}
+
+/* Passports end with a blank line, so each chunk holds whole passports */
+const Stream stream04 = {
+	.sep = "\n\n",
+	.size = sizeof(Passports),
+	.begin = begin,
+	.fold = fold,
+	.finish = finish,
+	.release = release
+};
+
+int
+day04(Input * const in, AdventResult * const out)
+{
+	return foldinput(&stream04, in, out);
+}
@@ -5,13 +5,18 @@
  * To Public License, Version 2, as published by Sam Hocevar. See
  * http://www.wtfpl.net/ for more details.
  */
-#include <errno.h>
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-static void
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+
+static bool
 parseseatpart(uint_fast16_t * const restrict id,
               const char * const restrict input,
               const uint_fast8_t begin,
@@ -25,43 +30,55 @@ parseseatpart(uint_fast16_t * const restrict id,
 			(*id)++;
 		} else if (input[i] != low) {
 			fputs("Bad input format\n", stderr);
-			exit(EXIT_FAILURE);
+			return false;
 		}
 	}
+	return true;
 }
 
-int
-day05(FILE * const in)
+typedef struct {
+	uint_fast16_t highest;
+	uint_fast8_t present[128];
+} Seats;
+
+static bool
+fold(void * const state, Input * const in)
 {
-	uint_fast16_t highest = 0;
-	uint_fast8_t present[128] = { 0 };
-	char input[11];
-	errno = 0;
-	while (fscanf(in, "%10[FBLR]", input) == 1) {
+	Seats * const seats = state;
+	while (!ineof(in)) {
+		const char * const input = in->p;
 		uint_fast16_t id = 0;
-		parseseatpart(&id, input, 0, 7, 'B', 'F');
-		parseseatpart(&id, input, 7, 10, 'R', 'L');
-		if (id > highest)
-			highest = id;
-		present[id / 8] |= 1 << (id % 8);
-		if (fgetc(in) != '\n')
-			break;
-	}
-	if (!feof(in) || ferror(in)) {
-		if (errno != 0)
-			perror("Failed to input boarding pass");
-		else
+		if (in->end - in->p < 10) {
 			fputs("Bad input format\n", stderr);
-		return EXIT_FAILURE;
+			return false;
+		}
+		in->p += 10;
+		if (!parseseatpart(&id, input, 0, 7, 'B', 'F')
+		    || !parseseatpart(&id, input, 7, 10, 'R', 'L'))
+			return false;
+		if (id > seats->highest)
+			seats->highest = id;
+		seats->present[id / 8] |= 1 << (id % 8);
+		if (!ineol(in)) {
+			fputs("Bad input format\n", stderr);
+			return false;
+		}
 	}
-	printf("Highest\t%" PRIuFAST16 "\n", highest);
+	return true;
+}
+
+static int
+finish(void * const state, AdventResult * const out)
+{
+	const Seats * const seats = state;
+	answeruint(out, 0, "Highest", seats->highest);
 	bool began = false;
 	for (uint_fast16_t i = 0; i < 128; i++) {
 		for (uint_fast8_t j = 0; j < 8; j++) {
-			if (!began && (present[i] & (1 << j)))
+			if (!began && (seats->present[i] & (1 << j)))
 				began = true;
-			if (began && !(present[i] & (1 << j))) {
-				printf("Seat\t%" PRIuFAST16 "\n", 8 * i + j);
+			if (began && !(seats->present[i] & (1 << j))) {
+				answeruint(out, 1, "Seat", 8 * i + j);
 				return EXIT_SUCCESS;
 			}
 		}
@@ -69,3 +86,18 @@ day05(FILE * const in)
 	fputs("Seat not found\n", stderr);
 	return EXIT_FAILURE;
 }
+
+const Stream stream05 = {
+	.sep = "\n",
+	.size = sizeof(Seats),
+	.begin = NULL,
+	.fold = fold,
+	.finish = finish,
+	.release = NULL
+};
+
+int
+day05(Input * const in, AdventResult * const out)
+{
+	return foldinput(&stream05, in, out);
+}
@@ -5,13 +5,16 @@
  * To Public License, Version 2, as published by Sam Hocevar. See
  * http://www.wtfpl.net/ for more details.
  */
-#include <errno.h>
-#include <limits.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-#define DIGITS(T) (CHAR_BIT * 10 * sizeof(T) / (9 * sizeof(char)))
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
 
 static void
 updatetotals(const uint_fast32_t acurrent,
@@ -27,61 +30,73 @@ updatetotals(const uint_fast32_t acurrent,
 	}
 }
 
-static void
-parseerr(const uintmax_t line)
+typedef struct {
+	uintmax_t atotal, etotal, line;
+	uint_fast32_t acurrent, ecurrent;
+} Groups;
+
+static bool
+begin(void * const state, AdventResult * const out)
 {
-	if (errno != 0) {
-		char buf[19 + DIGITS(uintmax_t)];
-		sprintf(buf, "Bad input on line %ju", line);
-		perror(buf);
-	} else {
-		fprintf(stderr, "Bad input on line %ju\n", line);
-	}
+	(void) out;
+	Groups * const g = state;
+	g->line = 1;
+	g->ecurrent = 0x03ffffff;
+	return true;
 }
 
-int
-day06(FILE * const in)
+static bool
+fold(void * const state, Input * const in)
 {
-	uintmax_t atotal = 0, etotal = 0, line = 1;
-	uint_fast32_t acurrent = 0, ecurrent = 0x03ffffff;
-	errno = 0;
-	while (!feof(in) && !ferror(in)) {
-		char input[27];
-		if (fscanf(in, "%26[a-z]", input) == 1) {
+	Groups * const g = state;
+	do {
+		const Span input = inlower(in);
+		if (!ineol(in)) {
+			fprintf(stderr, "Bad input on line %ju\n", g->line);
+			return false;
+		}
+		if (input.len > 0) {
 			uint_fast32_t this = 0;
-			for (const char *c = input; *c != 0; c++)
-				this |= UINT32_C(1) << (*c - 'a');
-			acurrent |= this;
-			ecurrent = 0x03ffffff & (ecurrent & this);
-			const int end = fgetc(in);
-			if (end != EOF && end != '\n') {
-				parseerr(line);
-				return EXIT_FAILURE;
-			} else if (end == EOF) {
-				updatetotals(acurrent,
-				             &atotal,
-				             ecurrent,
-				             &etotal);
-			}
-		} else {
-			const int c = fgetc(in);
-			if (c != EOF && c != '\n') {
-				parseerr(line);
-				return EXIT_FAILURE;
-			}
-			updatetotals(acurrent, &atotal, ecurrent, &etotal);
-			acurrent = 0;
-			ecurrent = 0x03ffffff;
+			for (size_t i = 0; i < input.len; i++)
+				this |= UINT32_C(1) << (input.s[i] - 'a');
+			g->acurrent |= this;
+			g->ecurrent = 0x03ffffff & (g->ecurrent & this);
 		}
-		line++;
-	}
-	if (!feof(in) || ferror(in)) {
-		if (errno != 0)
-			perror("Puzzle input parsing failed");
-		else
-			fputs("Puzzle input parsing failed\n", stderr);
-		return EXIT_FAILURE;
-	}
-	printf("Any\t%ju\nEvery\t%ju\n", atotal, etotal);
+		/* A blank line or the end of input closes the group */
+		if (input.len == 0 || ineof(in)) {
+			updatetotals(g->acurrent,
+			             &g->atotal,
+			             g->ecurrent,
+			             &g->etotal);
+			g->acurrent = 0;
+			g->ecurrent = 0x03ffffff;
+		}
+		g->line++;
+	} while (!ineof(in));
+	return true;
+}
+
+static int
+finish(void * const state, AdventResult * const out)
+{
+	const Groups * const g = state;
+	answeruint(out, 0, "Any", g->atotal);
+	answeruint(out, 1, "Every", g->etotal);
 	return EXIT_SUCCESS;
 }
+
+/* Groups end with a blank line, so each chunk holds whole groups */
+const Stream stream06 = {
+	.sep = "\n\n",
+	.size = sizeof(Groups),
+	.begin = begin,
+	.fold = fold,
+	.finish = finish,
+	.release = NULL
+};
+
+int
+day06(Input * const in, AdventResult * const out)
+{
+	return foldinput(&stream06, in, out);
+}
@@ -5,23 +5,24 @@
  * To Public License, Version 2, as published by Sam Hocevar. See
  * http://www.wtfpl.net/ for more details.
  */
-#include <errno.h>
-#include <limits.h>
-#include <regex.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define SIZE_MATCH(r) ((size_t) (r.rm_eo - r.rm_so + 1))
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+
 #define MAX_RULES 1024
 
-/* Upper bound to how many digits a given type may hold */
-#define DIGITS(T) (CHAR_BIT * 10 * sizeof(T) / (9 * sizeof(char)))
+/* Version of the bag graph kept in snapshots */
+#define SNAPSHOT 1
 
 typedef union {
-	char *str;
+	Span str;
 	size_t id;
 } ContainUnion;
 
@@ -34,39 +35,60 @@ struct ContainNode {
 typedef struct ContainNode ContainNode;
 
 typedef struct {
-	char *container;
+	Span container;
 	ContainNode *contains;
 } Rule;
 
-static Rule rules[MAX_RULES];
-static size_t nrules = 0;
-static bool converted = false;
-static regex_t listpattern, inputpattern;
+typedef struct {
+	Rule rules[MAX_RULES];
+	size_t nrules;
+} State;
 
-static void
-addrule(const Rule rule)
+typedef struct {
+	size_t id;
+	uint8_t quantity;
+} Content;
+
+/*
+ * The rules once bags are known by their index, which hold no pointers: the
+ * contents of bag `i` are `content[first[i]]` up to `content[first[i + 1]]`
+ */
+typedef struct {
+	size_t nbags, gold;
+	size_t first[MAX_RULES + 1];
+	Content content[];
+} Graph;
+
+static bool
+addrule(State * const restrict s, const Rule rule)
 {
-	if (nrules >= MAX_RULES) {
+	Rule * const rules = s->rules;
+	if (s->nrules >= MAX_RULES) {
 		fputs("Maximum rule number reached\n", stderr);
-		exit(EXIT_FAILURE);
+		return false;
 	}
-	rules[nrules] = rule;
-	for (size_t i = nrules++; i > 0; i--) {
-		if (strcmp(rules[i].container, rules[i - 1].container) > 0)
+	rules[s->nrules] = rule;
+	for (size_t i = s->nrules++; i > 0; i--) {
+		if (spancmp(rules[i].container, rules[i - 1].container) > 0)
 			break;
 		Rule temp = rules[i];
 		rules[i] = rules[i - 1];
 		rules[i - 1] = temp;
 	}
+	return true;
 }
 
 static size_t
-getrule(const char *const container)
+getrule(const State * const restrict s, const Span container)
 {
+	const Rule * const rules = s->rules;
+	const size_t nrules = s->nrules;
 	size_t a = 0, b = nrules - 1;
+	if (nrules == 0)
+		return 0;
 	do {
 		const size_t m = (a / 2 + b / 2) + (a % 2 + b % 2 == 2);
-		const int cmp = strcmp(rules[m].container, container);
+		const int cmp = spancmp(rules[m].container, container);
 		if (cmp < 0)
 			a = m;
 		else if (cmp > 0)
@@ -74,223 +96,234 @@ getrule(const char *const container)
 		else
 			return m;
 	} while (a + 1 < b);
-	if (strcmp(rules[a].container, container) == 0)
+	if (spaneq(rules[a].container, container))
 		return a;
-	if (strcmp(rules[b].container, container) == 0)
+	if (spaneq(rules[b].container, container))
 		return b;
 	return nrules;
 }
 
-static void
-freecontainlist(ContainNode *node)
-{
-	while (node != NULL) {
-		if (!converted)
-			free(node->u.str);
-		ContainNode * const temp = node->next;
-		free(node);
-		node = temp;
-	}
-}
-
-static char *
-clonefromto(const char *const string, const regmatch_t bounds)
+/* Reads the words of a color up to "bag" or "bags", which is consumed */
+static bool
+parsebag(Input * const restrict in, Span * const restrict bag)
 {
-	char * const new = malloc(SIZE_MATCH(bounds) * sizeof(char));
-	if (new != NULL) {
-		memcpy(new,
-		       string + bounds.rm_so,
-		       bounds.rm_eo - bounds.rm_so);
-		new[bounds.rm_eo - bounds.rm_so] = 0;
+	const char * const begin = in->p;
+	for (;;) {
+		const char * const end = in->p;
+		const Span word = inlower(in);
+		if (word.len == 0)
+			return false;
+		if (spaneq(word, SPAN("bag")) || spaneq(word, SPAN("bags"))) {
+			if (end == begin)
+				return false;
+			*bag = (Span) { .s = begin, .len = end - 1 - begin };
+			return true;
+		}
+		if (!inchar(in, ' '))
+			return false;
 	}
-	return new;
 }
 
-static ContainNode *
-makelist(const char *str)
+/* Parses what a bag contains, up to the final period */
+static bool
+makelist(Input * const restrict in,
+         Arena * const restrict arena,
+         ContainNode ** const restrict headref,
+         const uintmax_t line)
 {
-	errno = 0;
-	if (strcmp(str, "no other bags.") == 0)
-		return NULL;
-	ContainNode *head = NULL, *tail = NULL;
-	while (str[0] != 0) {
-		regmatch_t match[5];
-		if (regexec(&listpattern, str, 5, match, 0) == REG_NOMATCH) {
-			errno = EINVAL;
-			freecontainlist(head);
-			return NULL;
-		}
-		uint_fast8_t quantity = 0;
-		for (regoff_t i = match[1].rm_so; i < match[1].rm_eo; i++) {
-			const uint_fast8_t new = 10 * quantity + str[i] - '0';
-			if (new < quantity) {
-				errno = EINVAL;
-				freecontainlist(head);
-				return NULL;
-			}
-			quantity = new;
+	ContainNode *tail = NULL;
+	*headref = NULL;
+	if (inlit(in, "no other bags."))
+		return true;
+	do {
+		uintmax_t quantity;
+		Span bag;
+		if (!inuint(in, &quantity) || quantity > UINT8_MAX
+		    || !inchar(in, ' ') || !parsebag(in, &bag)) {
+			fprintf(stderr,
+			        "Bad puzzle input format on line %ju\n",
+			        line);
+			return false;
 		}
-		char * const bag = clonefromto(str, match[2]);
-		ContainNode * const new = malloc(sizeof(ContainNode));
+		ContainNode * const new = aralloc(arena, sizeof(ContainNode));
 		if (new == NULL) {
-			free(bag);
-			freecontainlist(head);
-			return NULL;
+			fprintf(stderr,
+			        "Could not allocate list on line %ju\n",
+			        line);
+			return false;
 		}
 		new->quantity = quantity;
 		new->u.str = bag;
 		new->next = NULL;
-		if (head == NULL)
-			head = new;
+		if (*headref == NULL)
+			*headref = new;
 		else
 			tail->next = new;
 		tail = new;
-		str += match[4].rm_eo;
-	}
-	return head;
-}
-
-static void
-parseerr(const char * const str, const uintmax_t line)
-{
-	if (errno != 0) {
-		char buf[strlen(str) + 10 + DIGITS(uintmax_t)];
-		sprintf(buf, "%s on line %ju", str, line);
-		perror(buf);
-	} else {
-		fprintf(stderr, "%s on line %ju\n", str, line);
+	} while (inlit(in, ", "));
+	if (!inchar(in, '.')) {
+		fprintf(stderr, "Bad puzzle input format on line %ju\n", line);
+		return false;
 	}
+	return true;
 }
 
 static bool
-convertrules(void)
+convertrules(State * const s)
 {
 	bool success = true;
-	converted = true;
-	for (size_t i = 0; i < nrules; i++) {
+	for (size_t i = 0; i < s->nrules; i++) {
 		ContainNode *node;
-		for (node = rules[i].contains; node; node = node->next) {
-			const size_t id = getrule(node->u.str);
-			if (id == nrules)
+		for (node = s->rules[i].contains; node; node = node->next) {
+			const size_t id = getrule(s, node->u.str);
+			if (id == s->nrules)
 				success = false;
-			free(node->u.str);
 			node->u.id = id;
 		}
 	}
 	return success;
 }
 
-static void
-freedata(void)
-{
-	for (size_t i = 0; i < nrules; i++) {
-		free(rules[i].container);
-		freecontainlist(rules[i].contains);
-	}
-	regfree(&listpattern);
-	regfree(&inputpattern);
-}
-
 static bool
-hasbag(const Rule * const restrict rule,
-       const char * const restrict name,
-       const size_t calls)
+hasbag(const Graph * const g, const size_t id, const size_t calls)
 {
-	const ContainNode *node;
-	if (strcmp(rule->container, name) == 0)
+	if (id == g->gold)
 		return true;
 	if (calls == 0)
 		return false;
-	for (node = rule->contains; node != NULL; node = node->next) {
-		if (hasbag(rules + node->u.id, name, calls - 1))
+	for (size_t c = g->first[id]; c < g->first[id + 1]; c++) {
+		if (hasbag(g, g->content[c].id, calls - 1))
 			return true;
 	}
 	return false;
 }
 
 static uintmax_t
-countbags(const size_t id)
+countbags(const Graph * const g, const size_t id)
 {
 	uintmax_t count = 0;
-	for (ContainNode *node = rules[id].contains; node; node = node->next)
-		count += node->quantity * (1 + countbags(node->u.id));
+	for (size_t c = g->first[id]; c < g->first[id + 1]; c++) {
+		const Content * const bag = &g->content[c];
+		count += bag->quantity * (1 + countbags(g, bag->id));
+	}
 	return count;
 }
 
-static void
-tryregcomp(regex_t *const pattern, const char *const regex)
+/* Lays out the converted rules in scratch memory, as snapshots keep them */
+static Graph *
+flatten(const State * const restrict s,
+        const size_t gold,
+        size_t * const restrict size,
+        AdventResult * const restrict out)
 {
-	const int result = regcomp(pattern, regex, REG_EXTENDED);
-	if (result != 0) {
-		const size_t n = regerror(result, pattern, NULL, 0);
-		char buf[n];
-		regerror(result, pattern, buf, n);
-		fprintf(stderr, "Could not compile regex: %s\n", buf);
-		exit(EXIT_FAILURE);
+	size_t ncontents = 0;
+	for (size_t i = 0; i < s->nrules; i++) {
+		for (ContainNode *node = s->rules[i].contains; node;
+		     node = node->next)
+			ncontents++;
+	}
+	*size = sizeof(Graph) + ncontents * sizeof(Content);
+	Graph * const g = aralloc(scratch(out), *size);
+	if (g == NULL) {
+		fputs("Could not allocate bag graph\n", stderr);
+		return NULL;
+	}
+	g->nbags = s->nrules;
+	g->gold = gold;
+	size_t c = 0;
+	for (size_t i = 0; i < s->nrules; i++) {
+		g->first[i] = c;
+		for (ContainNode *node = s->rules[i].contains; node;
+		     node = node->next) {
+			g->content[c++] = (Content) {
+				.id = node->u.id,
+				.quantity = node->quantity
+			};
+		}
 	}
+	g->first[s->nrules] = c;
+	return g;
 }
 
-int
-day07(FILE * const in)
+/* Parses the rules and converts them into a graph of bags */
+static const Graph *
+parse(Input * const restrict in,
+      State * const restrict s,
+      AdventResult * const restrict out)
 {
-	if (atexit(freedata) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
-	tryregcomp(&inputpattern, "^([a-z ]+) bags contain ([0-9a-z ,]+)\\.$");
-	tryregcomp(&listpattern, "^([0-9]+) (([a-z ])+) bags?(, |\\.)");
+	Arena * const arena = scratch(out);
 	uintmax_t line = 1;
-	char *input;
-	errno = 0;
-	while (fscanf(in, "%m[0-9a-z ,.]", &input) == 1) {
-		regmatch_t regmatch[3];
-		if (regexec(&inputpattern, input, 3, regmatch, 0) != 0) {
-			free(input);
-			parseerr("Bad puzzle input format", line);
-			return EXIT_FAILURE;
-		}
-		char *const new = clonefromto(input, regmatch[1]);
-		if (new == NULL) {
-			free(input);
-			parseerr("Could not copy string", line);
-			return EXIT_FAILURE;
-		}
+	while (!ineof(in)) {
 		Rule rule;
-		rule.container = new;
-		rule.contains = makelist(input + regmatch[2].rm_so);
-		if (errno != 0) {
-			free(input);
-			parseerr("Could not allocate list", line);
-			return EXIT_FAILURE;
+		if (!parsebag(in, &rule.container)
+		    || !inlit(in, " contain ")) {
+			fprintf(stderr,
+			        "Bad puzzle input format on line %ju\n",
+			        line);
+			return NULL;
 		}
-		addrule(rule);
-		free(input);
-		const int next = fgetc(in);
-		if (next != EOF && next != '\n') {
+		if (!makelist(in, arena, &rule.contains, line)
+		    || !addrule(s, rule))
+			return NULL;
+		if (!ineol(in)) {
 			fprintf(stderr,
 			        "Bad input format on line %ju\n",
 			        line);
-			return EXIT_FAILURE;
+			return NULL;
 		}
 		line++;
 	}
-	if (!feof(in) || ferror(in)) {
-		fputs("Puzzle input parsing failed\n", stderr);
-		return EXIT_FAILURE;
-	}
-	if (!convertrules()) {
+	parsed(out);
+	const size_t phase = tracebegin(out, "Convert rules");
+	if (!convertrules(s)) {
 		fputs("A bag contains a nonexisting bag\n", stderr);
-		return EXIT_FAILURE;
+		return NULL;
 	}
+	size_t size;
+	const Graph * const g = flatten(s,
+	                                getrule(s, SPAN("shiny gold")),
+	                                &size,
+	                                out);
+	traceend(out, phase);
+	if (g != NULL)
+		snapsave(out, SNAPSHOT, g, size);
+	return g;
+}
+
+/* The graph comes from a snapshot if there is one, or else is parsed */
+static int
+solve(Input * const restrict in,
+      State * const restrict s,
+      AdventResult * const restrict out)
+{
+	size_t size;
+	const Graph *g = snapload(out, SNAPSHOT, &size);
+	if (g != NULL && size >= sizeof(Graph) && g->nbags <= MAX_RULES
+	    && size == sizeof(Graph) + g->first[g->nbags] * sizeof(Content))
+		parsed(out);
+	else if ((g = parse(in, s, out)) == NULL)
+		return EXIT_FAILURE;
+	size_t phase = tracebegin(out, "Part 1");
 	size_t nbags = 0;
-	for (size_t i = 0; i < nrules; i++) {
-		if (hasbag(rules + i, "shiny gold", nrules))
+	for (size_t i = 0; i < g->nbags; i++) {
+		if (hasbag(g, i, g->nbags))
 			nbags++;
 	}
-	printf("w/ SGB\t%zu\n", nbags - 1);
-	const size_t id = getrule("shiny gold");
-	if (id == nrules) {
+	answeruint(out, 0, "w/ SGB", nbags - 1);
+	traceend(out, phase);
+	phase = tracebegin(out, "Part 2");
+	if (g->gold == g->nbags) {
 		fputs("Shiny gold bag not found\n", stderr);
 		return EXIT_FAILURE;
 	}
-	printf("In SGB\t%ju\n", countbags(id));
+	answeruint(out, 1, "In SGB", countbags(g, g->gold));
+	traceend(out, phase);
 	return EXIT_SUCCESS;
 }
+
+int
+day07(Input * const in, AdventResult * const out)
+{
+	State s = { .nrules = 0 };
+	return solve(in, &s, out);
+}
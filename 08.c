@@ -7,16 +7,31 @@
  */
 #include <errno.h>
 #include <limits.h>
-#include <regex.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+#include "parallel.h"
+
 /* Upper bound to how many digits a given type may hold */
 #define DIGITS(T) (CHAR_BIT * 10 * sizeof(T) / (9 * sizeof(char)))
 
+/*
+ * Instructions a range of substitutions should run at most before it is
+ * worth a thread, and ranges per thread in each wave of the search
+ */
+#define SEARCH_STEPS 16384
+#define WAVE_RANGES 2
+
+/* Version of the instructions kept in snapshots */
+#define SNAPSHOT 1
+
 typedef enum { ACC, JMP, NOP } Operation;
 
 typedef struct {
@@ -24,41 +39,55 @@ typedef struct {
 	intmax_t x;
 } Instruction;
 
-typedef enum { NO_RUN, LOOPED, TERMINATED } RunResult;
+/* Instructions being parsed */
+typedef struct {
+	Instruction *instr;
+	size_t cinstr, ninstr;
+} Listing;
 
-static regex_t reg;
-static Instruction *instr = NULL;
-static size_t cinstr = 0, ninstr = 0;
+typedef struct {
+	const Instruction *instr;
+	size_t ninstr;
+} Program;
 
-static void
-freedata(void)
-{
-	regfree(&reg);
-	free(instr);
-}
+/* Programs which fail jump out of the code or overflow the accumulator */
+typedef enum { NO_RUN, LOOPED, TERMINATED, ESCAPED, OVERFLOWED } RunResult;
+
+/* Results of the runs of a range of substitutions, one per instruction */
+typedef struct {
+	const Program *p;
+	RunResult *result;
+	intmax_t *acc;
+} Search;
 
-static Operation
-parseop(const char *const str)
+static bool
+parseop(Input * const restrict in, Operation * const restrict op)
 {
-	if (strcmp(str, "acc") == 0)
-		return ACC;
-	else if (strcmp(str, "jmp") == 0)
-		return JMP;
-	return NOP;
+	if (inlit(in, "acc"))
+		*op = ACC;
+	else if (inlit(in, "jmp"))
+		*op = JMP;
+	else if (inlit(in, "nop"))
+		*op = NOP;
+	else
+		return false;
+	return true;
 }
 
 static bool
-resizeinstructions(void)
+resizeinstructions(Listing * const p)
 {
-	if (ninstr < cinstr)
+	if (p->ninstr < p->cinstr)
 		return true;
-	if (cinstr >= SIZE_MAX / 2)
+	if (p->cinstr >= SIZE_MAX / 2)
 		return false;
-	cinstr = (cinstr > 0)? 2 * cinstr : 1;
-	Instruction * const new = realloc(instr, cinstr * sizeof(Instruction));
+	const size_t cinstr = (p->cinstr > 0)? 2 * p->cinstr : 1;
+	Instruction * const new = realloc(p->instr,
+	                                  cinstr * sizeof(Instruction));
 	if (new == NULL)
 		return false;
-	instr = new;
+	p->instr = new;
+	p->cinstr = cinstr;
 	return true;
 }
 
@@ -80,102 +109,177 @@ overflows(const intmax_t x, const intmax_t y)
 	return (y > 0 && x > INTMAX_MAX - y) || (y < 0 && x < INTMAX_MIN - y);
 }
 
+/*
+ * Runs the program with the operation at `s` swapped, leaving the program
+ * as it is so that several substitutions can run at once
+ */
 static RunResult
-subsrun(const size_t s, intmax_t * const acc)
+subsrun(const Program * const restrict p,
+        const size_t s,
+        intmax_t * const restrict acc)
 {
-	if (s < SIZE_MAX) {
-		if (instr[s].op == JMP)
-			instr[s].op = NOP;
-		else if (instr[s].op == NOP && instr[s].x != 0)
-			instr[s].op = JMP;
-		else
-			return NO_RUN;
-	}
+	const Instruction * const instr = p->instr;
+	const size_t ninstr = p->ninstr;
+	if (s < SIZE_MAX && instr[s].op != JMP
+	    && !(instr[s].op == NOP && instr[s].x != 0))
+		return NO_RUN;
 	uint8_t beenthere[ninstr / 8 + 1];
 	for (size_t i = 0; i < ninstr / 8 + 1; i++)
 		beenthere[i] = 0;
 	size_t pc = 0;
-	while (!(beenthere[pc / 8] & (1u << (pc % 8)))) {
-		if (pc >= ninstr) {
-			fprintf(stderr, "Program counter (%zu) too big\n", pc);
-			exit(EXIT_FAILURE);
-		} else if (pc == ninstr - 1) {
-			break;
-		}
+	for (;;) {
+		if (pc >= ninstr)
+			return ESCAPED;
+		else if (pc == ninstr - 1)
+			return TERMINATED;
+		else if (beenthere[pc / 8] & (1u << (pc % 8)))
+			return LOOPED;
 		beenthere[pc / 8] |= 1u << (pc % 8);
-		if (instr[pc].op == ACC) {
-			if (overflows(*acc, instr[pc].x)) {
-				fprintf(stderr,
-				        "%jd + %jd overflows\n",
-				        *acc,
-				        instr[pc].x);
-				exit(EXIT_FAILURE);
-			}
+		Operation op = instr[pc].op;
+		if (pc == s)
+			op = op == JMP? NOP : JMP;
+		if (op == ACC) {
+			if (overflows(*acc, instr[pc].x))
+				return OVERFLOWED;
 			*acc += instr[pc].x;
 		}
-		pc += instr[pc].op == JMP? instr[pc].x : 1;
+		pc += op == JMP? instr[pc].x : 1;
 	}
+}
+
+static void
+searchrange(void * const arg, const size_t lo, const size_t hi)
+{
+	const Search * const search = arg;
+	for (size_t i = lo; i < hi; i++) {
+		search->acc[i] = 0;
+		search->result[i] = subsrun(search->p, i, &search->acc[i]);
+	}
+}
+
+/* Errors are only told of runs the search gets to, in order */
+static bool
+runfailed(const RunResult result, const size_t s)
+{
+	if (result == ESCAPED)
+		fputs("Program counter too big", stderr);
+	else if (result == OVERFLOWED)
+		fputs("Accumulator overflows", stderr);
+	else
+		return false;
 	if (s < SIZE_MAX)
-		instr[s].op = instr[s].op == JMP? NOP : JMP;
-	return pc == ninstr - 1? TERMINATED : LOOPED;
+		fprintf(stderr, " with instruction %zu swapped\n", s + 1);
+	else
+		fputc('\n', stderr);
+	return true;
 }
 
-int
-day08(FILE * const in)
+/*
+ * Tries substitutions in waves of a few per thread, so that the search still
+ * stops soon after the first one which terminates
+ */
+static int
+searchwaves(Search * const restrict search,
+            AdventResult * const restrict out)
 {
-	if (atexit(freedata) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
-	int res = regcomp(&reg, "^(acc|jmp|nop) ([+-][0-9]+)$", REG_EXTENDED);
-	if (res != 0) {
-		const size_t n = regerror(res, &reg, NULL, 0);
-		char buf[n];
-		regerror(res, &reg, buf, n);
-		fprintf(stderr, "Could not compile regex: %s", buf);
-		return EXIT_FAILURE;
+	const size_t ninstr = search->p->ninstr;
+	const size_t grain = 1 + SEARCH_STEPS / ninstr;
+	const size_t wave = grain * WAVE_RANGES * parallelthreads();
+	for (size_t lo = 0; lo < ninstr; lo += wave) {
+		const size_t hi = ninstr - lo > wave? lo + wave : ninstr;
+		parallelfor(lo, hi, grain, searchrange, search);
+		for (size_t i = lo; i < hi; i++) {
+			if (runfailed(search->result[i], i))
+				return EXIT_FAILURE;
+			if (search->result[i] == TERMINATED) {
+				answerint(out, 1, "No loop", search->acc[i]);
+				return EXIT_SUCCESS;
+			}
+		}
 	}
+	fputs("All substitutions loop\n", stderr);
+	return EXIT_FAILURE;
+}
+
+static bool
+parse(Input * const restrict in, Listing * const restrict l)
+{
 	uintmax_t line = 1;
-	char input[6 + DIGITS(intmax_t)], fmt[17 + DIGITS(uintmax_t)];
-	sprintf(fmt, "%%%ju[acjmnop 0-9+-]", DIGITS(size_t));
-	while (fscanf(in, fmt, input) == 1) {
-		regmatch_t match[3];
-		if (regexec(&reg, input, 3, match, 0) == REG_NOMATCH) {
-			fprintf(stderr, "Bad input format on line %ju\n", line);
-			return EXIT_FAILURE;
-		}
-		input[match[1].rm_eo] = 0;
-		if (!resizeinstructions()) {
+	while (!ineof(in)) {
+		if (!resizeinstructions(l)) {
 			parseerr("Could not reallocate instructions", line);
-			return EXIT_FAILURE;
+			return false;
+		}
+		Instruction * const instr = l->instr + l->ninstr;
+		const int sign = (parseop(in, &instr->op) && inchar(in, ' '))?
+		                 inpeek(in) : EOF;
+		if ((sign != '+' && sign != '-') || !inint(in, &instr->x)) {
+			fprintf(stderr, "Bad input format on line %ju\n", line);
+			return false;
 		}
-		instr[ninstr].op = parseop(input);
-		sscanf(input + match[2].rm_so, "%jd", &instr[ninstr++].x);
-		const int next = fgetc(in);
-		if (next != '\n' && next != EOF) {
+		l->ninstr++;
+		if (!ineol(in)) {
 			fprintf(stderr, "Line %ju is too long\n", line);
-			return EXIT_FAILURE;
+			return false;
 		}
 		line++;
 	}
-	if (!feof(in) || ferror(in)) {
-		fputs("Puzzle input parsing failed\n", stderr);
+	return true;
+}
+
+/* Instructions come from a snapshot if there is one, or else are parsed */
+static int
+solve(Input * const restrict in,
+      Listing * const restrict l,
+      AdventResult * const restrict out)
+{
+	size_t size;
+	Program prog;
+	const Instruction * const snap = snapload(out, SNAPSHOT, &size);
+	if (snap != NULL && size % sizeof(Instruction) == 0) {
+		prog.instr = snap;
+		prog.ninstr = size / sizeof(Instruction);
+	} else if (parse(in, l)) {
+		prog.instr = l->instr;
+		prog.ninstr = l->ninstr;
+		snapsave(out,
+		         SNAPSHOT,
+		         l->instr,
+		         l->ninstr * sizeof(Instruction));
+	} else {
 		return EXIT_FAILURE;
 	}
+	parsed(out);
+	const Program * const p = &prog;
 	intmax_t acc = 0;
-	if (subsrun(SIZE_MAX, &acc) != LOOPED) {
+	const RunResult result = subsrun(p, SIZE_MAX, &acc);
+	if (runfailed(result, SIZE_MAX)) {
+		return EXIT_FAILURE;
+	} else if (result != LOOPED) {
 		fputs("Program was supposed to loop but didn't\n", stderr);
 		return EXIT_FAILURE;
 	}
-	printf("Loop\t%jd\n", acc);
-	for (size_t i = 0; i < ninstr; i++) {
-		acc = 0;
-		const RunResult result = subsrun(i, &acc);
-		if (result == NO_RUN) {
-			continue;
-		} else if (result == TERMINATED) {
-			printf("No loop\t%jd\n", acc);
-			return EXIT_SUCCESS;
-		}
-	}
-	fputs("All substitutions loop\n", stderr);
-	return EXIT_FAILURE;
+	answerint(out, 0, "Loop", acc);
+	Search search = {
+		.p = p,
+		.result = malloc(p->ninstr * sizeof(RunResult)),
+		.acc = malloc(p->ninstr * sizeof(intmax_t))
+	};
+	int status = EXIT_FAILURE;
+	if (search.result == NULL || search.acc == NULL)
+		fputs("Could not allocate search\n", stderr);
+	else
+		status = searchwaves(&search, out);
+	free(search.result);
+	free(search.acc);
+	return status;
+}
+
+int
+day08(Input * const in, AdventResult * const out)
+{
+	Listing l = { .instr = NULL, .cinstr = 0, .ninstr = 0 };
+	const int res = solve(in, &l, out);
+	free(l.instr);
+	return res;
 }
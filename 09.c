@@ -5,11 +5,16 @@
  * To Public License, Version 2, as published by Sam Hocevar. See
  * http://www.wtfpl.net/ for more details.
  */
-#include <errno.h>
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
 
 static bool
 hasproperty(const uint64_t *const num, const size_t n)
@@ -22,53 +27,51 @@ hasproperty(const uint64_t *const num, const size_t n)
 	return found;
 }
 
-static void
+static bool
 addnum(uintmax_t ** const num, size_t * const restrict c, const size_t n)
 {
 	if (n < *c)
-		return;
+		return true;
 	if (*c >= SIZE_MAX / 2) {
 		fprintf(stderr, "Doubling %zu causes wraparound\n", *c);
-		free(*num);
-		exit(EXIT_FAILURE);
+		return false;
 	}
 	*c = *c > 0? 2 * *c : 1;
 	uintmax_t * const new = realloc(*num, *c * sizeof(uintmax_t));
 	if (new == NULL) {
 		fprintf(stderr, "Failed to allocate array of size %zu\n", *c);
-		free(*num);
-		exit(EXIT_FAILURE);
+		return false;
 	}
 	*num = new;
+	return true;
 }
 
 int
-day09(FILE * const in)
+day09(Input * const in, AdventResult * const out)
 {
 	uintmax_t *num = NULL, invalid = 0;
 	size_t n = 0, c = 0;
-	while (!feof(in) && !ferror(in)) {
+	inspace(in);
+	while (!ineof(in)) {
 		uintmax_t input;
-		int next;
-		if (fscanf(in, "%ju", &input) == 1) {
-			addnum(&num, &c, n);
-			num[n] = input;
-			if (n >= 25 && !hasproperty(num, n) && invalid == 0) {
-				invalid = num[n];
-				printf("Invalid\t%ju\n", num[n]);
-			}
-			n++;
-		} else if ((next = fgetc(in)) != '\n' && next != EOF) {
+		if (!inuint(in, &input)) {
 			fprintf(stderr, "Bad input format\n");
 			free(num);
 			return EXIT_FAILURE;
 		}
+		if (!addnum(&num, &c, n)) {
+			free(num);
+			return EXIT_FAILURE;
+		}
+		num[n] = input;
+		if (n >= 25 && !hasproperty(num, n) && invalid == 0) {
+			invalid = num[n];
+			answeruint(out, 0, "Invalid", num[n]);
+		}
+		n++;
+		inspace(in);
 	}
-	if (!feof(in) || ferror(in)) {
-		fputs("Puzzle input parsing failed\n", stderr);
-		free(num);
-		return EXIT_FAILURE;
-	} else if (n < 25) {
+	if (n < 25) {
 		fprintf(stderr, "Need at least 25 numbers, got %zu\n", n);
 		free(num);
 		return EXIT_FAILURE;
@@ -77,6 +80,7 @@ day09(FILE * const in)
 		free(num);
 		return EXIT_FAILURE;
 	}
+	parsed(out);
 	for (size_t i = 0; i < n - 2; i++) {
 		uintmax_t sum = num[i], min = num[i], max = num[i];
 		for (size_t j = i + 1; j < n - 1; j++) {
@@ -87,7 +91,7 @@ day09(FILE * const in)
 			sum += num[j];
 			if (sum != invalid)
 				continue;
-			printf("Weak\t%ju\n", min + max);
+			answeruint(out, 1, "Weak", min + max);
 			free(num);
 			return EXIT_SUCCESS;
 		}
@@ -5,12 +5,17 @@
  * To Public License, Version 2, as published by Sam Hocevar. See
  * http://www.wtfpl.net/ for more details.
  */
-#include <errno.h>
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+
 static int
 compumax(const void *x, const void *y)
 {
@@ -23,45 +28,52 @@ compumax(const void *x, const void *y)
 	return 0;
 }
 
-static void
+static bool
 resizearr(uintmax_t ** restrict jolts, size_t * restrict c, const size_t n)
 {
 	if (n < *c)
-		return;
+		return true;
 	if (*c >= SIZE_MAX / 2) {
 		fprintf(stderr, "Doubling %zu causes wraparound\n", *c);
-		free(*jolts);
-		exit(EXIT_FAILURE);
+		return false;
 	}
 	*c = *c > 0? 2 * *c : 1;
 	uintmax_t * const new = realloc(*jolts, *c * sizeof(uintmax_t));
 	if (new == NULL) {
 		fprintf(stderr, "Could not resize array to %zu\n", *c);
-		free(*jolts);
-		exit(EXIT_FAILURE);
+		return false;
 	}
 	*jolts = new;
+	return true;
 }
 
 int
-day10(FILE * const in)
+day10(Input * const in, AdventResult * const out)
 {
 	uintmax_t *jolts = NULL, input;
 	size_t num = 0, cap = 0;
-	while (fscanf(in, "%ju", &input) == 1) {
-		resizearr(&jolts, &cap, num);
+	inspace(in);
+	while (inuint(in, &input)) {
+		if (!resizearr(&jolts, &cap, num)) {
+			free(jolts);
+			return EXIT_FAILURE;
+		}
 		jolts[num++] = input;
-		const int next = fgetc(in);
-		if (next != '\n' && next != EOF)
+		if (!ineol(in))
 			break;
+		inspace(in);
 	}
-	if (!feof(in) || ferror(in)) {
+	if (!ineof(in) || num == 0) {
 		fputs("Puzzle input parsing failed\n", stderr);
 		free(jolts);
 		return EXIT_FAILURE;
 	}
+	parsed(out);
 	qsort(jolts, num, sizeof(uintmax_t), compumax);
-	resizearr(&jolts, &cap, num);
+	if (!resizearr(&jolts, &cap, num)) {
+		free(jolts);
+		return EXIT_FAILURE;
+	}
 	jolts[num] = jolts[num - 1] + 3;
 	uintmax_t jump1 = 0, jump3 = 0;
 	for (size_t i = 0; i + 1 < num; i++) {
@@ -75,7 +87,7 @@ day10(FILE * const in)
 	if (jolts[0] == 3)
 		jump3++;
 	jump3++;
-	printf("Part 1\t%ju\n", jump1 * jump3);
+	answeruint(out, 0, "Part 1", jump1 * jump3);
 	uintmax_t ways[num + 1];
 	memset(ways, 0, (num + 1) * sizeof(uintmax_t));
 	for (size_t i = 0; i < num + 1; i++) {
@@ -85,6 +97,6 @@ day10(FILE * const in)
 			ways[i] += ways[j];
 	}
 	free(jolts);
-	printf("Part 2\t%ju\n", ways[num]);
+	answeruint(out, 1, "Part 2", ways[num]);
 	return EXIT_SUCCESS;
 }
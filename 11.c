@@ -5,257 +5,237 @@
  * To Public License, Version 2, as published by Sam Hocevar. See
  * http://www.wtfpl.net/ for more details.
  */
-#include <errno.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-enum { HAS_SEAT = 1, SEATING = 2, WILL_SEAT = 4 };
-
-struct Node {
-	uint64_t *line;
-	struct Node *prev, *next;
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+#include "grid.h"
+#include "life.h"
+
+/* Directions people look toward */
+static const ptrdiff_t directions[8][2] = {
+	{ -1, -1 }, { 0, -1 }, { 1, -1 }, { -1, 0 },
+	{ 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 }
 };
 
-typedef struct Node Node;
+/*
+ * Seats and floor of the area, with room for the seats seen from each cell.
+ * For each direction and each of `rounds` powers of two, at least one,
+ * `ladder` holds the cells from which that many cells in the direction are
+ * all floor.
+ */
+typedef struct {
+	Grid seat, floor, seen, step;
+	Grid *ladder;
+	size_t rounds;
+} Seating;
 
-static Node *head = NULL;
+/* Grids a Seating holds besides its ladder */
+#define SEATING_GRIDS 4
 
+/* Width of the first line and number of lines, the last one even unended */
 static void
-freelist(void)
+measure(const Input * const in,
+        size_t * const restrict width,
+        size_t * const restrict height)
 {
-	while (head != NULL) {
-		free(head->line);
-		Node * const temp = head->next;
-		free(head);
-		head = temp;
-	}
+	const char *p = in->p;
+	while (p < in->end && *p != '\n')
+		p++;
+	*width = p - in->p;
+	*height = in->p < in->end && in->end[-1] != '\n';
+	for (p = in->p; p < in->end; p++)
+		*height += *p == '\n';
 }
 
 static bool
-hasflag(const uint64_t * const line, const uint64_t flag, const size_t i)
-{
-	return (line[i / 21] & (flag << (3 * (i % 21)))) != 0;
-}
-
-static void
-setflag(uint64_t * const line, const uint64_t flag, const size_t i)
+allocseating(Seating * const s, const size_t width, const size_t height)
 {
-	line[i / 21] |= flag << (3 * (i % 21));
-}
-
-static void
-unsetflag(uint64_t * const line, const uint64_t flag, const size_t i)
-{
-	line[i / 21] &= ~(flag << (3 * (i % 21)));
+	s->rounds = 1;
+	while (((size_t) 1 << s->rounds) < width
+	       || ((size_t) 1 << s->rounds) < height)
+		s->rounds++;
+	const size_t n = SEATING_GRIDS + 8 * s->rounds;
+	const size_t words = gridwords(width, height);
+	uint64_t * const w = words > 0 && n <= SIZE_MAX / words
+	                     ? malloc(n * words * sizeof(uint64_t)) : NULL;
+	s->ladder = malloc(8 * s->rounds * sizeof(Grid));
+	if (w == NULL || s->ladder == NULL) {
+		perror("Could not allocate seats");
+		free(w);
+		free(s->ladder);
+		s->ladder = NULL;
+		return false;
+	}
+	Grid * const grid[SEATING_GRIDS] = {
+		&s->seat, &s->floor, &s->seen, &s->step
+	};
+	for (size_t i = 0; i < n; i++) {
+		Grid * const g = i < SEATING_GRIDS? grid[i]
+		                 : &s->ladder[i - SEATING_GRIDS];
+		gridinit(g, w + i * words, width, height);
+	}
+	return true;
 }
 
 static void
-dupflag(uint64_t * const line, uint64_t dest, uint64_t src, const size_t i)
-{
-	uint64_t pattern = line[i / 21] & (src << (3 * (i % 21)));
-	if (pattern == 0)
-		line[i / 21] &= ~(dest << (3 * (i % 21)));
-	else
-		line[i / 21] |= dest << (3 * (i % 21));
-}
-
-static uint8_t
-iteradjother(const Node * const other, const size_t i, const size_t width)
+freeseating(Seating * const s)
 {
-	if (other == NULL)
-		return 0;
-	uint8_t neighbors = 0;
-	for (size_t j = (i > 0) * (i - 1); (j <= i + 1) & (j < width); j++) {
-		if (hasflag(other->line, SEATING, j))
-			neighbors++;
-	} 
-	return neighbors;
+	if (s->ladder != NULL)
+		free(s->seat.w);
+	free(s->ladder);
 }
 
 static bool
-treatadj(const Node *const node, const size_t width, const size_t i)
+parse(Input * const restrict in, Seating * const restrict s)
 {
-	if (!hasflag(node->line, HAS_SEAT, i))
+	size_t width, height;
+	measure(in, &width, &height);
+	if (width == 0) {
+		fputs("Puzzle input parsing failed\n", stderr);
 		return false;
-	uint8_t neighbors = iteradjother(node->prev, i, width)
-	                    + iteradjother(node->next, i, width);
-	if (i > 0 && hasflag(node->line, SEATING, i - 1))
-		neighbors++;
-	if (i < width - 1 && hasflag(node->line, SEATING, i + 1))
-		neighbors++;
-	if (!hasflag(node->line, SEATING, i) && neighbors == 0) {
-		setflag(node->line, WILL_SEAT, i);
-		return true;
-	} else if (hasflag(node->line, SEATING, i) && neighbors >= 4) {
-		unsetflag(node->line, WILL_SEAT, i);
-		return true;
-	}
-	return false;
-}
-
-static bool
-iteradjacent(const size_t width)
-{
-	bool changed = false;
-	for (Node *node = head; node != NULL; node = node->next) {
-		for (size_t i = 0; i < width; i++)
-			changed |= treatadj(node, width, i);
 	}
-	for (Node *node = head; node != NULL; node = node->next) {
-		for (size_t i = 0; i < width; i++)
-			dupflag(node->line, SEATING, WILL_SEAT, i);
-	}
-	return changed;
-}
-
-static bool
-lookdirection(const Node * const node,
-              const size_t width,
-              const size_t i,
-              const int8_t vdir,
-              const int8_t hdir)
-{
-	const Node *other = node;
-	size_t j = i;
-	for (;;) {
-		if (vdir > 0)
-			other = other->next;
-		else if (vdir < 0)
-			other = other->prev;
-		if (other == NULL || (j == 0 && hdir < 0) || j + hdir >= width)
+	if (!allocseating(s, width, height))
+		return false;
+	for (size_t y = 0; y < height; y++) {
+		const Span input = inuntil(in, '\n');
+		if (input.len == 0) {
+			fputs("Puzzle input parsing failed\n", stderr);
+			return false;
+		} else if (input.len != width) {
+			fputs("Inconsistent input width\n", stderr);
 			return false;
-		j += hdir;
-		if (hasflag(other->line, HAS_SEAT, j))
-			return hasflag(other->line, SEATING, j);
+		}
+		for (size_t x = 0; x < width; x++) {
+			if (input.s[x] == 'L') {
+				gridset(&s->seat, x, y, true);
+			} else if (input.s[x] == '.') {
+				gridset(&s->floor, x, y, true);
+			} else {
+				fprintf(stderr,
+				        "Unexpected character: %c\n",
+				        input.s[x]);
+				return false;
+			}
+		}
+		ineol(in);
 	}
+	return true;
 }
 
-static uint8_t
-lookaround(const Node * const node, const size_t width, const size_t i)
+/* Steps of the ladder double: each is the last one and the last one moved */
+static void
+buildladder(Seating * const s)
 {
-	uint8_t seen = 0;
-	for (int8_t dx = -1; dx <= 1; dx++) {
-		for (int8_t dy = -1; dy <= 1; dy++) {
-			if (dx == 0 && dy == 0)
+	for (size_t d = 0; d < 8; d++) {
+		const ptrdiff_t dx = directions[d][0], dy = directions[d][1];
+		Grid * const ladder = &s->ladder[d * s->rounds];
+		for (size_t k = 0; k < s->rounds; k++) {
+			if (k == 0) {
+				gridshift(&ladder[0], &s->floor, -dx, -dy);
 				continue;
-			if (lookdirection(node, width, i, dy, dx))
-				seen++;
+			}
+			const ptrdiff_t far = (ptrdiff_t) 1 << (k - 1);
+			gridshift(&ladder[k],
+			          &ladder[k - 1],
+			          -dx * far,
+			          -dy * far);
+			gridand(&ladder[k], &ladder[k], &ladder[k - 1]);
 		}
 	}
-	return seen;
 }
 
-static bool
-treatseen(const Node * const node, const size_t width, const size_t i)
+/*
+ * In each direction, a cell sees an occupied seat if the next cell is one, or
+ * if the next cell is floor from which one is seen. Cells seeing one within a
+ * distance are known for twice that distance once those which see one from as
+ * far, across floor all along, are added: the ladder says how far each cell
+ * sees across floor.
+ */
+static void
+countseen(void * const arg,
+          const Grid * const occupied,
+          Grid count[],
+          const size_t planes)
 {
-	if (!hasflag(node->line, HAS_SEAT, i))
-		return false;;
-	const uint8_t seen = lookaround(node, width, i);
-	if (!hasflag(node->line, SEATING, i) && seen == 0) {
-		setflag(node->line, WILL_SEAT, i);
-		return true;
-	} else if (hasflag(node->line, SEATING, i) && seen >= 5) {
-		unsetflag(node->line, WILL_SEAT, i);
-		return true;
+	Seating * const s = arg;
+	for (size_t d = 0; d < 8; d++) {
+		const ptrdiff_t dx = directions[d][0], dy = directions[d][1];
+		const Grid * const ladder = &s->ladder[d * s->rounds];
+		gridshift(&s->seen, occupied, -dx, -dy);
+		for (size_t k = 0; k < s->rounds; k++) {
+			const ptrdiff_t far = (ptrdiff_t) 1 << k;
+			gridshift(&s->step, &s->seen, -dx * far, -dy * far);
+			gridand(&s->step, &s->step, &ladder[k]);
+			gridor(&s->seen, &s->seen, &s->step);
+		}
+		gridadd(count, planes, &s->seen, 0, 0);
 	}
-	return false;
 }
 
+/*
+ * People sit on seats with no occupied one around and leave those with more
+ * than `tolerance` around, all at once, until no one moves. Everyone sits at
+ * first, as no seat is occupied yet.
+ */
 static bool
-iterseen(const size_t width)
+settle(Seating * const restrict s,
+       Life * const restrict l,
+       const unsigned tolerance,
+       uintmax_t * const restrict occupied)
 {
-	bool changed = false;
-	for (Node *node = head; node != NULL; node = node->next) {
-		for (size_t i = 0; i < width; i++) {
-			if (treatseen(node, width, i))
-				changed = true;
-		}
-	}
-	for (Node *node = head; node != NULL; node = node->next) {
-		for (size_t i = 0; i < width; i++)
-			dupflag(node->line, SEATING, WILL_SEAT, i);
-	}
-	return changed;
+	l->rule = (LifeRule) {
+		.bornlo = 0,
+		.bornhi = 0,
+		.staylo = 0,
+		.stayhi = tolerance
+	};
+	l->mask = &s->seat;
+	const bool ok = lifeinit(l, &s->seat) && liferun(l, UINTMAX_MAX);
+	if (ok)
+		*occupied = lifepopcount(l);
+	lifefree(l);
+	return ok;
 }
 
-static uintmax_t
-countoccupied(const size_t width)
+static int
+solve(Input * const restrict in,
+      Seating * const restrict s,
+      AdventResult * const restrict out)
 {
-	uintmax_t occupied = 0;
-	for (Node *node = head; node != NULL; node = node->next) {
-		for (size_t i = 0; i < width; i++) {
-			if (hasflag(node->line, SEATING, i))
-				occupied++;
-		}
-	}
-	return occupied;
+	if (!parse(in, s))
+		return EXIT_FAILURE;
+	parsed(out);
+	uintmax_t occupied;
+	Life adjacent = { .topology = LIFE_SQUARE };
+	if (!settle(s, &adjacent, 3, &occupied))
+		return EXIT_FAILURE;
+	answeruint(out, 0, "Adj", occupied);
+	buildladder(s);
+	Life seen = {
+		.topology = LIFE_GRAPH,
+		.count = countseen,
+		.arg = s,
+		.degree = 8
+	};
+	if (!settle(s, &seen, 4, &occupied))
+		return EXIT_FAILURE;
+	answeruint(out, 1, "Seen", occupied);
+	return EXIT_SUCCESS;
 }
 
 int
-day11(FILE * const in)
+day11(Input * const in, AdventResult * const out)
 {
-	if (atexit(freelist) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
-	Node *tail = NULL;
-	size_t width = 0;
-	char *input;
-	while (fscanf(in, "%m[.L]", &input) == 1) {
-		if (width == 0) {
-			width = strlen(input);
-		} else if (strlen(input) != width) {
-			fputs("Inconsistent input width\n", stderr);
-			free(input);
-			return EXIT_FAILURE;
-		}
-		uint64_t *line = malloc((width / 21 + 1) * sizeof(uint64_t));
-		if (line == NULL) {
-			perror("Could not allocate node line");
-			free(input);
-			return EXIT_FAILURE;
-		}
-		memset(line, 0, (width / 21 + 1) * sizeof(uint64_t));
-		for (size_t i = 0; i < width; i++) {
-			if (input[i] == 'L')
-				line[i / 21] |= ((uint64_t) HAS_SEAT)
-				                << (3 * (i % 21));
-		}
-		free(input);
-		Node * const new = malloc(sizeof(Node));
-		if (new == NULL) {
-			perror("Could not allocate new node");
-			free(line);
-			return EXIT_FAILURE;
-		}
-		new->line = line;
-		new->next = NULL;
-		if (head == NULL) {
-			head = new;
-			new->prev = NULL;
-		} else {
-			tail->next = new;
-			new->prev = tail;
-		}
-		tail = new;
-		const int next = fgetc(in);
-		if (next != '\n' && next != EOF) {
-			fprintf(stderr, "Unexpected character: %c\n", next);
-			return EXIT_FAILURE;
-		}
-	}
-	if (!feof(in) || ferror(in)) {
-		fputs("Puzzle input parsing failed\n", stderr);
-		return EXIT_FAILURE;
-	}
-	while (iteradjacent(width));
-	printf("Adj\t%ju\n", countoccupied(width));
-	for (Node *node = head; node != NULL; node = node->next) {
-		for (size_t i = 0; i < width; i++)
-			unsetflag(node->line, SEATING | WILL_SEAT, i);
-	}
-	while(iterseen(width));
-	printf("Seen\t%ju\n", countoccupied(width));
-	return EXIT_SUCCESS;
+	Seating s = { .ladder = NULL };
+	const int result = solve(in, &s, out);
+	freeseating(&s);
+	return result;
 }
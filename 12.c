@@ -5,10 +5,16 @@
  * To Public License, Version 2, as published by Sam Hocevar. See
  * http://www.wtfpl.net/ for more details.
  */
-#include <errno.h>
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
 
 #define ABS(x) ((x >= 0)? x : -x)
 
@@ -26,65 +32,102 @@ rcos(const uintmax_t n)
 	return (n % 2 == 0) * (((n % 4 == 0) << 1) - 1);
 }
 
-int
-day12(FILE * const in)
+typedef struct {
+	intmax_t xa, ya, xb, yb, xw, yw;
+	Direction dir;
+} Ship;
+
+static bool
+begin(void * const state, AdventResult * const out)
+{
+	(void) out;
+	Ship * const s = state;
+	s->xw = 10;
+	s->yw = 1;
+	s->dir = EAST;
+	return true;
+}
+
+static bool
+fold(void * const state, Input * const in)
 {
-	intmax_t xa = 0, ya = 0, xb = 0, yb = 0, xw = 10, yw = 1, value;
-	Direction dir = EAST;
-	char action;
-	while (fscanf(in, "%1c%ju", &action, &value) == 2) {
+	Ship * const s = state;
+	intmax_t value;
+	while (!ineof(in)) {
+		const int action = inget(in);
+		if (!inint(in, &value)) {
+			fputs("Puzzle input parsing failed\n", stderr);
+			return false;
+		}
 		const uintmax_t a = value / 90;
 		intmax_t nxw;
 		switch (action) {
 		case 'N':
-			ya += value;
-			yw += value;
+			s->ya += value;
+			s->yw += value;
 			break;
 		case 'S':
-			ya -= value;
-			yw -= value;
+			s->ya -= value;
+			s->yw -= value;
 			break;
 		case 'E':
-			xa += value;
-			xw += value;
+			s->xa += value;
+			s->xw += value;
 			break;
 		case 'W':
-			xa -= value;
-			xw -= value;
+			s->xa -= value;
+			s->xw -= value;
 			break;
 		case 'L':
-			dir = (dir + a) % 4;
-			nxw = xw * rcos(a) - yw * rsin(a);
-			yw = xw * rsin(a) + yw * rcos(a);
-			xw = nxw;
+			s->dir = (s->dir + a) % 4;
+			nxw = s->xw * rcos(a) - s->yw * rsin(a);
+			s->yw = s->xw * rsin(a) + s->yw * rcos(a);
+			s->xw = nxw;
 			break;
 		case 'R':
-			dir = (dir - a) % 4;
-			nxw = xw * rcos(a) + yw * rsin(a);
-			yw = -xw * rsin(a) + yw * rcos(a);
-			xw = nxw;
+			s->dir = (s->dir - a) % 4;
+			nxw = s->xw * rcos(a) + s->yw * rsin(a);
+			s->yw = -s->xw * rsin(a) + s->yw * rcos(a);
+			s->xw = nxw;
 			break;
 		case 'F':
-			xa += value * rcos(dir);
-			ya += value * rsin(dir);
-			xb += value * xw;
-			yb += value * yw;
+			s->xa += value * rcos(s->dir);
+			s->ya += value * rsin(s->dir);
+			s->xb += value * s->xw;
+			s->yb += value * s->yw;
 			break;
 		default:
 			fprintf(stderr, "Invalid action: %c\n", action);
-			return EXIT_FAILURE;
+			return false;
 		}
-		const int next = fgetc(in);
-		if (next != '\n' && next != EOF) {
-			fprintf(stderr, "Unexpected character: %c\n", next);
-			return EXIT_FAILURE;
+		if (!ineol(in)) {
+			fprintf(stderr, "Unexpected character: %c\n", *in->p);
+			return false;
 		}
 	}
-	if (!feof(in) || ferror(in)) {
-		fputs("Puzzle input parsing failed\n", stderr);
-		return EXIT_FAILURE;
-	}
-	printf("Move\t%jd\n", ABS(xa) + ABS(ya));
-	printf("Waypt\t%jd\n", ABS(xb) + ABS(yb));
+	return true;
+}
+
+static int
+finish(void * const state, AdventResult * const out)
+{
+	const Ship * const s = state;
+	answerint(out, 0, "Move", ABS(s->xa) + ABS(s->ya));
+	answerint(out, 1, "Waypt", ABS(s->xb) + ABS(s->yb));
 	return EXIT_SUCCESS;
 }
+
+const Stream stream12 = {
+	.sep = "\n",
+	.size = sizeof(Ship),
+	.begin = begin,
+	.fold = fold,
+	.finish = finish,
+	.release = NULL
+};
+
+int
+day12(Input * const in, AdventResult * const out)
+{
+	return foldinput(&stream12, in, out);
+}
@@ -5,9 +5,16 @@
  * To Public License, Version 2, as published by Sam Hocevar. See
  * http://www.wtfpl.net/ for more details.
  */
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
 
 struct Node {
 	uintmax_t rem, div;
@@ -16,8 +23,6 @@ struct Node {
 
 typedef struct Node Node;
 
-static Node *head = NULL;
-
 static uintmax_t
 xgcd(const intmax_t a,
      const intmax_t b,
@@ -78,105 +83,86 @@ addmod(const uintmax_t x, const uintmax_t y, const uintmax_t n)
 	return ((x % n) + (y % n)) % n;
 }
 
-static void
-retryinput(FILE * const restrict in, uintmax_t * const restrict rem)
-{
-	if (ferror(in)) {
-		fputs("Internal error occured during input parsing\n", stderr);
-		exit(EXIT_FAILURE);
-	}
-	char c[2];
-	const size_t res = fread(c, sizeof(char), 2, in);
-	if (res < 2 && (!feof(in) || ferror(in))) {
-		fputs("Error occured while reading puzzle input\n", stderr);
-		exit(EXIT_FAILURE);
-	} else if (c[0] != 'x' || (res == 2 && c[1] != ',' && c[1] != '\n')) {
-		fputs("Bad puzzle input format\n", stderr);
-		exit(EXIT_FAILURE);
-	}
-	(*rem)++;
-}
-
-static const Node *
-parseids(FILE * const restrict in,
+static bool
+parseids(Input * const restrict in,
+         Arena * const restrict arena,
+         Node ** const restrict headref,
+         Node ** const restrict tailref,
          uintmax_t * restrict rem,
          const uintmax_t mindep,
          uintmax_t * restrict bestdep,
          uintmax_t * restrict bestbus)
 {
 	Node *tail = NULL;
-	while (!feof(in) && !ferror(in)) {
+	while (!ineof(in)) {
 		uintmax_t bus;
-		if (fscanf(in, "%ju", &bus) < 1) {
-			if (feof(in) || ferror(in))
-				break;
-			retryinput(in, rem);
-			continue;
-		}
-		if (bus == 0) {
+		if (inchar(in, 'x')) {
+			(*rem)++;
+			bus = 0;
+		} else if (!inuint(in, &bus)) {
+			fputs("Bad puzzle input format\n", stderr);
+			return false;
+		} else if (bus == 0) {
 			fputs("Bus has id 0\n", stderr);
-			exit(EXIT_FAILURE);
+			return false;
+		}
+		const int next = inget(in);
+		if (next != ',' && next != '\n' && next != EOF) {
+			fprintf(stderr, "Unexpected character: %c\n", next);
+			return false;
+		} else if (bus == 0) {
+			continue;
 		}
 		uintmax_t departs = bus * (mindep / bus + (mindep % bus != 0));
 		if (*bestdep == 0 || departs < *bestdep) {
 			*bestbus = bus;
 			*bestdep = departs;
 		}
-		Node * const node = malloc(sizeof(Node));
+		Node * const node = aralloc(arena, sizeof(Node));
 		if (node == NULL) {
 			fputs("Could not allocate new node\n", stderr);
-			exit(EXIT_FAILURE);
+			return false;
 		}
 		node->rem = (bus - ((*rem)++ % bus)) % bus;
 		node->div = bus;
 		node->next = NULL;
-		if (head == NULL)
-			head = node;
+		if (*headref == NULL)
+			*headref = node;
 		else
 			tail->next = node;
 		tail = node;
-		const int next = fgetc(in);
-		if (next != ',' && next != '\n' && next != EOF) {
-			fprintf(stderr, "Unexpected character: %c\n", next);
-			exit(EXIT_FAILURE);
-		}
-	}
-	if (!feof(in) || ferror(in)) {
-		fputs("Error occured while parsing puzzle input\n", stderr);
-		exit(EXIT_FAILURE);
-	}
-	return tail;
-}
-
-static void
-freelist(void)
-{
-	while (head != NULL) {
-		Node * const temp = head->next;
-		free(head);
-		head = temp;
 	}
+	*tailref = tail;
+	return true;
 }
 
 int
-day13(FILE * const in)
+day13(Input * const in, AdventResult * const out)
 {
-	if (atexit(freelist) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
 	uintmax_t mindep;
-	if (fscanf(in, "%ju", &mindep) != 1 || fgetc(in) != '\n') {
+	if (!inuint(in, &mindep) || !inchar(in, '\n')) {
 		fputs("Could not parse earliest timestamp\n", stderr);
 		return EXIT_FAILURE;
 	}
 	uintmax_t bestbus, bestdep = 0, rem = 0;
-	const Node * const tail = parseids(in, &rem, mindep, &bestdep, &bestbus);
+	Node *head = NULL, *tail;
+	if (!parseids(in,
+	              scratch(out),
+	              &head,
+	              &tail,
+	              &rem,
+	              mindep,
+	              &bestdep,
+	              &bestbus))
+		return EXIT_FAILURE;
+	parsed(out);
 	if (bestdep == 0) {
 		fputs("No bus found\n", stderr);
 		return EXIT_FAILURE;
 	}
-	printf("Product\t%ju\n", bestbus * (bestdep - mindep));
+	answeruint(out, 0, "Product", bestbus * (bestdep - mindep));
 	while (head != tail) {
-		Node * const a = head, * const b = head->next;
+		Node * const a = head, * const b = a->next;
 		intmax_t m[2];
 		if (xgcd(a->div, b->div, m, m + 1) != 1)
 			fputs("Divisors are not coprime\n", stderr);
@@ -185,9 +171,8 @@ day13(FILE * const in)
 		                mulmod(b->rem, posmod(m[0], n), a->div, n),
 		                n);
 		b->div *= a->div;
-		free(a);
 		head = b;
 	}
-	printf("Chinese\t%ju\n", head->rem);
+	answeruint(out, 1, "Chinese", tail->rem);
 	return EXIT_SUCCESS;
 }
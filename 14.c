@@ -9,6 +9,12 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
 
 /* Linked list took ~15 s; binary tree takes ~50 ms */
 struct Node {
@@ -18,99 +24,75 @@ struct Node {
 
 typedef struct Node Node;
 
-static Node *head;
-
-static void
-freetree(Node *node)
-{
-	if (node == NULL)
-		return;
-	freetree(node->left);
-	freetree(node->right);
-	free(node);
-}
-
-/* Consumes the tree; this saves a couple ms */
 static uintmax_t
-sumtree(Node * const node)
+sumtree(const Node * const node)
 {
 	if (node == NULL)
 		return 0;
-	uintmax_t sum = node->val + sumtree(node->left) + sumtree(node->right);
-	free(node->left);
-	free(node->right);
-	node->left = node->right = NULL;
-	return sum;
+	return node->val + sumtree(node->left) + sumtree(node->right);
 }
 
-static void
-addnode(const uint_fast64_t addr, const uint_fast64_t val)
+static bool
+addnode(Arena * const restrict arena,
+        Node ** restrict it,
+        const uint_fast64_t addr,
+        const uint_fast64_t val)
 {
-	Node * const node = malloc(sizeof(Node));
+	while (*it != NULL) {
+		if (addr == (*it)->addr) {
+			(*it)->val = val;
+			return true;
+		}
+		it = addr < (*it)->addr? &(*it)->left : &(*it)->right;
+	}
+	Node * const node = aralloc(arena, sizeof(Node));
 	if (node == NULL) {
 		fputs("Could not allocate new node\n", stderr);
-		exit(EXIT_FAILURE);
+		return false;
 	}
 	node->addr = addr;
 	node->val = val;
 	node->left = NULL;
 	node->right = NULL;
-	if (head == NULL) {
-		head = node;
-		return;
-	}
-	Node *it = head;
-	for (;;) {
-		if (addr == it->addr) {
-			it->val = val;
-			free(node);
-			return;
-		} else if (addr < it->addr) {
-			if (it->left == NULL) {
-				it->left = node;
-				return;
-			} else {
-				it = it->left;
-			}
-		} else {
-			if (it->right == NULL) {
-				it->right = node;
-				return;
-			} else {
-				it = it->right;
-			}
-		}
-	}
+	*it = node;
+	return true;
 }
 
-static void
-floataddr(uint_fast64_t addr,
+static bool
+floataddr(Arena * const restrict arena,
+          Node ** const restrict head,
+          uint_fast64_t addr,
           const bool *floating,
           uint_fast8_t bit,
           uint_fast64_t val)
 {
-	if (bit >= 36) {
-		addnode(addr, val);
-	} else if (!floating[bit]) {
-		floataddr(addr, floating, bit + 1, val);
-	} else {
-		addr &= ~(UINT64_C(1) << bit);
-		floataddr(addr, floating, bit + 1, val);
-		addr |= UINT64_C(1) << bit;
-		floataddr(addr, floating, bit + 1, val);
-	}
+	if (bit >= 36)
+		return addnode(arena, head, addr, val);
+	if (!floating[bit])
+		return floataddr(arena, head, addr, floating, bit + 1, val);
+	addr &= ~(UINT64_C(1) << bit);
+	if (!floataddr(arena, head, addr, floating, bit + 1, val))
+		return false;
+	addr |= UINT64_C(1) << bit;
+	return floataddr(arena, head, addr, floating, bit + 1, val);
 }
 
-static void
-runmeminstr(const char input[restrict 48],
+static bool
+runmeminstr(Arena * const restrict arena,
+            Node ** const restrict head,
+            Input * const restrict line,
             uint_fast64_t mem[restrict 65536],
             uint_fast64_t mask)
 {
-	uint_fast64_t addr, val;
-	if (sscanf(input, "mem[%" SCNuFAST64 "] = %" SCNuFAST64, &addr, &val)
-	    != 2) {
-		fprintf(stderr, "Bad input format: %s\n", input);
-		exit(EXIT_FAILURE);
+	const char * const begin = line->p;
+	uintmax_t addr, val;
+	if (!inlit(line, "mem[") || !inuint(line, &addr) || addr >= 65536
+	    || !inlit(line, "] = ") || !inuint(line, &val) || !ineof(line)) {
+		fprintf(stderr,
+		        "Bad input format: %.*s\n",
+		        (int) (line->end - begin),
+		        begin);
+		return false;
 	}
 	uint_fast64_t modaddr = addr, modval = val;
 	bool floating[36] = { false };
@@ -125,66 +107,54 @@ runmeminstr(const char input[restrict 48],
 		}
 		mask /= 3;
 	}
-	floataddr(modaddr, floating, 0, val);
 	mem[addr] = modval;
+	return floataddr(arena, head, modaddr, floating, 0, val);
 }
 
+/* Leaves the line untouched unless it is a mask */
 static bool
-runmaskinstr(const char input[restrict 48],
+runmaskinstr(Input * const restrict line,
              uint_fast64_t * const restrict mask)
 {
-	int n;
-	sscanf(input, "mask = %*36[01X]%n", &n);
-	if (n != 43)
+	Input l = *line;
+	if (!inlit(&l, "mask = ") || l.end - l.p != 36)
 		return false;
 	uint_fast64_t nmask = 0;
 	for (uint_fast8_t i = 0; i < 36; i++) {
-		if (input[7 + i] == 0)
-			return false;
+		const char c = *l.p++;
 		nmask *= 3;
-		if ((input[7 + i] >> 1) == ('0' >> 1))
-			nmask += input[7 + i] - '0' + 1;
-	}
-	if (input[43] == 0) {
-		*mask = nmask;
-		return true;
+		if (c == '0' || c == '1')
+			nmask += c - '0' + 1;
+		else if (c != 'X')
+			return false;
 	}
-	return false;
-}
-
-static void
-freedata(void)
-{
-	freetree(head);
+	*mask = nmask;
+	*line = l;
+	return true;
 }
 
 int
-day14(FILE * const in)
+day14(Input * const in, AdventResult * const out)
 {
-	if (atexit(freedata) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
+	Arena * const arena = scratch(out);
+	Node *head = NULL;
 	uint_fast64_t mask = 0, mem[65536] = { 0 };
-	char input[48];
-	while (fscanf(in, "%47[^\n]", input) == 1) {
-		if (!runmaskinstr(input, &mask))
-			runmeminstr(input, mem, mask);
-		const int next = fgetc(in);
-		if (next != '\n' && next != EOF) {
-			fprintf(stderr, "Unexpected character: %c\n", next);
+	while (!ineof(in)) {
+		const Span s = inuntil(in, '\n');
+		Input line = { .p = s.s, .end = s.s + s.len };
+		if (!runmaskinstr(&line, &mask)
+		    && !runmeminstr(arena, &head, &line, mem, mask))
 			return EXIT_FAILURE;
-		}
-	}
-	if (!feof(in) || ferror(in)) {
-		fputs("Error occured while parsing puzzle input\n", stderr);
-		return EXIT_FAILURE;
+		ineol(in);
 	}
+	parsed(out);
 	uintmax_t sum = 0;
 	for (uint_fast32_t i = 0; i < 65536; i++) {
 		if (mem[i] > UINTMAX_MAX - sum)
 			fputs("Integer wraparound detected\n", stderr);
 		sum += mem[i];
 	}
-	printf("Ver 1\t%ju\n", sum);
-	printf("Ver 2\t%ju\n", sumtree(head));
+	answeruint(out, 0, "Ver 1", sum);
+	answeruint(out, 1, "Ver 2", sumtree(head));
 	return EXIT_SUCCESS;
 }
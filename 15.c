@@ -6,8 +6,15 @@
  * http://www.wtfpl.net/ for more details.
  */
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
 
 static uint_fast32_t
 playturn(uint_fast32_t num[UINT32_C(30000000)],
@@ -20,44 +27,45 @@ playturn(uint_fast32_t num[UINT32_C(30000000)],
 }
 
 int
-day15(FILE * const in)
+day15(Input * const in, AdventResult * const out)
 {
-	uint_fast32_t turn = 0, last = UINT_FAST32_MAX, input;
-	uint_fast32_t *num = malloc(UINT32_C(30000000) * sizeof(uint_fast32_t));
+	uint_fast32_t turn = 0, last = UINT_FAST32_MAX;
+	uintmax_t input;
+	/* Numbers are looked up at random, so their history is on huge pages */
+	uint_fast32_t * const num = bigtable(out,
+	                                     UINT32_C(30000000)
+	                                     * sizeof(uint_fast32_t));
 	if (num == NULL) {
 		fputs("Could not allocate the number history\n", stderr);
 		return EXIT_FAILURE;
 	}
 	for (uint_fast32_t i = 0; i < UINT32_C(30000000); i++)
 		num[i] = UINT_FAST32_MAX;
-	while (fscanf(in, "%" SCNuFAST32, &input) == 1) {
+	while (inuint(in, &input) && input < UINT32_C(30000000)) {
 		if (last != UINT_FAST32_MAX)
 			num[last] = turn;
 		last = input;
-		const int next = fgetc(in);
+		const int next = inget(in);
 		if (next != ',' && next != '\n' && next != EOF) {
 			fprintf(stderr, "Unexpected character: %c\n", next);
-			free(num);
 			return EXIT_FAILURE;
 		}
 		turn++;
 	}
-	if (!feof(in)) {
+	if (!ineof(in)) {
 		fputs("Error occured while parsing puzzle input\n", stderr);
-		free(num);
 		return EXIT_FAILURE;
 	}
 	if (last > UINT32_C(30000000)) {
 		fputs("Number list was empty\n", stderr);
-		free(num);
 		return EXIT_FAILURE;
 	}
+	parsed(out);
 	while (turn < UINT32_C(2020))
 		last = playturn(num, turn++, last);
-	printf("2020th\t%" PRIuFAST32 "\n", last);
+	answeruint(out, 0, "2020th", last);
 	while (turn < UINT32_C(30000000))
 		last = playturn(num, turn++, last);
-	printf("30Mth\t%" PRIuFAST32 "\n", last);
-	free(num);
+	answeruint(out, 1, "30Mth", last);
 	return EXIT_SUCCESS;
 }
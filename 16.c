@@ -12,6 +12,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+
 typedef enum {
 	CONSTRAINTS,
 	YOUR_TICKET,
@@ -23,7 +28,7 @@ typedef struct {
 } Interval;
 
 typedef struct {
-	char *name;
+	Span name;
 	Interval i[2];
 } FieldDef;
 
@@ -34,75 +39,79 @@ struct Node {
 
 typedef struct Node Node;
 
-static FieldDef *constr = NULL;
-static size_t cconstr = 0, nconstr = 0;
-static uintmax_t *yourticket = NULL;
-static Node *tickets = NULL;
+typedef struct {
+	FieldDef *constr;
+	size_t cconstr, nconstr;
+	uintmax_t *yourticket;
+	Node *tickets;
+} Notes;
 
-static int
-getline(FILE * const restrict in, char ** const restrict input)
+/* Skips blank lines */
+static bool
+getline(Input * const restrict in, Span * const restrict input)
 {
-	fscanf(in, "%*[ \t\n]");
-	return fscanf(in, "%m[^\n]", input);
+	inspace(in);
+	if (ineof(in))
+		return false;
+	*input = inuntil(in, '\n');
+	return true;
 }
 
 static bool
-parsedef(const char * const input)
+parsedef(Notes * const restrict notes, const Span input)
 {
-	if (nconstr == cconstr) {
-		cconstr = (cconstr > 0)? 2 * cconstr : 1;
-		FieldDef *temp = realloc(constr, cconstr * sizeof(FieldDef));
+	if (notes->nconstr == notes->cconstr) {
+		const size_t cconstr = (notes->cconstr > 0)?
+		                       2 * notes->cconstr : 1;
+		FieldDef *temp = realloc(notes->constr,
+		                         cconstr * sizeof(FieldDef));
 		if (temp == NULL) {
 			fputs("Could not allocate field definition\n", stderr);
 			return false;
 		}
-		constr = temp;
+		notes->constr = temp;
+		notes->cconstr = cconstr;
 	}
-	constr[nconstr].name = NULL;
-	int n;
-	if (sscanf(input,
-	           "%m[A-Za-z ]: %ju-%ju or %ju-%ju%n",
-	           &constr[nconstr].name,
-	           &constr[nconstr].i[0].min,
-	           &constr[nconstr].i[0].max,
-	           &constr[nconstr].i[1].min,
-	           &constr[nconstr].i[1].max,
-	           &n) != 5
-	    || input[n] != 0) {
-		free(constr[nconstr].name);
+	FieldDef * const def = notes->constr + notes->nconstr;
+	Input l = { .p = input.s, .end = input.s + input.len };
+	while (!ineof(&l) && (isalpha((unsigned char) *l.p) || *l.p == ' '))
+		l.p++;
+	def->name = (Span) { .s = input.s, .len = l.p - input.s };
+	if (def->name.len == 0 || !inlit(&l, ": ")
+	    || !inuint(&l, &def->i[0].min) || !inchar(&l, '-')
+	    || !inuint(&l, &def->i[0].max) || !inlit(&l, " or ")
+	    || !inuint(&l, &def->i[1].min) || !inchar(&l, '-')
+	    || !inuint(&l, &def->i[1].max) || !ineof(&l))
 		return false;
-	}
-	nconstr++;
+	notes->nconstr++;
 	return true;
 }
 
 static uintmax_t *
-parsefields(const char * const input)
+parsefields(const size_t nconstr, const Span input)
 {
 	if (nconstr == 0)
 		return NULL;
 	uintmax_t * const fields = malloc(nconstr * sizeof(uintmax_t));
 	if (fields == NULL)
 		return NULL;
-	int off;
-	const char *it = input;
-	for (size_t i = 0; i < nconstr; i++) {
-		if (sscanf(it, "%ju%n", fields + i, &off) < 1
-		    || (i != nconstr - 1 && it[off] != ',')) {
-			fprintf(stderr,
-				"Could not match ticket at %zu: %s\n",
-				i,
-				input);
-			free(fields); 
-			return NULL;
-		}
-		it += off + 1;
+	Input l = { .p = input.s, .end = input.s + input.len };
+	const size_t n = inuints(&l, ',', fields, nconstr);
+	if (n < nconstr) {
+		fprintf(stderr,
+			"Could not match ticket at %zu: %.*s\n",
+			n,
+			(int) input.len,
+			input.s);
+		free(fields); 
+		return NULL;
 	}
-	if (*(it - 1) != 0) {
+	if (!ineof(&l)) {
 		fprintf(stderr,
-			"Ticket is over %zu fields long: %s\n",
+			"Ticket is over %zu fields long: %.*s\n",
 			nconstr,
-			input);
+			(int) input.len,
+			input.s);
 		free(fields);
 		return NULL;
 	}
@@ -110,10 +119,11 @@ parsefields(const char * const input)
 }
 
 static bool
-parseyourticket(const char * const input)
+parseyourticket(Notes * const restrict notes, const Span input)
 {
-	if (yourticket == NULL) {
-		return (yourticket = parsefields(input)) != NULL;
+	if (notes->yourticket == NULL) {
+		notes->yourticket = parsefields(notes->nconstr, input);
+		return notes->yourticket != NULL;
 	} else {
 		fputs("Your ticket is ill-formed\n", stderr);
 		return false;
@@ -133,8 +143,10 @@ satisfies(const uintmax_t val, const FieldDef * const constr)
 }
 
 static bool
-isvalid(const uintmax_t val)
+isvalid(const Notes * const notes, const uintmax_t val)
 {
+	const FieldDef * const constr = notes->constr;
+	const size_t nconstr = notes->nconstr;
 	for (size_t i = 0; i < nconstr; i++) {
 		if (satisfies(val, constr + i))
 			return true;
@@ -143,16 +155,17 @@ isvalid(const uintmax_t val)
 }
 
 static bool
-parsenearbyticket(const char * const restrict input,
+parsenearbyticket(Notes * const restrict notes,
+                  const Span input,
                   Node ** const restrict tail,
                   uintmax_t * const restrict tser)
 {
-	uintmax_t * const fields = parsefields(input);
+	uintmax_t * const fields = parsefields(notes->nconstr, input);
 	if (fields == NULL)
 		return false;
 	bool invalid = false;
-	for (size_t i = 0; i < nconstr; i++) {
-		if (!isvalid(fields[i])) {
+	for (size_t i = 0; i < notes->nconstr; i++) {
+		if (!isvalid(notes, fields[i])) {
 			invalid = true;
 			if (*tser > UINTMAX_MAX - fields[i]) {
 				fputs("Integer wraparound detected\n", stderr);
@@ -173,74 +186,81 @@ parsenearbyticket(const char * const restrict input,
 	}
 	node->fields = fields;
 	node->next = NULL;
-	if (tickets == NULL)
-		tickets = node;
+	if (notes->tickets == NULL)
+		notes->tickets = node;
 	else
 		(*tail)->next = node;
 	*tail = node;
 	return true;
 }
 
-static ParseState
-parsecase(const ParseState state,
-          char * const restrict input,
-          const char * const restrict nextstr,
-          bool (*parsefunc)(const char*),
+static bool
+parsecase(ParseState * const restrict state,
+          Notes * const restrict notes,
+          const Span input,
+          const Span nextstr,
+          bool (*parsefunc)(Notes *, Span),
           const char * const restrict parsing)
 {
-	if (strcmp(input, nextstr) == 0)
-		return state + 1;
-	if (!parsefunc(input)) {
-		fprintf(stderr, "Could not parse %s: %s\n", parsing, input);
-		free(input);
-		exit(EXIT_FAILURE);
+	if (spaneq(input, nextstr)) {
+		(*state)++;
+		return true;
 	}
-	return state;
+	if (!parsefunc(notes, input)) {
+		fprintf(stderr,
+		        "Could not parse %s: %.*s\n",
+		        parsing,
+		        (int) input.len,
+		        input.s);
+		return false;
+	}
+	return true;
 }
 
-static uintmax_t
-parseinput(FILE * const in)
+static bool
+parseinput(Input * const restrict in,
+           Notes * const restrict notes,
+           uintmax_t * const restrict tser)
 {
 	Node *tail = NULL;
 	ParseState state = CONSTRAINTS;
-	uintmax_t tser = 0;
-	char *input;
-	while (getline(in, &input) == 1) {
+	Span input;
+	bool success = true;
+	while (success && getline(in, &input) == 1) {
 		switch (state) {
 		case CONSTRAINTS:
-			state = parsecase(state,
-			                  input,
-			                  "your ticket:",
-			                  parsedef,
-			                  "ticket field definition");
+			success = parsecase(&state,
+			                    notes,
+			                    input,
+			                    SPAN("your ticket:"),
+			                    parsedef,
+			                    "ticket field definition");
 			break;
 		case YOUR_TICKET:
-			state = parsecase(state,
-			                  input,
-			                  "nearby tickets:",
-			                  parseyourticket,
-			                  "your ticket");
+			success = parsecase(&state,
+			                    notes,
+			                    input,
+			                    SPAN("nearby tickets:"),
+			                    parseyourticket,
+			                    "your ticket");
 			break;
 		case NEARBY_TICKETS:
-			if (!parsenearbyticket(input, &tail, &tser)) {
+			if (!parsenearbyticket(notes, input, &tail, tser)) {
 				fprintf(stderr,
-				        "Could not parse nearby ticket: %s\n",
-				        input);
-				free(input);
-				exit(EXIT_FAILURE);
+				        "Could not parse nearby ticket: %.*s\n",
+				        (int) input.len,
+				        input.s);
+				success = false;
 			}
 		}
-		free(input);
 	}
-	if (!feof(in) || ferror(in)) {
-		fputs("Error occured while parsing puzzle input\n", stderr);
-		exit(EXIT_FAILURE);
-	}
-	return tser;
+	return success;
 }
 
 static void
-eliminateimplausible(const uintmax_t tikfields[const restrict nconstr],
+eliminateimplausible(const size_t nconstr,
+                     const FieldDef constr[const restrict nconstr],
+                     const uintmax_t tikfields[const restrict nconstr],
                      const bool fixed[const restrict nconstr],
                      bool plausible[nconstr][nconstr])
 {
@@ -254,9 +274,11 @@ eliminateimplausible(const uintmax_t tikfields[const restrict nconstr],
 	}
 }
 
-static void
-sortfields(void)
+static bool
+sortfields(Notes * const notes)
 {
+	FieldDef * const constr = notes->constr;
+	const size_t nconstr = notes->nconstr;
 	bool fixed[nconstr];
 	for (size_t i = 0; i < nconstr; i++)
 		fixed[i] = false;
@@ -266,8 +288,13 @@ sortfields(void)
 			for (size_t j = 0; j < nconstr; j++)
 				plausible[i][j] = !fixed[i] && !fixed[j];
 		}
-		for (const Node *tik = tickets; tik != NULL; tik = tik->next)
-			eliminateimplausible(tik->fields, fixed, plausible);
+		for (const Node *tik = notes->tickets; tik; tik = tik->next) {
+			eliminateimplausible(nconstr,
+			                     constr,
+			                     tik->fields,
+			                     fixed,
+			                     plausible);
+		}
 		for (size_t i = 0; i < nconstr; i++) {
 			if (fixed[i])
 				continue;
@@ -281,7 +308,7 @@ sortfields(void)
 			}
 			if (times == 0) {
 				fprintf(stderr, "%zu doesn't match\n", i);
-				exit(EXIT_FAILURE);
+				return false;
 			} else if (times == 1) {
 				if (match != i) {
 					const FieldDef temp = constr[i];
@@ -297,49 +324,79 @@ sortfields(void)
 			fputs("Not all fields could be sorted; "
 			      "there are still invalid tickets\n",
 			      stderr);
-			exit(EXIT_FAILURE);
+			return false;
 		}
 	}
+	return true;
 }
 
-static uintmax_t
-proddepart(void)
+static bool
+proddepart(const Notes * const restrict notes, uintmax_t * const restrict p)
 {
-	uintmax_t p = 1;
-	for (size_t i = 0; i < nconstr; i++) {
-		if (strncmp(constr[i].name, "departure", 9) == 0) {
-			if (p >= UINTMAX_MAX / yourticket[i]) {
+	const FieldDef * const constr = notes->constr;
+	const uintmax_t * const yourticket = notes->yourticket;
+	*p = 1;
+	for (size_t i = 0; i < notes->nconstr; i++) {
+		if (constr[i].name.len >= 9
+		    && memcmp(constr[i].name.s, "departure", 9) == 0) {
+			if (*p >= UINTMAX_MAX / yourticket[i]) {
 				fputs("Integer wraparound detected\n", stderr);
-				exit(EXIT_FAILURE);
+				return false;
 			}
-			p *= yourticket[i];
+			*p *= yourticket[i];
 		}
 	}
-	return p;
+	return true;
 }
 
 static void
-freedata(void)
+freedata(Notes * const notes)
 {
-	for (size_t i = 0; i < nconstr; i++)
-		free(constr[i].name);
-	free(constr);
-	free(yourticket);
-	while (tickets != NULL) {
-		Node * const next = tickets->next;
-		free(tickets->fields);
-		free(tickets);
-		tickets = next;
+	free(notes->constr);
+	free(notes->yourticket);
+	while (notes->tickets != NULL) {
+		Node * const next = notes->tickets->next;
+		free(notes->tickets->fields);
+		free(notes->tickets);
+		notes->tickets = next;
 	}
 }
 
-int
-day16(FILE * const in)
+static int
+solve(Input * const restrict in,
+      Notes * const restrict notes,
+      AdventResult * const restrict out)
 {
-	if (atexit(freedata) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
-	printf("TSER\t%ju\n", parseinput(in));
-	sortfields();
-	printf("Depart\t%ju\n", proddepart());
+	uintmax_t tser = 0, depart;
+	if (!parseinput(in, notes, &tser))
+		return EXIT_FAILURE;
+	answeruint(out, 0, "TSER", tser);
+	parsed(out);
+	if (notes->yourticket == NULL) {
+		fputs("Your ticket is missing\n", stderr);
+		return EXIT_FAILURE;
+	}
+	const size_t phase = tracebegin(out, "Sort fields");
+	if (!sortfields(notes))
+		return EXIT_FAILURE;
+	traceend(out, phase);
+	if (!proddepart(notes, &depart))
+		return EXIT_FAILURE;
+	answeruint(out, 1, "Depart", depart);
 	return EXIT_SUCCESS;
 }
+
+int
+day16(Input * const in, AdventResult * const out)
+{
+	Notes notes = {
+		.constr = NULL,
+		.cconstr = 0,
+		.nconstr = 0,
+		.yourticket = NULL,
+		.tickets = NULL
+	};
+	const int result = solve(in, &notes, out);
+	freedata(&notes);
+	return result;
+}
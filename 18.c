@@ -10,9 +10,17 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
 
 typedef enum { TEOF, TEOL, PCLOSE, MULT, PLUS, POPEN, NUMBER } TokenType;
 
+typedef enum { FINISHED, CONTINUE, FAILED } ExprResult;
+
 typedef struct {
 	TokenType type;
 	uintmax_t val;
@@ -26,9 +34,11 @@ struct Node {
 typedef struct Node Node;
 
 static bool
-push(Node ** const stack, const uintmax_t val)
+push(Pool * const restrict pool,
+     Node ** const restrict stack,
+     const uintmax_t val)
 {
-	Node * const new = malloc(sizeof(Node));
+	Node * const new = poolalloc(pool);
 	if (new == NULL)
 		return false;
 	new->val = val;
@@ -38,23 +48,25 @@ push(Node ** const stack, const uintmax_t val)
 }
 
 static bool
-pop(Node ** const restrict stack, uintmax_t * const restrict result)
+pop(Pool * const restrict pool,
+    Node ** const restrict stack,
+    uintmax_t * const restrict result)
 {
 	if (*stack == NULL)
 		return false;
 	Node * const top = *stack;
 	*stack = top->next;
 	*result = top->val;
-	free(top);
+	poolfree(pool, top);
 	return true;
 }
 
 static void
-freestack(Node *stack)
+freestack(Pool * const restrict pool, Node * restrict stack)
 {
 	while (stack != NULL) {
 		Node * const temp = stack->next;
-		free(stack);
+		poolfree(pool, stack);
 		stack = temp;
 	}
 }
@@ -80,16 +92,17 @@ addwilloverflow(const uintmax_t x, const uintmax_t y)
 }
 
 static bool
-emitop(Node ** const restrict acc,
+emitop(Pool * const restrict pool,
+       Node ** const restrict acc,
        Node ** const restrict ops,
        const TokenType op)
 {
 	if (*ops == NULL || opcomp(op, (*ops)->val) >= 0)
-		return push(ops, op);
+		return push(pool, ops, op);
 	while (*acc != NULL && *ops != NULL && opcomp(op, (*ops)->val) < 0) {
 		uintmax_t val, topop = 1;
-		pop(acc, &val);
-		pop(ops, &topop);
+		pop(pool, acc, &val);
+		pop(pool, ops, &topop);
 		if (*acc == NULL) {
 			fputs("ops was too big\n", stderr);
 			return false;
@@ -116,18 +129,18 @@ emitop(Node ** const restrict acc,
 		fputs("Accumulator ended up empty\n", stderr);
 		return false;
 	}
-	return !(op != TEOF && op != TEOL && op != PCLOSE && !push(ops, op));
+	return !(op != TEOF && op != TEOL && op != PCLOSE
+	         && !push(pool, ops, op));
 }
 
 static bool
-nexttok(FILE * const restrict in, Token * const restrict tok)
+nexttok(Input * const restrict in, Token * const restrict tok)
 {
-	int c;
-	while ((c = fgetc(in)) == ' ');
-	ungetc(c, in);
+	while (inchar(in, ' '));
+	const int c = inpeek(in);
 	if (isdigit(c)) {
 		tok->type = NUMBER;
-		return fscanf(in, "%ju", &tok->val) == 1;
+		return inuint(in, &tok->val);
 	}
 	switch (c) {
 	default:
@@ -150,7 +163,7 @@ nexttok(FILE * const restrict in, Token * const restrict tok)
 	case ')':
 		tok->type = PCLOSE;
 	}
-	fgetc(in);
+	inget(in);
 	return true;
 }
 
@@ -166,12 +179,14 @@ badtoken(const uintmax_t pos, const TokenType t)
 	return (pos % 2) ^ isoperator(t);
 }
 
-static void
-freeandexit(Node * const restrict acc, Node * const restrict ops)
+static ExprResult
+freeandfail(Pool * const restrict pool,
+            Node * const restrict acc,
+            Node * const restrict ops)
 {
-	freestack(acc);
-	freestack(ops);
-	exit(EXIT_FAILURE);
+	freestack(pool, acc);
+	freestack(pool, ops);
+	return FAILED;
 }
 
 static void
@@ -187,8 +202,9 @@ flatapplyop(uintmax_t * const res,
 		*res = val;
 }
 
-static bool
-subexpr(FILE * const restrict in,
+static ExprResult
+subexpr(Input * const restrict in,
+        Pool * const restrict pool,
         const uintmax_t level,
         const uintmax_t line,
         uintmax_t * const restrict flatres,
@@ -201,77 +217,127 @@ subexpr(FILE * const restrict in,
 	do {
 		uintmax_t subvalflat = 0, subvalstack = 0;
 		if (!nexttok(in, &t))
-			freeandexit(acc, ops);
+			return freeandfail(pool, acc, ops);
 		if (badtoken(pos++, t.type)) {
 			fprintf(stderr, "Syntax error on line %ju\n", line);
-			freeandexit(acc, ops);
+			return freeandfail(pool, acc, ops);
 		}
 		if (t.type == POPEN
-		    && !subexpr(in, level + 1, line, &subvalflat, &subvalstack))
-			freeandexit(acc, ops);
+		    && subexpr(in,
+		               pool,
+		               level + 1,
+		               line,
+		               &subvalflat,
+		               &subvalstack)
+		       != CONTINUE)
+			return freeandfail(pool, acc, ops);
 		if (t.type == NUMBER)
 			subvalflat = subvalstack = t.val;
 		flatapplyop(flatres, subvalflat, lastop);
 		if (isoperator(t.type)) {
 			lastop = t.type;
-			if (!emitop(&acc, &ops, t.type)) {
+			if (!emitop(pool, &acc, &ops, t.type)) {
 				fputs("Could not emit operator\n", stderr);
-				freeandexit(acc, ops);
+				return freeandfail(pool, acc, ops);
 			}
 		} else {
 			lastop = TEOL;
-			if (!push(&acc, subvalstack)) {
+			if (!push(pool, &acc, subvalstack)) {
 				fputs("Could not emit number\n", stderr);
-				freeandexit(acc, ops);
+				return freeandfail(pool, acc, ops);
 			}
 		}
 	} while (t.type != TEOF && ((level == 0 && t.type != TEOL)
 	                            || (level > 0 && t.type != PCLOSE)));
 	if (ops != NULL) {
 		fputs("Operator stack ended up not empty\n", stderr);
-		freeandexit(acc, ops);
+		return freeandfail(pool, acc, ops);
 	}
 	if (acc == NULL) {
 		fputs("Accumulator ended up empty\n", stderr);
-		exit(EXIT_FAILURE);
+		return FAILED;
 	} else if (acc->next != NULL) {
 		fputs("More than one number remain in accumulator\n", stderr);
-		freestack(acc);
-		exit(EXIT_FAILURE);
+		return freeandfail(pool, acc, NULL);
 	}
 	*stackres = acc->val;
-	freestack(acc);
-	return t.type != TEOF;
+	freestack(pool, acc);
+	return t.type != TEOF? CONTINUE : FINISHED;
 }
 
-static bool
-parseexpr(FILE * const restrict in,
+static ExprResult
+parseexpr(Input * const restrict in,
+          Pool * const restrict pool,
           uintmax_t * const restrict line,
           uintmax_t * const restrict flatacc,
           uintmax_t * const restrict stackacc)
 {
 	uintmax_t flatres = 0, stackres = 0;
-	const bool cont = subexpr(in, 0, *line, &flatres, &stackres);
-	if (!cont || addwilloverflow(*flatacc, flatres))
-		return false;
+	const ExprResult res = subexpr(in, pool, 0, *line, &flatres, &stackres);
+	if (res == FAILED)
+		return FAILED;
+	if (res == FINISHED || addwilloverflow(*flatacc, flatres))
+		return FINISHED;
 	*flatacc += flatres;
 	if (addwilloverflow(*stackacc, stackres))
-		return false;
+		return FINISHED;
 	*stackacc += stackres;
 	(*line)++;
+	return CONTINUE;
+}
+
+typedef struct {
+	Pool pool;
+	uintmax_t line, flatacc, stackacc;
+} Homework;
+
+static bool
+begin(void * const state, AdventResult * const out)
+{
+	Homework * const h = state;
+	h->pool = POOL(scratch(out), Node);
+	h->line = 1;
 	return true;
 }
 
-int
-day18(FILE * const in)
+static bool
+fold(void * const state, Input * const in)
 {
-	uintmax_t line = 1, flatacc = 0, stackacc = 0;
-	while (parseexpr(in, &line, &flatacc, &stackacc));
-	if (!feof(in) || ferror(in)) {
-		fprintf(stderr, "Puzzle input failed on line %ju\n", line);
-		return EXIT_FAILURE;
+	Homework * const h = state;
+	ExprResult res;
+	while ((res = parseexpr(in,
+	                        &h->pool,
+	                        &h->line,
+	                        &h->flatacc,
+	                        &h->stackacc))
+	       == CONTINUE);
+	if (res == FAILED || !ineof(in)) {
+		fprintf(stderr, "Puzzle input failed on line %ju\n", h->line);
+		return false;
 	}
-	printf("Flat\t%ju\n", flatacc);
-	printf("Stack\t%ju\n", stackacc);
+	return true;
+}
+
+static int
+finish(void * const state, AdventResult * const out)
+{
+	const Homework * const h = state;
+	answeruint(out, 0, "Flat", h->flatacc);
+	answeruint(out, 1, "Stack", h->stackacc);
 	return EXIT_SUCCESS;
 }
+
+const Stream stream18 = {
+	.sep = "\n",
+	.size = sizeof(Homework),
+	.begin = begin,
+	.fold = fold,
+	.finish = finish,
+	.release = NULL
+};
+
+int
+day18(Input * const in, AdventResult * const out)
+{
+	return foldinput(&stream18, in, out);
+}
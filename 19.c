@@ -6,22 +6,25 @@
  * http://www.wtfpl.net/ for more details.
  */
 #include <limits.h>
-#include <regex.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+#include "parallel.h"
+
 /* Upper bound to how many digits a given type may hold */
 #define DIGITS(T) (CHAR_BIT * 10 * sizeof(T) / (9 * sizeof(char)))
 
-#define GRAMMAR_REGEX "[0-9]+( \\| [0-9]+| [0-9]+)*|\"([ab])\""
-
 typedef enum { GRAMMAR, MESSAGES } ParseState;
 
 struct Message {
-	char *msg;
+	Span msg;
 	struct Message *next;
 };
 
@@ -59,17 +62,27 @@ struct RuleTree {
 
 typedef struct RuleTree RuleTree;
 
-static Message *msg = NULL;
-static RuleTree *root = NULL;
+typedef struct {
+	Message *msg;
+	RuleTree *root;
+	Arena *arena;
+} Puzzle;
+
+/* Messages are matched apart, and each match is 1, 0 or -1 on failure */
+typedef struct {
+	RuleTree *root;
+	const Span *msg;
+	signed char *match;
+} Matching;
 
 static bool
-addrule(RuleTree *rule)
+addrule(RuleTree ** const restrict root, RuleTree * const restrict rule)
 {
-	if (root == NULL) {
-		root = rule;
+	if (*root == NULL) {
+		*root = rule;
 		return false;
 	}
-	RuleTree *it = root;
+	RuleTree *it = *root;
 	for (;;) {
 		if (rule->num < it->num) {
 			if (it->left == NULL) {
@@ -90,7 +103,7 @@ addrule(RuleTree *rule)
 }
 
 static RuleTree *
-getrule(const uintmax_t num)
+getrule(RuleTree * const root, const uintmax_t num)
 {
 	RuleTree *it = root;
 	while (it != NULL && it->num != num) {
@@ -103,34 +116,23 @@ getrule(const uintmax_t num)
 }
 
 static void
-freesymbols(Symbol *sym)
+freesymbols(Pool * const restrict pool, Symbol * restrict sym)
 {
 	while (sym != NULL) {
 		Symbol * const next = sym->next;
-		free(sym);
+		poolfree(pool, sym);
 		sym = next;
 	}
 }
 
-static void
-freeseq(Sequence *seq)
-{
-	while (seq != NULL) {
-		Sequence * const next = seq->next;
-		freesymbols(seq->val);
-		free(seq);
-		seq = next;
-	}
-}
-
 static Symbol *
-clonesymb(const Symbol * restrict sym)
+clonesymb(Pool * const restrict pool, const Symbol * restrict sym)
 {
 	Symbol *head = NULL, *tail = NULL;
 	while (sym != NULL) {
-		Symbol * const new = malloc(sizeof(Symbol));
+		Symbol * const new = poolalloc(pool);
 		if (new == NULL) {
-			freesymbols(head);
+			freesymbols(pool, head);
 			return NULL;
 		}
 		new->num = sym->num;
@@ -146,30 +148,34 @@ clonesymb(const Symbol * restrict sym)
 }
 
 static int
-matches(Symbol * const sym, const char * restrict msg)
+matches(RuleTree * const root,
+        Pool * const pool,
+        Symbol * const sym,
+        const char * restrict msg,
+        const char * const end)
 {
 	if (sym == NULL)
-		return *msg == 0;
-	if (*msg == 0)
+		return msg == end;
+	if (msg == end)
 		return sym == NULL;
-	const RuleTree * const rule = getrule(sym->num);
+	const RuleTree * const rule = getrule(root, sym->num);
 	if (rule->type == CHARACTER) {
 		if (rule->val.ch == msg[0])
-			return matches(sym->next, msg + 1);
+			return matches(root, pool, sym->next, msg + 1, end);
 		return 0;
 	} else {
 		const Sequence *seq;
 		for (seq = rule->val.seq; seq != NULL; seq = seq->next) {
-			Symbol * const clone = clonesymb(seq->val);
+			Symbol * const clone = clonesymb(pool, seq->val);
 			if (clone == NULL)
 				return -1;
 			Symbol *tail = clone;
 			while (tail->next != NULL)
 				tail = tail->next;
 			tail->next = sym->next;
-			const int res = matches(clone, msg);
+			const int res = matches(root, pool, clone, msg, end);
 			tail->next = NULL;
-			freesymbols(clone);
+			freesymbols(pool, clone);
 			if (res != 0)
 				return res;
 		}
@@ -178,15 +184,13 @@ matches(Symbol * const sym, const char * restrict msg)
 }
 
 static Symbol *
-makesymbols(const size_t size, const uintmax_t arr[size])
+makesymbols(Arena * const arena, const size_t size, const uintmax_t arr[size])
 {
 	Symbol *head = NULL, *tail = NULL;
 	for (size_t i = 0; i < size; i++) {
-		Symbol * const new = malloc(sizeof(Symbol));
-		if (new == NULL) {
-			freesymbols(head);
+		Symbol * const new = aralloc(arena, sizeof(Symbol));
+		if (new == NULL)
 			return NULL;
-		}
 		new->num = arr[i];
 		new->next = NULL;
 		if (head == NULL)
@@ -215,23 +219,25 @@ issequence(const Sequence * const seq,
 	return sym == NULL && i == size;
 }
 
-static void
-convertrule(const uintmax_t num,
+static bool
+convertrule(RuleTree * const root,
+            Arena * const arena,
+            const uintmax_t num,
             const size_t oldsize,
             const uintmax_t old[restrict oldsize],
             const size_t newsize,
             const uintmax_t new[restrict newsize])
 {
-	const RuleTree * const rule = getrule(num);
+	const RuleTree * const rule = getrule(root, num);
 	if (rule == NULL) {
 		fprintf(stderr, "Rule %ju not found\n", num);
-		exit(EXIT_FAILURE);
+		return false;
 	}
 	if (rule->type != SEQUENCE) {
 		fprintf(stderr,
 		        "Rule %ju is not a disjuction of sequences\n",
 		        num);
-		exit(EXIT_FAILURE);
+		return false;
 	}
 	Sequence *seq = rule->val.seq;
 	if (!issequence(seq, oldsize, old)) {
@@ -239,71 +245,57 @@ convertrule(const uintmax_t num,
 		for (size_t i = 0; i < oldsize; i++)
 			fprintf(stderr, " %ju", old[i]);
 		fputc('\n', stderr);
-		exit(EXIT_FAILURE);
+		return false;
 	}
-	if ((seq->next = malloc(sizeof(Sequence))) == NULL) {
+	Sequence * const next = aralloc(arena, sizeof(Sequence));
+	if (next == NULL) {
 		fputs("Could not allocate a new sequence\n", stderr);
-		exit(EXIT_FAILURE);
+		return false;
 	}
-	if ((seq->next->val = makesymbols(newsize, new)) == NULL) {
+	if ((next->val = makesymbols(arena, newsize, new)) == NULL) {
 		fputs("Could not fill new sequence\n", stderr);
-		free(seq->next);
-		exit(EXIT_FAILURE);
+		return false;
 	}
-	seq->next->next = NULL;
+	next->next = NULL;
+	seq->next = next;
+	return true;
 }
 
-static void
-convertrules(void)
+static bool
+convertrules(RuleTree * const root, Arena * const arena)
 {
 	const uintmax_t old8[1] = { 42 };
 	const uintmax_t new8[2] = { 42, 8 };
-	convertrule(8, 1, old8, 2, new8);
 	const uintmax_t old11[2] = { 42, 31 };
 	const uintmax_t new11[3] = { 42, 11, 31 };
-	convertrule(11, 2, old11, 3, new11);
-}
-
-static void
-freerules(RuleTree * const set)
-{
-	if (set == NULL)
-		return;
-	freerules(set->left);
-	freerules(set->right);
-	if (set->type == SEQUENCE)
-		freeseq(set->val.seq);
-	free(set);
+	return convertrule(root, arena, 8, 1, old8, 2, new8)
+	       && convertrule(root, arena, 11, 2, old11, 3, new11);
 }
 
+/* Parses alternatives such as `4 1 | 1 4` */
 static bool
-isemptyline(FILE * const in)
-{
-	const int c = fgetc(in);
-	if (c != '\n' && c != EOF)
-		ungetc(c, in);
-	return c == '\n' || c == EOF;
-}
-
-static Sequence *
-parsesequencerule(char *str)
+parsesequencerule(Input * const restrict in,
+                  Arena * const restrict arena,
+                  Sequence ** const restrict head,
+                  const uintmax_t line)
 {
-	Sequence *seqhead = NULL, *seqtail = NULL;
+	Sequence *seqtail = NULL;
 	Symbol *symtail = NULL;
 	bool newseq = true;
-	const char *tok;
-	while ((tok = strtok(str, " ")) != NULL) {
-		str = NULL;
+	*head = NULL;
+	for (;;) {
 		if (newseq) {
-			Sequence * const new = malloc(sizeof(Sequence));
+			Sequence * const new = aralloc(arena, sizeof(Sequence));
 			if (new == NULL) {
-				freeseq(seqhead);
-				return NULL;
+				fprintf(stderr,
+				        "Allocation error on line %ju\n",
+				        line);
+				return false;
 			}
 			new->val = NULL;
 			new->next = NULL;
-			if (seqhead == NULL)
-				seqhead = new;
+			if (*head == NULL)
+				*head = new;
 			else
 				seqtail->next = new;
 			seqtail = new;
@@ -311,228 +303,248 @@ parsesequencerule(char *str)
 			newseq = false;
 		}
 		uintmax_t num;
-		if (strcmp(tok, "|") == 0) {
-			if (symtail == NULL) {
-				freeseq(seqhead);
-				return NULL;
-			}
-			newseq = true;
-		} else if (sscanf(tok, "%ju", &num) == 1) {
-			Symbol * const new = malloc(sizeof(Symbol));
-			if (new == NULL) {
-				freeseq(seqhead);
-				return NULL;
-			}
-			new->num = num;
-			new->next = NULL;
-			if (seqtail->val == NULL)
-				seqtail->val = new;
-			else
-				symtail->next = new;
-			symtail = new;
-		} else {
-			freeseq(seqhead);
-			return NULL;
+		if (!inuint(in, &num)) {
+			fprintf(stderr, "Line %ju doesn't match\n", line);
+			return false;
 		}
+		Symbol * const new = aralloc(arena, sizeof(Symbol));
+		if (new == NULL) {
+			fprintf(stderr, "Allocation error on line %ju\n", line);
+			return false;
+		}
+		new->num = num;
+		new->next = NULL;
+		if (symtail == NULL)
+			seqtail->val = new;
+		else
+			symtail->next = new;
+		symtail = new;
+		if (!inchar(in, ' '))
+			return true;
+		newseq = inlit(in, "| ");
 	}
-	if (newseq) {
-		freeseq(seqhead);
-		return NULL;
-	}
-	return seqhead;
 }
 
 static bool
-parsegrammar(FILE * const restrict in,
-             regex_t * restrict greg,
+parsegrammar(Input * const restrict in,
+             Arena * const restrict arena,
+             RuleTree ** const restrict root,
              const uintmax_t line)
 {
 	uintmax_t num;
-	char *input;
-	if (fscanf(in, "%ju: %m[^\n]", &num, &input) < 2) {
+	if (!inuint(in, &num) || !inlit(in, ": ")) {
 		fprintf(stderr, "Input parsing failed on line %ju\n", line);
 		return false;
 	}
-	regmatch_t match[3];
-	if (regexec(greg, input, 3, match, 0) != 0) {
-		fprintf(stderr, "Line %ju doesn't match: %s\n", line, input);
-		free(input);
-		return false;
-	}
-	RuleTree * const new = malloc(sizeof(RuleTree));
+	RuleTree * const new = aralloc(arena, sizeof(RuleTree));
 	if (new == NULL) {
 		fprintf(stderr, "Could not allocate rule on line %ju\n", line);
-		free(input);
 		return false;
 	}
 	new->num = num;
 	new->flag = false;
 	new->left = new->right = NULL;
-	if (match[2].rm_so >= 0) {
-		new->type = CHARACTER;
-		new->val.ch = input[match[2].rm_so];
+	new->type = CHARACTER;
+	if (inchar(in, '"')) {
+		const int c = inget(in);
+		if ((c != 'a' && c != 'b') || !inchar(in, '"')) {
+			fprintf(stderr, "Line %ju doesn't match\n", line);
+			return false;
+		}
+		new->val.ch = c;
 	} else {
 		new->type = SEQUENCE;
-		new->val.seq = parsesequencerule(input);
-		if (new->val.seq == NULL) {
-			fprintf(stderr, "Allocation error on line %ju\n", line);
-			free(input);
+		if (!parsesequencerule(in, arena, &new->val.seq, line))
 			return false;
-		}
 	}
-	free(input);
-	if (addrule(new)) {
-		freerules(new);
+	if (addrule(root, new)) {
 		fputs("Duplicate rules found\n", stderr);
 		return false;
 	}
-	const int next = fgetc(in);
-	if (next != '\n') {
-		fprintf(stderr, "Unexpected character: %c\n", next);
+	if (!inchar(in, '\n')) {
+		fprintf(stderr, "Unexpected character: %c\n", inpeek(in));
 		return false;
 	}
 	return true;
 }
 
 static bool
-parsemessage(FILE * const restrict in,
-             const uintmax_t line, 
+parsemessage(Input * const restrict in,
+             Arena * const restrict arena,
+             const uintmax_t line,
+             Message ** const restrict head,
              Message ** restrict tail)
 {
-	char *input;
-	if (fscanf(in, "%m[ab]", &input) < 1) {
+	const char * const begin = in->p;
+	while (inchar(in, 'a') || inchar(in, 'b'));
+	if (in->p == begin) {
 		fprintf(stderr, "Input failed on line %ju\n", line);
 		return false;
 	}
-	Message * const new = malloc(sizeof(Message));
+	Message * const new = aralloc(arena, sizeof(Message));
 	if (new == NULL) {
 		fprintf(stderr, "Allocation failed on line %ju\n", line);
-		free(input);
 		return false;
 	}
-	new->msg = input;
+	new->msg = (Span) { .s = begin, .len = in->p - begin };
 	new->next = NULL;
-	if (msg == NULL)
-		msg = new;
+	if (*head == NULL)
+		*head = new;
 	else
 		(*tail)->next = new;
 	*tail = new;
-	const int next = fgetc(in);
-	if (next != '\n' && next != EOF) {
-		fprintf(stderr, "Unexpected character: %c\n", next);
+	if (!ineol(in)) {
+		fprintf(stderr, "Unexpected character: %c\n", *in->p);
 		return false;
 	}
 	return true;
 }
 
-static void
-parse(FILE * const in)
+static bool
+parse(Input * const restrict in, Puzzle * const restrict puzzle)
 {
-	regex_t greg;
-	int result = regcomp(&greg, GRAMMAR_REGEX, REG_EXTENDED);
-	if (result != 0) {
-		const size_t sz = regerror(result, &greg, NULL, 0);
-		char buf[sz];
-		regerror(result, &greg, buf, sz);
-		fprintf(stderr, "Could not compile regex: %s\n", buf);
-		exit(EXIT_FAILURE);
-	}
 	Message *msgtail = NULL;
 	ParseState state = GRAMMAR;
 	uintmax_t line = 0;
-	while (!feof(in) && !ferror(in)) {
+	bool success = true;
+	while (success && !ineof(in)) {
 		line++;
-		if (isemptyline(in)) {
+		if (ineol(in)) {
 			state = MESSAGES;
 			continue;
 		}
 		switch (state) {
 		case GRAMMAR:
-			if (!parsegrammar(in, &greg, line)) {
-				regfree(&greg);
-				exit(EXIT_FAILURE);
-			}
+			success = parsegrammar(in,
+			                       puzzle->arena,
+			                       &puzzle->root,
+			                       line);
 			break;
 		case MESSAGES:
-			if (!parsemessage(in, line, &msgtail)) {
-				regfree(&greg);
-				exit(EXIT_FAILURE);
-			}
+			success = parsemessage(in,
+			                       puzzle->arena,
+			                       line,
+			                       &puzzle->msg,
+			                       &msgtail);
 		}
 	}
-	regfree(&greg);
+	return success;
 }
 
-static bool
-hascycle(const uintmax_t num)
+/* Returns -1 if a rule is missing */
+static int
+hascycle(RuleTree * const root, const uintmax_t num)
 {
-	RuleTree * const node = getrule(num);
+	RuleTree * const node = getrule(root, num);
 	if (node == NULL) {
 		fprintf(stderr, "Grammar rule %ju not found\n", num);
-		exit(EXIT_FAILURE);
+		return -1;
 	}
 	if (node->flag)
-		return true;
+		return 1;
 	if (node->type == SEQUENCE) {
 		node->flag = true;
 		for (Sequence *seq = node->val.seq; seq; seq = seq->next) {
 			for (Symbol *sym = seq->val; sym; sym = sym->next) {
-				if (hascycle(sym->num)) {
+				const int res = hascycle(root, sym->num);
+				if (res != 0) {
 					node->flag = false;
-					return true;
+					return res;
 				}
 			}
 		}
 		node->flag = false;
 	}
-	return false;
+	return 0;
 }
 
-static uintmax_t
-countmatches(void)
+/*
+ * Symbols are cloned and dropped while matching, so they are recycled; every
+ * thread has an arena of its own for them
+ */
+static void
+matchrange(void * const arg, const size_t lo, const size_t hi)
 {
-	uintmax_t count = 0;
+	const Matching * const m = arg;
+	Arena arena = { .block = NULL };
+	Pool symbols = POOL(&arena, Symbol);
 	Symbol sym = { .num = 0, .next = NULL };
-	for (const Message *m = msg; m != NULL; m = m->next) {
-		const int res = matches(&sym, m->msg);
-		if (res < 0) {
+	for (size_t i = lo; i < hi; i++) {
+		m->match[i] = matches(m->root,
+		                      &symbols,
+		                      &sym,
+		                      m->msg[i].s,
+		                      m->msg[i].s + m->msg[i].len);
+	}
+	arrelease(&arena);
+}
+
+static bool
+countmatches(const Puzzle * const restrict puzzle,
+             const Span * const restrict msg,
+             const size_t nmsg,
+             uintmax_t * const restrict count)
+{
+	signed char * const match = aralloc(puzzle->arena, nmsg);
+	if (match == NULL) {
+		fputs("Memory allocation failed\n", stderr);
+		return false;
+	}
+	Matching m = { .root = puzzle->root, .msg = msg, .match = match };
+	parallelfor(0, nmsg, 16, matchrange, &m);
+	*count = 0;
+	for (size_t i = 0; i < nmsg; i++) {
+		if (match[i] < 0) {
 			fputs("Memory allocation failed\n", stderr);
-			exit(EXIT_FAILURE);
-		} else if (res > 0) {
-			count++;
+			return false;
 		}
+		*count += match[i];
 	}
-	return count;
+	return true;
 }
 
-static void
-freedata(void)
+/* Lays the messages out in an array, so that threads can split them */
+static Span *
+listmessages(const Puzzle * const restrict puzzle, size_t * const restrict n)
 {
-	while (msg != NULL) {
-		Message * const next = msg->next;
-		free(msg->msg);
-		free(msg);
-		msg = next;
+	*n = 0;
+	for (const Message *m = puzzle->msg; m != NULL; m = m->next)
+		(*n)++;
+	Span * const msg = aralloc(puzzle->arena, *n * sizeof(Span));
+	if (msg == NULL) {
+		fputs("Could not allocate messages\n", stderr);
+		return NULL;
 	}
-	freerules(root);
+	size_t i = 0;
+	for (const Message *m = puzzle->msg; m != NULL; m = m->next)
+		msg[i++] = m->msg;
+	return msg;
 }
 
 int
-day19(FILE * const in)
+day19(Input * const in, AdventResult * const out)
 {
-	if (atexit(freedata) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
-	parse(in);
-	if (!feof(in)) {
-		fputs("Errors happened while parsing puzzle input\n", stderr);
+	Arena * const arena = scratch(out);
+	Puzzle puzzle = { .msg = NULL, .root = NULL, .arena = arena };
+	if (!parse(in, &puzzle))
 		return EXIT_FAILURE;
-	}
-	if (hascycle(0)) {
+	parsed(out);
+	const int cycle = hascycle(puzzle.root, 0);
+	if (cycle < 0) {
+		return EXIT_FAILURE;
+	} else if (cycle > 0) {
 		fputs("The rules are cyclical\n", stderr);
 		return EXIT_FAILURE;
 	}
-	printf("Default\t%ju\n", countmatches());
-	convertrules();
-	printf("Fixed\t%ju\n", countmatches());
+	uintmax_t count;
+	size_t nmsg;
+	const Span * const msg = listmessages(&puzzle, &nmsg);
+	if (msg == NULL || !countmatches(&puzzle, msg, nmsg, &count))
+		return EXIT_FAILURE;
+	answeruint(out, 0, "Default", count);
+	if (!convertrules(puzzle.root, arena)
+	    || !countmatches(&puzzle, msg, nmsg, &count))
+		return EXIT_FAILURE;
+	answeruint(out, 1, "Fixed", count);
 	return EXIT_SUCCESS;
 }
@@ -5,19 +5,29 @@
  * To Public License, Version 2, as published by Sam Hocevar. See
  * http://www.wtfpl.net/ for more details.
  */
-#include <limits.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-/* Upper bound to how many digits a given type may hold */
-#define DIGITS(T) (CHAR_BIT * 10 * sizeof(T) / (9 * sizeof(char)))
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+#include "grid.h"
 
+/* Version of the tiles kept in snapshots */
+#define SNAPSHOT 2
+
+/*
+ * A tile in each of its 8 orientations: mirrored if `o` is 4 or more, then
+ * turned a quarter counterclockwise `o` % 4 times
+ */
 struct Tile {
 	uintmax_t num;
-	bool *data;
+	Grid orient[8];
 	struct Tile *next;
 };
 
@@ -25,22 +35,33 @@ typedef struct Tile Tile;
 
 typedef struct {
 	const Tile *tile;
-	bool flip;
-	uint_least8_t rot;
+	uint_least8_t orient;
 } Slot;
 
-static size_t tilesz = 0;
-static Tile *head = NULL;
-static size_t jigsawsz = 0, imagesz = 0;
+typedef struct {
+	Tile *head;
+	size_t tilesz, jigsawsz, imagesz;
+} Puzzle;
+
+/*
+ * Tiles as snapshots keep them: `ntiles` numbers then the words of as many
+ * grids of `tilesz` by `tilesz` cells, as first oriented
+ */
+typedef struct {
+	size_t ntiles, tilesz;
+} Shelf;
 
-static const bool monster[3][20] = {
-	{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0 },
-	{ 1, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1, 1 },
-	{ 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 0 }
+static const char * const monster[3] = {
+	"                  # ",
+	"#    ##    ##    ###",
+	" #  #  #  #  #  #   "
 };
 
+#define MONSTER_WIDTH 20
+#define MONSTER_HEIGHT 3
+
 static bool
-hastile(const uintmax_t num)
+hastile(const Tile * const head, const uintmax_t num)
 {
 	for (const Tile *tile = head; tile != NULL; tile = tile->next) {
 		if (tile->num == num)
@@ -49,146 +70,211 @@ hastile(const uintmax_t num)
 	return false;
 }
 
-static uintmax_t
-parselabel(FILE * const in, const uintmax_t line)
+static bool
+parselabel(Input * const restrict in,
+           const uintmax_t line,
+           uintmax_t * const restrict tilenum)
 {
-	char newline;
-	uintmax_t tilenum;
-	if (fscanf(in, "Tile %ju:%1c", &tilenum, &newline) < 2) {
+	if (!inlit(in, "Tile ") || !inuint(in, tilenum) || !inchar(in, ':')) {
 		fprintf(stderr, "Input parsing failed on line %ju\n", line);
-		exit(EXIT_FAILURE);
+		return false;
 	}
-	if (newline != '\n') {
+	if (!inchar(in, '\n')) {
 		fprintf(stderr, "Mising line break on line %ju\n", line);
-		exit(EXIT_FAILURE);
+		return false;
 	}
-	return tilenum;
+	return true;
+}
+
+/* Lays the orientations of a tile over words of the arena */
+static bool
+allocorients(Arena * const restrict arena,
+             Tile * const restrict tile,
+             const size_t tilesz)
+{
+	const size_t words = gridwords(tilesz, tilesz);
+	uint64_t * const w = words > 0 && words <= SIZE_MAX / 64
+	                     ? aralloc(arena, 8 * words * sizeof(uint64_t))
+	                     : NULL;
+	if (w == NULL)
+		return false;
+	for (uint_fast8_t o = 0; o < 8; o++)
+		gridinit(&tile->orient[o], w + o * words, tilesz, tilesz);
+	return true;
 }
 
+/* Mirrors and turns the first orientation of a tile into the others */
 static void
-expectnewline(FILE * const restrict in,
-              const uintmax_t line,
-              void * const restrict ptr)
+orienttile(Tile * const tile)
 {
-	const int end = fgetc(in);
-	if (end != EOF && end != '\n') {
-		fprintf(stderr, "Expected new line on line %ju\n", line);
-		free(ptr);
-		exit(EXIT_FAILURE);
-	} else if (ferror(in)) {
-		fprintf(stderr, "Internal stream error on line %ju\n", line);
-		free(ptr);
-		exit(EXIT_FAILURE);
+	for (uint_fast8_t o = 1; o < 8; o++) {
+		if (o == 4)
+			gridflip(&tile->orient[4], &tile->orient[0]);
+		else
+			gridrotate(&tile->orient[o], &tile->orient[o - 1]);
 	}
 }
 
-static void
-filltileline(FILE * const restrict in,
+/*
+ * Transposing mirrors a tile and turns it a quarter counterclockwise, and
+ * mirroring a tile turned one way turns the mirrored tile the other way, so
+ * the transposed orientations are the same 8
+ */
+static uint_fast8_t
+transposed(const uint_fast8_t o)
+{
+	return o < 4? 4 + (5 - o) % 4 : (9 - o) % 4;
+}
+
+static bool
+filltileline(Input * const restrict in,
              const uintmax_t line,
-             const char * const restrict format,
-             bool * const restrict tile,
+             Grid * const restrict tile,
              const size_t l)
 {
-	char buf[tilesz + 1], newline;
-	const int result = fscanf(in, format, buf, &newline);
-	if ((result < 2 && !feof(in)) || result < 1) {
-		fprintf(stderr, "Input parsing failed on line %ju\n", line);
-		free(tile);
-		exit(EXIT_FAILURE);
-	} else if (newline != '\n' && !feof(in)) {
-		fprintf(stderr, "Missing line break on line %ju\n", line);
-		free(tile);
-		exit(EXIT_FAILURE);
-	}
-	for (size_t i = 0; i < tilesz; i++) {
-		if (buf[i] == 0) {
+	const Span s = inuntil(in, '\n');
+	ineol(in);
+	if (s.len != tile->width) {
+		fprintf(stderr, "Inconsistent width on line %ju\n", line);
+		return false;
+	}
+	for (size_t i = 0; i < tile->width; i++) {
+		if (s.s[i] != '#' && s.s[i] != '.') {
 			fprintf(stderr,
-			        "Inconsistent width on line %ju\n",
+			        "Bad input format on line %ju\n",
 			        line);
-			free(tile);
-			exit(EXIT_FAILURE);
+			return false;
 		}
-		tile[l * tilesz + i] = buf[i] == '#';
+		gridset(tile, i, l, s.s[i] == '#');
 	}
+	return true;
 }
 
-static bool *
-parsetile(FILE * const restrict in, uintmax_t * const restrict line)
+/* The first line of the first tile sets `tilesz` */
+static bool
+parsetile(Input * const restrict in,
+          Arena * const restrict arena,
+          uintmax_t * const restrict line,
+          size_t * const restrict tilesz,
+          Tile * const restrict tile)
 {
-	static char format[8 + DIGITS(size_t)];
-	bool *tile = NULL;
-	if (tilesz == 0) {
-		char *input, newline;
-		if (fscanf(in, "%m[.#]%1c", &input, &newline) < 2) {
+	if (*tilesz == 0) {
+		const char * const begin = in->p;
+		while (inchar(in, '#') || inchar(in, '.'));
+		*tilesz = in->p - begin;
+		in->p = begin;
+		if (*tilesz == 0) {
 			fprintf(stderr, "Input failed on line %ju\n", *line);
-			exit(EXIT_FAILURE);
-		} else if (newline != '\n') {
-			fprintf(stderr,
-			        "Bad input format on line %ju\n",
-			        *line);
-			free(input);
-			exit(EXIT_FAILURE);
-		}
-		tilesz = strlen(input);
-		if ((tile = malloc(tilesz * tilesz * sizeof(bool))) == NULL) {
-			fputs("Could not allocate a new tile\n", stderr);
-			free(input);
-			exit(EXIT_FAILURE);
-		}
-		for (size_t i = 0; i < tilesz; i++)
-			tile[i] = input[i] == '#';
-		free(input);
-		(*line)++;
-		sprintf(format, "%%%zu[#.]%%c", tilesz);
-	} else {
-		if ((tile = malloc(tilesz * tilesz * sizeof(bool))) == NULL) {
-			fputs("Could not allocate a new tile\n", stderr);
-			exit(EXIT_FAILURE);
+			return false;
 		}
-		filltileline(in, (*line)++, format, tile, 0);
 	}
-	for (size_t l = 1; l < tilesz; l++)
-		filltileline(in, (*line)++, format, tile, l);
-	expectnewline(in, *line, tile);
-	return tile;
+	if (!allocorients(arena, tile, *tilesz)) {
+		fputs("Could not allocate a new tile\n", stderr);
+		return false;
+	}
+	for (size_t l = 0; l < *tilesz; l++) {
+		if (!filltileline(in, (*line)++, &tile->orient[0], l))
+			return false;
+	}
+	if (!ineol(in)) {
+		fprintf(stderr, "Expected new line on line %ju\n", *line);
+		return false;
+	}
+	return true;
 }
 
 static bool
-keepparsing(FILE * const in)
-{
-	const int c = fgetc(in);
-	if (c != EOF)
-		ungetc(c, in);
-	return c != EOF;
-}
-
-static void
-parse(FILE * const in)
+parse(Input * const restrict in,
+      Arena * const restrict arena,
+      Puzzle * const restrict p)
 {
 	Tile *tail = NULL, *tile;
 	uintmax_t line = 1, num = 0;
-	while (keepparsing(in)) {
-		num = parselabel(in, line++);
-		if (hastile(num)) {
+	while (!ineof(in)) {
+		if (!parselabel(in, line++, &num))
+			return false;
+		if (hastile(p->head, num)) {
 			fprintf(stderr, "Tile %ju appears twice\n", num);
-			exit(EXIT_FAILURE);
+			return false;
 		}
-		bool * const tiledata = parsetile(in, &line);
-		if ((tile = malloc(sizeof(Tile))) == NULL) {
+		if ((tile = aralloc(arena, sizeof(Tile))) == NULL) {
 			fputs("Could not allocate tile data\n", stderr);
-			free(tile);
-			exit(EXIT_FAILURE);
+			return false;
 		}
+		if (!parsetile(in, arena, &line, &p->tilesz, tile))
+			return false;
 		tile->num = num;
-		tile->data = tiledata;
 		tile->next = NULL;
-		if (head == NULL)
-			head = tile;
+		if (p->head == NULL)
+			p->head = tile;
 		else
 			tail->next = tile;
 		tail = tile;
 		line++;
 	}
+	return true;
+}
+
+/* Saves the tiles in the layout of a Shelf */
+static void
+savetiles(const Puzzle * const restrict p, AdventResult * const restrict out)
+{
+	const size_t words = gridwords(p->tilesz, p->tilesz);
+	Shelf shelf = { .ntiles = 0, .tilesz = p->tilesz };
+	for (const Tile *tile = p->head; tile != NULL; tile = tile->next)
+		shelf.ntiles++;
+	const size_t size = sizeof(Shelf)
+	                    + shelf.ntiles * (sizeof(uintmax_t)
+	                                      + words * sizeof(uint64_t));
+	char * const buf = aralloc(scratch(out), size);
+	if (buf == NULL) {
+		fputs("Could not allocate snapshot\n", stderr);
+		return;
+	}
+	memcpy(buf, &shelf, sizeof(Shelf));
+	uintmax_t * const num = (uintmax_t *) (buf + sizeof(Shelf));
+	uint64_t * const data = (uint64_t *) (num + shelf.ntiles);
+	size_t i = 0;
+	for (const Tile *tile = p->head; tile != NULL; tile = tile->next, i++) {
+		num[i] = tile->num;
+		memcpy(data + i * words,
+		       tile->orient[0].w,
+		       words * sizeof(uint64_t));
+	}
+	snapsave(out, SNAPSHOT, buf, size);
+}
+
+/* Copies the tiles of a Shelf of `size` bytes */
+static bool
+loadtiles(const Shelf * const restrict shelf,
+          const size_t size,
+          Arena * const restrict arena,
+          Puzzle * const restrict p)
+{
+	const size_t n = shelf->ntiles;
+	const size_t words = gridwords(shelf->tilesz, shelf->tilesz);
+	const size_t each = sizeof(uintmax_t) + words * sizeof(uint64_t);
+	if (size < sizeof(Shelf) || words == 0 || words > SIZE_MAX / 64
+	    || n > (SIZE_MAX - sizeof(Shelf)) / each
+	    || size != sizeof(Shelf) + n * each)
+		return false;
+	Tile * const tile = aralloc(arena, n * sizeof(Tile));
+	if (tile == NULL)
+		return false;
+	const uintmax_t * const num = (const uintmax_t *) (shelf + 1);
+	const uint64_t * const data = (const uint64_t *) (num + n);
+	for (size_t i = 0; i < n; i++) {
+		if (!allocorients(arena, &tile[i], shelf->tilesz))
+			return false;
+		memcpy(tile[i].orient[0].w,
+		       data + i * words,
+		       words * sizeof(uint64_t));
+		tile[i].num = num[i];
+		tile[i].next = i + 1 < n? &tile[i + 1] : NULL;
+	}
+	p->head = n > 0? tile : NULL;
+	p->tilesz = shelf->tilesz;
+	return true;
 }
 
 static uintmax_t
@@ -205,81 +291,26 @@ isqrt(const uintmax_t n)
 	return x;
 }
 
-static void
-checkperfectsquare(void)
+static bool
+checkperfectsquare(Puzzle * const p)
 {
 	uintmax_t num = 0;
-	for (const Tile *tile = head; tile != NULL; tile = tile->next)
+	for (const Tile *tile = p->head; tile != NULL; tile = tile->next)
 		num++;
-	jigsawsz = isqrt(num);
-	if (jigsawsz * jigsawsz != num) {
+	p->jigsawsz = isqrt(num);
+	if (num == 0) {
+		fputs("There are no tiles\n", stderr);
+		return false;
+	} else if (p->jigsawsz * p->jigsawsz != num) {
 		fprintf(stderr, "Number of tiles (%ju) is not a square\n", num);
-		exit(EXIT_FAILURE);
-	}
-}
-
-static void
-rotatebuf(const size_t sz, bool buf[sz][sz])
-{
-	for (size_t r = 0; 2 * r < sz; r++) {
-		for (size_t c = 0; 2 * c < sz; c++) {
-			const size_t invr = sz - 1 - r;
-			const size_t invc = sz - 1 - c;
-			const bool temp = buf[r][c];
-			buf[r][c] = buf[c][invr];
-			buf[c][invr] = buf[invr][invc];
-			buf[invr][invc] = buf[invc][r];
-			buf[invc][r] = temp;
-		}
-	}
-	if (sz % 2 == 0)
-		return;
-	for (size_t r = 0; 2 * r < sz; r++) {
-		const size_t h = sz / 2;
-		const bool temp = buf[r][h];
-		buf[r][h] = buf[h][sz - 1 - r];
-		buf[h][sz - 1 - r] = buf[sz - 1 - r][h];
-		buf[sz - 1 - r][h] = buf[h][r];
-		buf[h][r] = temp;
-	}
-}
-
-static void
-flipbuf(const size_t sz, bool buf[sz][sz])
-{
-	for (size_t r = 0; r < sz; r++) {
-		for (size_t c = 0; 2 * c < sz; c++) {
-			const bool temp = buf[r][c];
-			buf[r][c] = buf[r][sz - 1 - c];
-			buf[r][sz - 1 - c] = temp;
-		}
-	}
-}
-
-static bool
-nexttry(bool tileimg[tilesz][tilesz], Slot * const restrict s)
-{
-	if (s->flip) {
-		if (s->rot == 3)
-			return false;
-		s->rot++;
-		rotatebuf(tilesz, tileimg);
-		return true;
-	} else {
-		rotatebuf(tilesz, tileimg);
-		if (s->rot == 3) {
-			s->flip = true;
-			s->rot = 0;
-			flipbuf(tilesz, tileimg);
-		} else {
-			s->rot++;
-		}
-		return true;
+		return false;
 	}
+	return true;
 }
 
 static bool
-alreadyused(const Slot jigsaw[jigsawsz][jigsawsz],
+alreadyused(const size_t jigsawsz,
+            const Slot jigsaw[jigsawsz][jigsawsz],
             const size_t y,
             const size_t x,
             const Tile * const restrict tile)
@@ -297,236 +328,271 @@ alreadyused(const Slot jigsaw[jigsawsz][jigsawsz],
 	return false;
 }
 
-static void
-applyslot(bool buf[tilesz][tilesz], const Slot * const restrict slot)
-{
-	for (size_t r = 0; r < tilesz; r++) {
-		for (size_t c = 0; c < tilesz; c++)
-			buf[r][c] = slot->tile->data[r * tilesz + c];
-	}
-	if (slot->flip)
-		flipbuf(tilesz, buf);
-	for (uint_least8_t t = 0; t < slot->rot; t++)
-		rotatebuf(tilesz, buf);
-}
-
-static void
-filldown(bool down[restrict tilesz], const Slot * const restrict slot)
-{
-	bool tile[tilesz][tilesz];
-	applyslot(tile, slot);
-	for (size_t i = 0; i < tilesz; i++)
-		down[i] = tile[tilesz - 1][i];
-}
-
-static void
-fillright(bool right[restrict tilesz], const Slot * const restrict slot)
+static bool
+sameedge(const Grid * const a,
+         const size_t ya,
+         const Grid * const b,
+         const size_t yb)
 {
-	bool tile[tilesz][tilesz];
-	applyslot(tile, slot);
-	for (size_t i = 0; i < tilesz; i++)
-		right[i] = tile[i][tilesz - 1];
+	const uint64_t * const ra = gridrow(a, ya), * const rb = gridrow(b, yb);
+	for (size_t i = 0; i < a->stride; i++) {
+		if (ra[i] != rb[i])
+			return false;
+	}
+	return true;
 }
 
+/*
+ * The top row of a tile must match the bottom one of the tile above, and its
+ * left column the right one of the tile to its left, which are the top and
+ * bottom rows of both transposed
+ */
 static bool
-lastfits(const bool tile[tilesz][tilesz],
-         const size_t y,
-         const size_t x,
-         const bool up[restrict tilesz],
-         const bool left[restrict tilesz])
+fits(const Puzzle * const restrict p,
+     Slot jigsaw[p->jigsawsz][p->jigsawsz],
+     const size_t y,
+     const size_t x)
 {
-	for (size_t i = 0; i < tilesz; i++) {
-		if (y > 0 && tile[0][i] != up[i])
+	const size_t last = p->tilesz - 1;
+	const Slot * const s = &jigsaw[y][x];
+	if (y > 0) {
+		const Slot * const up = &jigsaw[y - 1][x];
+		if (!sameedge(&up->tile->orient[up->orient],
+		              last,
+		              &s->tile->orient[s->orient],
+		              0))
 			return false;
-		if (x > 0 && tile[i][0] != left[i])
+	}
+	if (x > 0) {
+		const Slot * const left = &jigsaw[y][x - 1];
+		if (!sameedge(&left->tile->orient[transposed(left->orient)],
+		              last,
+		              &s->tile->orient[transposed(s->orient)],
+		              0))
 			return false;
 	}
 	return true;
 }
 
 static bool
-backtrack(Slot jigsaw[jigsawsz][jigsawsz], const size_t y, const size_t x)
+backtrack(const Puzzle * const restrict p,
+          Slot jigsaw[p->jigsawsz][p->jigsawsz],
+          const size_t y,
+          const size_t x)
 {
-	bool up[tilesz], left[tilesz];
-	if (y > 0)
-		filldown(up, &jigsaw[y - 1][x]);
-	if (x > 0)
-		fillright(left, &jigsaw[y][x - 1]);
-	for (const Tile *tile = head; tile != NULL; tile = tile->next) {
-		if (alreadyused(jigsaw, y, x, tile))
+	const size_t jigsawsz = p->jigsawsz;
+	for (const Tile *tile = p->head; tile != NULL; tile = tile->next) {
+		if (alreadyused(jigsawsz, jigsaw, y, x, tile))
 			continue;
 		jigsaw[y][x].tile = tile;
-		jigsaw[y][x].flip = false;
-		jigsaw[y][x].rot = 0;
-		bool tileimg[tilesz][tilesz];
-		applyslot(tileimg, &jigsaw[y][x]);
-		do {
-			if (lastfits(tileimg, y, x, up, left)) {
-				if (x + 1 == jigsawsz) {
-					if (y + 1 == jigsawsz)
-						return true;
-					else if (backtrack(jigsaw, y + 1, 0))
-						return true;
-				} else if (backtrack(jigsaw, y, x + 1)) {
+		for (uint_fast8_t o = 0; o < 8; o++) {
+			jigsaw[y][x].orient = o;
+			if (!fits(p, jigsaw, y, x))
+				continue;
+			if (x + 1 == jigsawsz) {
+				if (y + 1 == jigsawsz)
 					return true;
-				}
+				else if (backtrack(p, jigsaw, y + 1, 0))
+					return true;
+			} else if (backtrack(p, jigsaw, y, x + 1)) {
+				return true;
 			}
-		} while (nexttry(tileimg, &jigsaw[y][x]));
+		}
 	}
 	return false;
 }
 
-static void
+static bool
 trymultiply(uintmax_t * const restrict p, const uintmax_t x)
 {
 	if (*p >= UINTMAX_MAX / x) {
 		fprintf(stderr, "%ju * %ju causes wraparound\n", *p, x);
-		exit(EXIT_FAILURE);
+		return false;
 	}
 	*p *= x;
+	return true;
 }
 
-static uintmax_t
-prodcorners(const Slot jigsaw[jigsawsz][jigsawsz])
+static bool
+prodcorners(const size_t jigsawsz,
+            const Slot jigsaw[jigsawsz][jigsawsz],
+            uintmax_t * const restrict p)
 {
-	uintmax_t p = jigsaw[0][0].tile->num;
-	trymultiply(&p, jigsaw[jigsawsz - 1][0].tile->num);
-	trymultiply(&p, jigsaw[0][jigsawsz - 1].tile->num);
-	trymultiply(&p, jigsaw[jigsawsz - 1][jigsawsz - 1].tile->num);
-	return p;
+	*p = jigsaw[0][0].tile->num;
+	return trymultiply(p, jigsaw[jigsawsz - 1][0].tile->num)
+	       && trymultiply(p, jigsaw[0][jigsawsz - 1].tile->num)
+	       && trymultiply(p, jigsaw[jigsawsz - 1][jigsawsz - 1].tile->num);
 }
 
 static void
-fillimage(bool image[imagesz][imagesz], const Slot jigsaw[jigsawsz][jigsawsz])
+fillimage(const Puzzle * const restrict p,
+          Grid * const restrict image,
+          const Slot jigsaw[p->jigsawsz][p->jigsawsz])
 {
-	for (size_t jy = 0; jy < jigsawsz; jy++) {
-		for (size_t jx = 0; jx < jigsawsz; jx++) {
-			bool tile[tilesz][tilesz];
-			applyslot(tile, &jigsaw[jy][jx]);
+	const size_t tilesz = p->tilesz;
+	for (size_t jy = 0; jy < p->jigsawsz; jy++) {
+		for (size_t jx = 0; jx < p->jigsawsz; jx++) {
+			const Slot * const s = &jigsaw[jy][jx];
+			const Grid * const tile = &s->tile->orient[s->orient];
 			for (size_t ty = 0; ty + 2 < tilesz; ty++) {
 				for (size_t tx = 0; tx + 2 < tilesz; tx++) {
 					size_t iy = jy * (tilesz - 2) + ty;
 					size_t ix = jx * (tilesz - 2) + tx;
-					image[iy][ix] = tile[ty + 1][tx + 1];
+					gridset(image,
+					        ix,
+					        iy,
+					        gridget(tile, tx + 1, ty + 1));
 				}
 			}
 		}
 	}
 }
 
+/*
+ * The image, another of its orientations, and where monsters start, the cells
+ * they cover and a grid moved about, all of the same size
+ */
+typedef struct {
+	Grid image, turned, match, cover, step;
+} Sea;
+
 static bool
-ismonster(const bool image[imagesz][imagesz], const size_t y, const size_t x)
+allocsea(Arena * const restrict arena,
+         Sea * const restrict sea,
+         const size_t imagesz)
 {
-	for (size_t dy = 0; dy < 3; dy++) {
-		for (size_t dx = 0; dx < 20; dx++) {
-			if (monster[dy][dx] && !image[y + dy][x + dx])
-				return false;
-		}
+	const size_t words = gridwords(imagesz, imagesz);
+	uint64_t * const w = words > 0 && words <= SIZE_MAX / 40
+	                     ? aralloc(arena, 5 * words * sizeof(uint64_t))
+	                     : NULL;
+	if (w == NULL) {
+		fputs("Could not allocate the image\n", stderr);
+		return false;
 	}
+	Grid * const grid[5] = {
+		&sea->image, &sea->turned, &sea->match, &sea->cover, &sea->step
+	};
+	for (size_t i = 0; i < 5; i++)
+		gridinit(grid[i], w + i * words, imagesz, imagesz);
 	return true;
 }
 
+/*
+ * Monsters start where the image holds every cell of one moved back by where
+ * it is in the monster
+ */
 static bool
-findmonsters(bool image[imagesz][imagesz])
+findmonsters(Sea * const restrict sea, const Grid * const restrict m)
 {
-	for (size_t y = 0; y + 2 < imagesz; y++) {
-		for (size_t x = 0; x + 19 < imagesz; x++) {
-			if (ismonster(image, y, x))
-				return true;
+	bool first = true;
+	for (size_t dy = 0; dy < m->height; dy++) {
+		for (size_t dx = 0; dx < m->width; dx++) {
+			if (!gridget(m, dx, dy))
+				continue;
+			gridshift(&sea->step, &sea->image, -dx, -dy);
+			if (first)
+				gridcopy(&sea->match, &sea->step);
+			else
+				gridand(&sea->match, &sea->match, &sea->step);
+			first = false;
 		}
 	}
-	return false;
+	return gridpopcount(&sea->match) > 0;
 }
 
 static bool
-fitformonsters(bool image[imagesz][imagesz])
+fitformonsters(Sea * const restrict sea, const Grid * const restrict m)
 {
-	for (uint_fast8_t t = 0; t < 3; t++) {
-		if (findmonsters(image))
+	for (uint_fast8_t t = 0; t < 8; t++) {
+		if (findmonsters(sea, m))
 			return true;
-		rotatebuf(imagesz, image);
-	}
-	if (findmonsters(image))
-		return true;
-	flipbuf(imagesz, image);
-	for (uint_fast8_t t = 0; t < 3; t++) {
-		if (findmonsters(image))
-			return true;
-		rotatebuf(imagesz, image);
-	}
-	return findmonsters(image);
-}
-
-static bool
-isinmonster(const bool image[imagesz][imagesz], const size_t y, const size_t x)
-{
-	if (!image[y][x])
-		return false;
-	for (size_t dy = 0; dy < 3; dy++) {
-		if (y < dy || y - dy >= imagesz - 2)
+		if (t == 3) {
+			gridflip(&sea->image, &sea->image);
 			continue;
-		for (size_t dx = 0; dx < 20; dx++) {
-			if (x < dx || x - dx >= imagesz - 19)
-				continue;
-			if (monster[dy][dx] && ismonster(image, y - dy, x - dx))
-				return true;
 		}
+		gridrotate(&sea->turned, &sea->image);
+		const Grid image = sea->turned;
+		sea->turned = sea->image;
+		sea->image = image;
 	}
 	return false;
 }
 
+/* Cells of the image which none of the monsters found covers */
 static uintmax_t
-roughness(const bool image[imagesz][imagesz])
+roughness(Sea * const restrict sea, const Grid * const restrict m)
 {
-	uintmax_t count = 0;
-	for (size_t y = 0; y < imagesz; y++) {
-		for (size_t x = 0; x < imagesz; x++) {
-			if (image[y][x] && !isinmonster(image, y, x))
-				count++;
+	gridclear(&sea->cover);
+	for (size_t dy = 0; dy < m->height; dy++) {
+		for (size_t dx = 0; dx < m->width; dx++) {
+			if (!gridget(m, dx, dy))
+				continue;
+			gridshift(&sea->step, &sea->match, dx, dy);
+			gridor(&sea->cover, &sea->cover, &sea->step);
 		}
 	}
-	return count;
+	return gridpopcount(&sea->image) - gridpopcount(&sea->cover);
 }
 
-static void
-freepieces(void)
+static int
+solve(Input * const restrict in,
+      Puzzle * const restrict p,
+      AdventResult * const restrict out)
 {
-	while (head != NULL) {
-		Tile * const next = head->next;
-		free(head->data);
-		free(head);
-		head = next;
+	size_t size;
+	const Shelf * const shelf = snapload(out, SNAPSHOT, &size);
+	if (shelf == NULL || !loadtiles(shelf, size, scratch(out), p)) {
+		if (!parse(in, scratch(out), p))
+			return EXIT_FAILURE;
+		savetiles(p, out);
 	}
-}
-
-int
-day20(FILE * const in)
-{
-	if (atexit(freepieces) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
-	parse(in);
-	if (!feof(in))
+	parsed(out);
+	if (!checkperfectsquare(p))
 		return EXIT_FAILURE;
-	checkperfectsquare();
-	Slot jigsaw[jigsawsz][jigsawsz];
-	if (!backtrack(jigsaw, 0, 0)) {
+	for (Tile *tile = p->head; tile != NULL; tile = tile->next)
+		orienttile(tile);
+	Slot jigsaw[p->jigsawsz][p->jigsawsz];
+	size_t phase = tracebegin(out, "Backtrack");
+	if (!backtrack(p, jigsaw, 0, 0)) {
 		fputs("No solution to the jigsaw was found\n", stderr);
 		return EXIT_FAILURE;
 	}
-	printf("Corners\t%ju\n", prodcorners(jigsaw));
-	if (tilesz <= 2) {
+	traceend(out, phase);
+	uintmax_t corners;
+	if (!prodcorners(p->jigsawsz, jigsaw, &corners))
+		return EXIT_FAILURE;
+	answeruint(out, 0, "Corners", corners);
+	if (p->tilesz <= 2) {
 		fprintf(stderr,
 		        "Tile size %zu is too small for part 2\n",
-		        tilesz);
+		        p->tilesz);
 		return EXIT_FAILURE;
 	}
-	imagesz = jigsawsz * (tilesz - 2);
-	bool image[imagesz][imagesz];
-	fillimage(image, jigsaw);
-	if (!fitformonsters(image)) {
+	const size_t imagesz = p->imagesz = p->jigsawsz * (p->tilesz - 2);
+	uint64_t words[MONSTER_HEIGHT];
+	Grid m;
+	Sea sea;
+	gridinit(&m, words, MONSTER_WIDTH, MONSTER_HEIGHT);
+	for (size_t y = 0; y < MONSTER_HEIGHT; y++) {
+		for (size_t x = 0; x < MONSTER_WIDTH; x++)
+			gridset(&m, x, y, monster[y][x] == '#');
+	}
+	if (!allocsea(scratch(out), &sea, imagesz))
+		return EXIT_FAILURE;
+	phase = tracebegin(out, "Find monsters");
+	fillimage(p, &sea.image, jigsaw);
+	if (!fitformonsters(&sea, &m)) {
 		fputs("No sea monsters were found despite rotating\n", stderr);
 		return EXIT_FAILURE;
 	}
-	printf("Rough\t%ju\n", roughness(image));
+	traceend(out, phase);
+	answeruint(out, 1, "Rough", roughness(&sea, &m));
 	return EXIT_SUCCESS;
 }
+
+int
+day20(Input * const in, AdventResult * const out)
+{
+	Puzzle p = { .head = NULL, .tilesz = 0, .jigsawsz = 0, .imagesz = 0 };
+	return solve(in, &p, out);
+}
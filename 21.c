@@ -6,18 +6,19 @@
  * http://www.wtfpl.net/ for more details.
  */
 #include <ctype.h>
-#include <limits.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-/* Upper bound to how many digits a given type may hold */
-#define DIGITS(T) (CHAR_BIT * 10 * sizeof(T) / (9 * sizeof(char)))
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
 
 struct List {
-	union { const char *str; size_t i; } val;
+	union { Span str; size_t i; } val;
 	struct List *next;
 };
 
@@ -31,29 +32,29 @@ struct Food {
 
 typedef struct Food Food;
 
-static Food *fdhead = NULL;
-
-static char **ingarr = NULL;
-static size_t cingarr = 0, singarr = 0;
-
-static char **agarr = NULL;
-static size_t cagarr = 0, sagarr = 0;
+typedef struct {
+	Arena *arena;
+	Food *fdhead;
+	Span *ingarr;
+	size_t cingarr, singarr;
+	Span *agarr;
+	size_t cagarr, sagarr;
+} Notes;
 
 static bool
-addtoarr(char * const restrict str,
-         char *** const restrict arr,
+addtoarr(const Span str,
+         Span ** const restrict arr,
          size_t * const restrict cap,
          size_t * const restrict sz,
          const size_t k)
 {
 	if (*sz == *cap) {
-		*cap = (*cap > 0)? 2 * *cap : 1;
-		char ** const new = realloc(*arr, *cap * sizeof(char *));
-		if (new == NULL) {
-			free(str);
+		const size_t newcap = (*cap > 0)? 2 * *cap : 1;
+		Span * const new = realloc(*arr, newcap * sizeof(Span));
+		if (new == NULL)
 			return false;
-		}
 		*arr = new;
+		*cap = newcap;
 	}
 	for (size_t i = (*sz)++; i > k; i--)
 		(*arr)[i] = (*arr)[i - 1];
@@ -61,43 +62,35 @@ addtoarr(char * const restrict str,
 	return true;
 }
 
-static const char *
-addstr(char * const restrict str,
-       char *** const restrict arr,
+/* Adds `str` to the sorted array unless it is already there */
+static bool
+addstr(const Span str,
+       Span ** const restrict arr,
        size_t * const restrict cap,
        size_t * const restrict sz)
 {
 	size_t a = 0, b = *sz;
 	while (a + 1 < b) {
 		const size_t m = (a & b) + ((a ^ b) >> 1);
-		const int cmp = strcmp(str, (*arr)[m]);
-		if (cmp < 0) {
+		const int cmp = spancmp(str, (*arr)[m]);
+		if (cmp < 0)
 			b = m;
-		} else if (cmp > 0) {
+		else if (cmp > 0)
 			a = m;
-		} else {
-			free(str);
-			return (*arr)[m];
-		}
-	}
-	const int cmp = (*sz > 0)? strcmp(str, (*arr)[a]) : -1;
-	if (cmp == 0) {
-		free(str);
-	} else {
-		a += cmp > 0;
-		if (!addtoarr(str, arr, cap, sz, a))
-			return NULL;
+		else
+			return true;
 	}
-	return (*arr)[a];
+	const int cmp = (*sz > 0)? spancmp(str, (*arr)[a]) : -1;
+	return cmp == 0 || addtoarr(str, arr, cap, sz, a + (cmp > 0));
 }
 
 static size_t
-getindex(const char * const restrict str, const size_t sz, char *arr[sz])
+getindex(const Span str, const size_t sz, const Span arr[sz])
 {
 	size_t a = 0, b = sz;
 	while (a + 1 < b) {
 		const size_t m = (a & b) + ((a ^ b) >> 1);
-		const int cmp = strcmp(str, arr[m]);
+		const int cmp = spancmp(str, arr[m]);
 		if (cmp < 0)
 			b = m;
 		else if (cmp > 0)
@@ -108,201 +101,134 @@ getindex(const char * const restrict str, const size_t sz, char *arr[sz])
 	return a;
 }
 
-static void
-freelist(List *list)
-{
-	while (list != NULL) {
-		List * const next = list->next;
-		free(list);
-		list = next;
-	}
-}
-
 static List *
-parseing(FILE * const restrict in, bool * const restrict hasag)
+parseing(Input * const restrict in,
+         Notes * const restrict n,
+         bool * const restrict hasag)
 {
 	List *ihead = NULL, *itail = NULL;
-	char *input, space;
-	int result;
-	while ((result = fscanf(in, "%m[a-z]%1c", &input, &space)) >= 1) {
-		const char *sing = addstr(input, &ingarr, &cingarr, &singarr);
-		if (sing == NULL) {
-			freelist(ihead);
-			return NULL;
-		}
-		List * const new = malloc(sizeof(List));
-		if (new == NULL) {
-			freelist(ihead);
+	Span input;
+	while ((input = inlower(in)).len > 0) {
+		List * const new = aralloc(n->arena, sizeof(List));
+		if (new == NULL
+		    || !addstr(input, &n->ingarr, &n->cingarr, &n->singarr))
 			return NULL;
-		}
-		new->val.str = sing;
+		new->val.str = input;
 		new->next = NULL;
 		if (ihead == NULL)
 			ihead = new;
 		else
 			itail->next = new;
-		if (result == 2) {
-			if (space == '\n')
-				return ihead;
-			if (!isspace(space)) {
-				freelist(ihead);
-				return NULL;
-			}
-		} else if (result == 1 && feof(in)) {
+		itail = new;
+		const int c = inget(in);
+		if (c == '\n' || c == EOF)
 			return ihead;
-		} else {
-			freelist(ihead);
+		if (!isspace(c))
 			return NULL;
-		}
-		itail = new;
 	}
-	if (ferror(in)) {
-		freelist(ihead);
-		return NULL;
-	} else if (feof(in)) {
-		return ihead;
-	}
-	const int c = fgetc(in);
-	*hasag = c == '(';
-	if (c == '(' || c == EOF) {
-		return ihead;
-	} else {
-		freelist(ihead);
-		return NULL;
-	}
-}
-
-static int
-keepparsingag(FILE * const in)
-{
-	const int c = fgetc(in);
-	if (c == ',')
-		return 1;
-	if (c == ')')
-		return 0;
-	return -1;
+	*hasag = inchar(in, '(');
+	return *hasag || ineof(in)? ihead : NULL;
 }
 
 static bool
-parseag(FILE * const restrict in, List ** const restrict agref)
+parseag(Input * const restrict in,
+        Notes * const restrict n,
+        List ** const restrict agref)
 {
-	char *input;
-	if (fscanf(in, "contains %m[a-z]", &input) < 1)
-		return false;
-	const char *sag = addstr(input, &agarr, &cagarr, &sagarr);
-	if (sag == NULL)
+	if (!inlit(in, "contains "))
 		return false;
-	List * const ahead = malloc(sizeof(List));
-	if (ahead == NULL)
-		return false;
-	ahead->val.str = sag;
-	ahead->next = NULL;
-	List *atail = ahead;
-	int result;
-	while ((result = keepparsingag(in)) > 0) {
-		if (fscanf(in, " %m[a-z]", &input) < 1) {
-			freelist(ahead);
-			return false;
-		}
-		if ((sag = addstr(input, &agarr, &cagarr, &sagarr)) == NULL) {
-			freelist(ahead);
+	List *ahead = NULL, *atail = NULL;
+	do {
+		inspace(in);
+		const Span input = inlower(in);
+		if (input.len == 0
+		    || !addstr(input, &n->agarr, &n->cagarr, &n->sagarr))
 			return false;
-		}
-		List * const new = malloc(sizeof(List));
-		if (new == NULL) {
-			freelist(ahead);
+		List * const new = aralloc(n->arena, sizeof(List));
+		if (new == NULL)
 			return false;
-		}
-		new->val.str = sag;
+		new->val.str = input;
 		new->next = NULL;
-		atail->next = new;
+		if (ahead == NULL)
+			ahead = new;
+		else
+			atail->next = new;
 		atail = new;
-	}
-	if (result == 0) {
-		const int next = fgetc(in);
-		if (next == '\n' || next == EOF) {
-			*agref = ahead;
-			return true;
-		}
-	}
-	freelist(ahead);
-	return false;
-}
-
-static bool
-keepparsing(FILE * const in)
-{
-	const int c = fgetc(in);
-	if (c == EOF)
+	} while (inchar(in, ','));
+	if (!inchar(in, ')') || !ineol(in))
 		return false;
-	ungetc(c, in);
+	*agref = ahead;
 	return true;
 }
 
-static void
-parsepanic(const uintmax_t line,
-           List * const restrict list,
-           const char * const restrict err)
+static bool
+parsefail(const uintmax_t line, const char * const err)
 {
-	freelist(list);
 	fprintf(stderr, "Could not %s on line %ju\n", err, line);
-	exit(EXIT_FAILURE);
+	return false;
 }
 
-static void
-parse(FILE * const in)
+static bool
+parse(Input * const restrict in, Notes * const restrict n)
 {
 	uintmax_t line = UINTMAX_C(1);
 	Food *fdtail = NULL;
-	while (keepparsing(in)) {
+	while (!ineof(in)) {
 		bool hasag = false;
-		List * const ing = parseing(in, &hasag);
+		List * const ing = parseing(in, n, &hasag);
 		if (ing == NULL)
-			parsepanic(line, NULL, "parse ingredients");
-		Food * const new = malloc(sizeof(Food));
+			return parsefail(line, "parse ingredients");
+		Food * const new = aralloc(n->arena, sizeof(Food));
 		if (new == NULL)
-			parsepanic(line, ing, "allocade food data");
+			return parsefail(line, "allocate food data");
 		new->ing = ing;
 		new->ag = NULL;
 		new->next = NULL;
 		if (hasag) {
 			List *ag;
-			if (!parseag(in, &ag))
-				parsepanic(line, ing, "parse allergen data");
+			if (!parseag(in, n, &ag))
+				return parsefail(line, "parse allergen data");
 			new->ag = ag;
 		}
-		if (fdhead == NULL)
-			fdhead = new;
+		if (n->fdhead == NULL)
+			n->fdhead = new;
 		else
 			fdtail->next = new;
 		fdtail = new;
 		line++;
 	}
+	return true;
 }
 
 static void
-convert(void)
+convert(Notes * const n)
 {
-	for (Food *food = fdhead; food != NULL; food = food->next) {
+	for (Food *food = n->fdhead; food != NULL; food = food->next) {
 		for (List *node = food->ing; node != NULL; node = node->next)
-			node->val.i = getindex(node->val.str, singarr, ingarr);
+			node->val.i = getindex(node->val.str,
+			                       n->singarr,
+			                       n->ingarr);
 		for (List *node = food->ag; node != NULL; node = node->next)
-			node->val.i = getindex(node->val.str, sagarr, agarr);
+			node->val.i = getindex(node->val.str,
+			                       n->sagarr,
+			                       n->agarr);
 	}
 }
 
 static void
-match(bool inghasag[singarr][sagarr])
+match(const Notes * const restrict n,
+      bool inghasag[n->singarr][n->sagarr])
 {
-	for (const Food *fd = fdhead; fd != NULL; fd = fd->next) {
+	const size_t singarr = n->singarr, sagarr = n->sagarr;
+	for (const Food *fd = n->fdhead; fd != NULL; fd = fd->next) {
 		bool hasing[singarr];
 		memset(hasing, 0, sizeof(hasing));
-		for (const List *n = fd->ing; n != NULL; n = n->next)
-			hasing[n->val.i] = true;
+		for (const List *l = fd->ing; l != NULL; l = l->next)
+			hasing[l->val.i] = true;
 		bool hasag[sagarr];
 		memset(hasag, 0, sizeof(hasag));
-		for (const List *n = fd->ag; n != NULL; n = n->next)
-			hasag[n->val.i] = true;
+		for (const List *l = fd->ag; l != NULL; l = l->next)
+			hasag[l->val.i] = true;
 		for (size_t ing = 0; ing < singarr; ing++) {
 			for (size_t ag = 0; ag < sagarr; ag++) {
 				if (hasag[ag] && !hasing[ing])
@@ -334,8 +260,10 @@ match(bool inghasag[singarr][sagarr])
 }
 
 static uintmax_t
-countinert(const bool inghasag[singarr][sagarr])
+countinert(const Notes * const restrict n,
+           const bool inghasag[n->singarr][n->sagarr])
 {
+	const size_t singarr = n->singarr, sagarr = n->sagarr;
 	bool inert[singarr];
 	for (size_t ing = 0; ing < singarr; ing++) {
 		inert[ing] = true;
@@ -347,60 +275,90 @@ countinert(const bool inghasag[singarr][sagarr])
 		}
 	}
 	uintmax_t count = 0;
-	for (const Food *food = fdhead; food != NULL; food = food->next) {
-		for (const List *n = food->ing; n != NULL; n = n->next)
-			count += inert[n->val.i];
+	for (const Food *food = n->fdhead; food != NULL; food = food->next) {
+		for (const List *l = food->ing; l != NULL; l = l->next)
+			count += inert[l->val.i];
 	}
 	return count;
 }
 
-static void
-printinglist(const bool inghasag[singarr][sagarr])
+static bool
+answerlist(const Notes * const restrict n,
+           const bool inghasag[n->singarr][n->sagarr],
+           AdventResult * const restrict out)
 {
-	fputs("List\t", stdout);
-	for (size_t ag = 0; ag < sagarr; ag++) {
-		if (ag != 0)
-			putchar(',');
-		for (size_t ing = 0; ing < singarr; ing++) {
+	size_t len = 1;
+	for (size_t ag = 0; ag < n->sagarr; ag++) {
+		for (size_t ing = 0; ing < n->singarr; ing++) {
 			if (inghasag[ing][ag])
-				fputs(ingarr[ing], stdout);
+				len += n->ingarr[ing].len + 1;
+		}
+	}
+	char * const list = aralloc(n->arena, len);
+	if (list == NULL) {
+		fputs("Could not allocate the ingredient list\n", stderr);
+		return false;
+	}
+	char *it = list;
+	for (size_t ag = 0; ag < n->sagarr; ag++) {
+		if (ag != 0)
+			*it++ = ',';
+		for (size_t ing = 0; ing < n->singarr; ing++) {
+			if (inghasag[ing][ag]) {
+				const Span name = n->ingarr[ing];
+				memcpy(it, name.s, name.len);
+				it += name.len;
+			}
 		}
 	}
-	putchar('\n');
+	*it = 0;
+	return answerstr(out, 1, "List", list);
 }
 
 static void
-freedata(void)
+freedata(Notes * const n)
 {
-	while (fdhead != NULL) {
-		freelist(fdhead->ing);
-		freelist(fdhead->ag);
-		Food * const next = fdhead->next;
-		free(fdhead);
-		fdhead = next;
-	}
-	for (size_t i = 0; i < singarr; i++)
-		free(ingarr[i]);
-	free(ingarr);
-	for (size_t i = 0; i < sagarr; i++)
-		free(agarr[i]);
-	free(agarr);
+	free(n->ingarr);
+	free(n->agarr);
 }
 
-int
-day21(FILE * const in)
+static int
+solve(Input * const restrict in,
+      Notes * const restrict n,
+      AdventResult * const restrict out)
 {
-	if (atexit(freedata) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
-	parse(in);
-	convert();
-	bool inghasag[singarr][sagarr];
-	for (size_t ing = 0; ing < singarr; ing++) {
-		for (size_t ag = 0; ag < sagarr; ag++)
+	if (!parse(in, n))
+		return EXIT_FAILURE;
+	parsed(out);
+	if (n->singarr == 0 || n->sagarr == 0) {
+		fputs("No ingredient or no allergen found\n", stderr);
+		return EXIT_FAILURE;
+	}
+	convert(n);
+	bool inghasag[n->singarr][n->sagarr];
+	for (size_t ing = 0; ing < n->singarr; ing++) {
+		for (size_t ag = 0; ag < n->sagarr; ag++)
 			inghasag[ing][ag] = true;
 	}
-	match(inghasag);
-	printf("Inert\t%ju\n", countinert(inghasag));
-	printinglist(inghasag);
-	return EXIT_FAILURE;
+	match(n, inghasag);
+	answeruint(out, 0, "Inert", countinert(n, inghasag));
+	return answerlist(n, inghasag, out)? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int
+day21(Input * const in, AdventResult * const out)
+{
+	Notes n = {
+		.arena = scratch(out),
+		.fdhead = NULL,
+		.ingarr = NULL,
+		.cingarr = 0,
+		.singarr = 0,
+		.agarr = NULL,
+		.cagarr = 0,
+		.sagarr = 0
+	};
+	const int result = solve(in, &n, out);
+	freedata(&n);
+	return result;
 }
@@ -5,7 +5,6 @@
  * To Public License, Version 2, as published by Sam Hocevar. See
  * http://www.wtfpl.net/ for more details.
  */
-#include <ctype.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <stdbool.h>
@@ -13,6 +12,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+
 /* Upper bound to how many digits a type may hold */
 #define DIGITS(T) (CHAR_BIT * 10 * sizeof(T) / (9 * sizeof(char)))
 
@@ -35,109 +39,78 @@ struct History {
 
 typedef struct History History;
 
-static int recursivecombat_rec(Card *[2], Card *[2], uintmax_t[2], uintmax_t *);
-
-static Card *card[2] = { NULL, NULL };
-static size_t totalcards = 0;
+static int recursivecombat_rec(Arena *,
+                               Card *[2],
+                               Card *[2],
+                               uintmax_t[2],
+                               uintmax_t *);
 
-static void
-freelist(Card *list)
-{
-	while (list != NULL) {
-		Card * const next = list->next;
-		free(list);
-		list = next;
-	}
-}
-
-static void
-freedecks(Card *deck[const 2])
-{
-	freelist(deck[0]);
-	freelist(deck[1]);
-}
-
-static void
-freehistory(History * const his)
-{
-	if (his == NULL)
-		return;
-	freehistory(his->left);
-	freehistory(his->right);
-	free(his->deck[0].a);
-	free(his->deck[1].a);
-	free(his);
-}
-
-static uintmax_t
-consumespaces(FILE * const in, uintmax_t line)
-{
-	int c;
-	while (isspace(c = fgetc(in))) {
-		if (c == '\n')
-			line++;
-	}
-	ungetc(c, in);
-	return line;
-}
-
-static uintmax_t
-parseplayer(FILE * const in, const uint_fast8_t pnum, uintmax_t line)
+static bool
+parseplayer(Input * const restrict in,
+            Arena * const restrict arena,
+            Card ** const restrict deck,
+            const uint_fast8_t pnum,
+            uintmax_t * const restrict line)
 {
-	int num;
-	char buf[12];
-	sprintf(buf, "Player %" PRIuFAST8 ":%%n", pnum + 1);
-	fscanf(in, buf, &num);
-	if (num == 0) {
-		fprintf(stderr, "Invalid player header on line %ju\n", line);
-		exit(EXIT_FAILURE);
+	uintmax_t num;
+	if (!inlit(in, "Player ") || !inuint(in, &num) || num != pnum + 1u
+	    || !inchar(in, ':')) {
+		fprintf(stderr, "Invalid player header on line %ju\n", *line);
+		return false;
 	}
 	Card *tail = NULL;
 	for (;;) {
 		uintmax_t val;
-		line = consumespaces(in, line);
-		if (fscanf(in, "%ju", &val) < 1)
+		*line += inspace(in);
+		if (!inuint(in, &val))
 			break;
-		Card * const new = malloc(sizeof(Card));
+		Card * const new = aralloc(arena, sizeof(Card));
 		if (new == NULL) {
-			fprintf(stderr, "%ju: Could not allocate card\n", line);
-			exit(EXIT_FAILURE);
+			fprintf(stderr,
+			        "%ju: Could not allocate card\n",
+			        *line);
+			return false;
 		}
 		new->val = val;
 		new->next = NULL;
-		if (card[pnum] == NULL)
-			card[pnum] = new;
+		if (*deck == NULL)
+			*deck = new;
 		else
 			tail->next = new;
 		tail = new;
-		totalcards++;
 	}
-	if (ferror(in)) {
-		fprintf(stderr, "%ju: Internal error while parsing\n", line);
-		exit(EXIT_FAILURE);
-	}
-	return line;
+	return true;
 }
 
 static bool
-parse(FILE * const in)
+parse(Input * const restrict in,
+      Arena * const restrict arena,
+      Card *card[const 2])
 {
-	parseplayer(in, 1, parseplayer(in, 0, 1));
-	return feof(in);
+	uintmax_t line = 1;
+	if (!parseplayer(in, arena, &card[0], 0, &line)
+	    || !parseplayer(in, arena, &card[1], 1, &line))
+		return false;
+	if (!ineof(in)) {
+		fputs("Did not parse the entire puzzle input\n", stderr);
+		return false;
+	}
+	return true;
 }
 
-static uintmax_t
-regularcombat(void)
+static bool
+regularcombat(Arena * const restrict arena,
+              Card * const card[const 2],
+              uintmax_t * const restrict score)
 {
 	Card *head[2] = { NULL, NULL }, *tail[2] = { NULL, NULL };
 	uintmax_t ncard = 0;
 	for (size_t p = 0; p < 2; p++) {
 		for (const Card *it = card[p]; it != NULL; it = it->next) {
-			Card * const new = malloc(sizeof(Card));
+			Card * const new = aralloc(arena, sizeof(Card));
 			if (new == NULL) {
 				fputs("Could not allocate card copy\n", stderr);
-				freedecks(head);
-				exit(EXIT_FAILURE);
+				return false;
 			}
 			new->val = it->val;
 			new->next = NULL;
@@ -160,21 +133,20 @@ regularcombat(void)
 		head[lose]->next = NULL;
 		head[lose] = temp;
 	}
-	uintmax_t score = 0;
+	*score = 0;
 	const size_t win = head[1] != NULL;
-	while (head[win] != NULL) {
-		score += head[win]->val * ncard--;
-		Card * const next = head[win]->next;
-		free(head[win]);
-		head[win] = next;
-	}
-	return score;
+	for (const Card *c = head[win]; c != NULL; c = c->next)
+		*score += c->val * ncard--;
+	return true;
 }
 
 static bool
-clonedeck(CardSlice * const slice, const Card *card)
+clonedeck(Arena * const restrict arena,
+          CardSlice * const restrict slice,
+          const Card *card,
+          const uintmax_t ncard)
 {
-	if ((slice->a = malloc(totalcards * sizeof(uintmax_t))) == NULL)
+	if ((slice->a = aralloc(arena, ncard * sizeof(uintmax_t))) == NULL)
 		return false;
 	slice->sz = 0;
 	while (card != NULL) {
@@ -203,20 +175,22 @@ cmpdeck(const Card *a, const CardSlice *b)
 	return 1;
 }
 
+/* The subgame's copies and history are dropped once it is decided */
 static int
-playround(Card *card[2], const uintmax_t ncard[2])
+playround(Arena * const arena, Card *card[2], const uintmax_t ncard[2])
 {
 	if (ncard[0] <= card[0]->val || ncard[1] <= card[1]->val)
 		return card[1]->val > card[0]->val;
 	/* Recursive game */
+	const ArenaMark mark = armark(arena);
 	Card *copy[2] = { NULL, NULL }, *tail[2] = { NULL, NULL };
 	uintmax_t ncard_copy[2] = { card[0]->val, card[1]->val };
 	for (size_t p = 0; p < 2; p++) {
 		const Card *it = card[p]->next;
 		for (uintmax_t i = 0; i < ncard_copy[p]; i++) {
-			Card * const new = malloc(sizeof(Card));
+			Card * const new = aralloc(arena, sizeof(Card));
 			if (new == NULL) {
-				freedecks(copy);
+				arreset(arena, mark);
 				return -1;
 			}
 			new->val = it->val;
@@ -229,8 +203,12 @@ playround(Card *card[2], const uintmax_t ncard[2])
 			it = it->next;
 		}
 	}
-	const int result = recursivecombat_rec(copy, tail, ncard_copy, NULL);
-	freedecks(copy);
+	const int result = recursivecombat_rec(arena,
+	                                       copy,
+	                                       tail,
+	                                       ncard_copy,
+	                                       NULL);
+	arreset(arena, mark);
 	return result;
 }
 
@@ -242,62 +220,54 @@ cmphistory(Card *lhs[2], const CardSlice rhs[2])
 }
 
 static bool
-addleaf(History ** const ptr, Card *deck[2])
+addleaf(Arena * const restrict arena,
+        History ** const restrict ptr,
+        Card *deck[2],
+        const uintmax_t ncard[2])
 {
-	History * const new = malloc(sizeof(History));
-	if (new == NULL)
-		return false;
-	if (!clonedeck(new->deck, deck[0])) {
-		free(new);
+	History * const new = aralloc(arena, sizeof(History));
+	if (new == NULL || !clonedeck(arena, new->deck, deck[0], ncard[0])
+	    || !clonedeck(arena, new->deck + 1, deck[1], ncard[1]))
 		return false;
-	}
-	if (!clonedeck(new->deck + 1, deck[1])) {
-		free(new->deck[0].a);
-		free(new);
-		return false;
-	}
 	new->left = new->right = NULL;
 	*ptr = new;
 	return true;
 }
 
 static int
-checkhistory(History ** const his, Card *deck[2])
+checkhistory(Arena * const restrict arena,
+             History ** const restrict his,
+             Card *deck[2],
+             const uintmax_t ncard[2])
 {
 	if (*his == NULL)
-		return addleaf(his, deck)? 0 : -1;
+		return addleaf(arena, his, deck, ncard)? 0 : -1;
 	History *it = *his;
 	for (;;) {
 		const int cmp = cmphistory(deck, it->deck);
 		if (cmp == 0)
 			return 1;
-		if (cmp < 0) {
-			if (it->left == NULL)
-				return addleaf(&it->left, deck)? 0 : -1;
-			it = it->left;
-		} else {
-			if (it->right == NULL)
-				return addleaf(&it->right, deck)? 0 : -1;
-			it = it->right;
-		}
+		History ** const next = cmp < 0? &it->left : &it->right;
+		if (*next == NULL)
+			return addleaf(arena, next, deck, ncard)? 0 : -1;
+		it = *next;
 	}
 }
 
 static int
-recursivecombat_rec(Card *head[2],
+recursivecombat_rec(Arena * const restrict arena,
+                    Card *head[2],
                     Card *tail[2],
                     uintmax_t ncard[restrict 2],
                     uintmax_t * const restrict score)
 {
 	History *his = NULL;
 	while (head[0] != NULL && head[1] != NULL) {
-		const int hischeck = checkhistory(&his, head);
+		const int hischeck = checkhistory(arena, &his, head, ncard);
 		if (hischeck < 0) {
-			freehistory(his);
 			return -1;
 		} else if (hischeck > 0) {
 			/* Player 1 wins */
-			freehistory(his);
 			if (score != NULL) {
 				while (head[0] != NULL) {
 					*score += head[0]->val * ncard[0]--;
@@ -306,11 +276,9 @@ recursivecombat_rec(Card *head[2],
 			}
 			return 0;
 		}
-		const int win = playround(head, ncard), lose = !win;
-		if (win < 0) {
-			freehistory(his);
+		const int win = playround(arena, head, ncard), lose = !win;
+		if (win < 0)
 			return -1;
-		}
 		tail[win] = tail[win]->next = head[win];
 		Card *temp = head[win]->next;
 		head[win]->next = NULL;
@@ -324,7 +292,6 @@ recursivecombat_rec(Card *head[2],
 		if (head[lose] == NULL)
 			break;
 	}
-	freehistory(his);
 	int win = head[1] != NULL;
 	if (score != NULL) {
 		for (const Card *c = head[win]; c != NULL; c = c->next)
@@ -334,7 +301,9 @@ recursivecombat_rec(Card *head[2],
 }
 
 static int
-recursivecombat(uintmax_t * const score)
+recursivecombat(Arena * const restrict arena,
+                Card *card[const 2],
+                uintmax_t * const restrict score)
 {
 	Card *tail[2];
 	uintmax_t ncard[2] = { 1, 1 };
@@ -342,34 +311,280 @@ recursivecombat(uintmax_t * const score)
 		for (tail[p] = card[p]; tail[p]->next; tail[p] = tail[p]->next)
 			ncard[p]++;
 	}
-	return recursivecombat_rec(card, tail, ncard, score);
+	return recursivecombat_rec(arena, card, tail, ncard, score);
+}
+
+/*
+ * The fast engine keeps decks in rings of a power of two cards, `mask` plus
+ * one, starting at `head`, and the states of a game in a hash table rather
+ * than a tree of deck copies
+ */
+typedef struct {
+	uintmax_t *card;
+	size_t head, n, mask;
+} Ring;
+
+/*
+ * States seen in a game, each the size of the first deck then the cards of
+ * both, `len` values in all, which are laid out in `tmp` to be looked up; a
+ * hash of 0 marks an empty slot
+ */
+typedef struct {
+	uint64_t *hash;
+	uintmax_t **state, *tmp;
+	size_t size, used, len;
+} Seen;
+
+static uintmax_t
+ringat(const Ring * const r, const size_t i)
+{
+	return r->card[(r->head + i) & r->mask];
+}
+
+static uintmax_t
+ringpop(Ring * const r)
+{
+	const uintmax_t c = r->card[r->head];
+	r->head = (r->head + 1) & r->mask;
+	r->n--;
+	return c;
 }
 
 static void
-freedata(void)
+ringpush(Ring * const r, const uintmax_t c)
 {
-	freedecks(card);
+	r->card[(r->head + r->n++) & r->mask] = c;
 }
 
-int
-day22(FILE * const in)
+/* Copies the cards of a ring in order to `to`; returns past the last one */
+static uintmax_t *
+ringflat(uintmax_t * const restrict to, const Ring * const restrict r)
 {
-	if (atexit(freedata) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
-	if (!parse(in)) {
-		fputs("Did not parse the entire puzzle input\n", stderr);
+	const size_t first = r->mask + 1 - r->head < r->n
+	                     ? r->mask + 1 - r->head : r->n;
+	memcpy(to, r->card + r->head, first * sizeof(uintmax_t));
+	memcpy(to + first, r->card, (r->n - first) * sizeof(uintmax_t));
+	return to + r->n;
+}
+
+/* Makes a ring room for `n` cards, holding the first `take` of `from` */
+static bool
+ringcopy(Arena * const restrict arena,
+         Ring * const restrict r,
+         const Ring * const restrict from,
+         const size_t take,
+         const size_t n)
+{
+	size_t cap = 1;
+	while (cap < n)
+		cap *= 2;
+	if ((r->card = aralloc(arena, cap * sizeof(uintmax_t))) == NULL)
+		return false;
+	r->head = 0;
+	r->n = 0;
+	r->mask = cap - 1;
+	for (size_t i = 0; i < take; i++)
+		ringpush(r, ringat(from, i));
+	return true;
+}
+
+static uint64_t
+hashstate(const uintmax_t * const state, const size_t len)
+{
+	uint64_t h = UINT64_C(0xcbf29ce484222325);
+	for (size_t i = 0; i < len; i++)
+		h = (h ^ state[i]) * UINT64_C(0x100000001b3);
+	h ^= h >> 29;
+	return h != 0? h : 1;
+}
+
+static bool
+seengrow(Arena * const restrict arena, Seen * const restrict seen)
+{
+	const size_t size = seen->size > 0? 2 * seen->size : 64;
+	uint64_t * const hash = aralloc(arena, size * sizeof(uint64_t));
+	uintmax_t ** const state = aralloc(arena, size * sizeof(uintmax_t *));
+	if (hash == NULL || state == NULL)
+		return false;
+	memset(hash, 0, size * sizeof(uint64_t));
+	for (size_t i = 0; i < seen->size; i++) {
+		if (seen->hash[i] == 0)
+			continue;
+		size_t j = seen->hash[i] & (size - 1);
+		while (hash[j] != 0)
+			j = (j + 1) & (size - 1);
+		hash[j] = seen->hash[i];
+		state[j] = seen->state[i];
+	}
+	seen->hash = hash;
+	seen->state = state;
+	seen->size = size;
+	return true;
+}
+
+/* Returns 1 if the decks were seen before, 0 once they are added, or -1 */
+static int
+seenadd(Arena * const restrict arena,
+        Seen * const restrict seen,
+        const Ring deck[const 2])
+{
+	if (2 * (seen->used + 1) > seen->size && !seengrow(arena, seen))
+		return -1;
+	const size_t size = seen->len * sizeof(uintmax_t);
+	seen->tmp[0] = deck[0].n;
+	ringflat(ringflat(seen->tmp + 1, &deck[0]), &deck[1]);
+	const uint64_t h = hashstate(seen->tmp, seen->len);
+	size_t i = h & (seen->size - 1);
+	for (; seen->hash[i] != 0; i = (i + 1) & (seen->size - 1)) {
+		if (seen->hash[i] == h
+		    && memcmp(seen->state[i], seen->tmp, size) == 0)
+			return 1;
+	}
+	uintmax_t * const state = aralloc(arena, size);
+	if (state == NULL)
+		return -1;
+	memcpy(state, seen->tmp, size);
+	seen->hash[i] = h;
+	seen->state[i] = state;
+	seen->used++;
+	return 0;
+}
+
+/*
+ * A subgame goes to the first player if they hold a card higher than all
+ * others and than the number of cards: that card never starts a subgame nor
+ * loses a round, so the first player can never run out
+ */
+static bool
+firstholdshighest(const Ring deck[const 2])
+{
+	uintmax_t high[2] = { 0, 0 };
+	for (size_t p = 0; p < 2; p++) {
+		for (size_t i = 0; i < deck[p].n; i++) {
+			const uintmax_t c = ringat(&deck[p], i);
+			high[p] = c > high[p]? c : high[p];
+		}
+	}
+	return high[0] > high[1] && high[0] >= deck[0].n + deck[1].n;
+}
+
+/* Returns the winner of a game, scoring it unless `score` is NULL, or -1 */
+static int
+fastgame(Arena * const restrict arena,
+         Ring deck[const 2],
+         uintmax_t * const restrict score)
+{
+	if (score == NULL && firstholdshighest(deck))
+		return 0;
+	Seen seen = {
+		.size = 0,
+		.used = 0,
+		.len = deck[0].n + deck[1].n + 1
+	};
+	seen.tmp = aralloc(arena, seen.len * sizeof(uintmax_t));
+	if (seen.tmp == NULL)
+		return -1;
+	int win = -1;
+	while (deck[0].n > 0 && deck[1].n > 0) {
+		const int again = seenadd(arena, &seen, deck);
+		if (again < 0)
+			return -1;
+		if (again > 0) {
+			win = 0;
+			break;
+		}
+		const uintmax_t c[2] = { ringpop(&deck[0]), ringpop(&deck[1]) };
+		int taker = c[1] > c[0];
+		if (deck[0].n >= c[0] && deck[1].n >= c[1]) {
+			const ArenaMark mark = armark(arena);
+			const size_t cap = c[0] + c[1];
+			Ring sub[2];
+			taker = ringcopy(arena, &sub[0], &deck[0], c[0], cap)
+			        && ringcopy(arena, &sub[1], &deck[1], c[1], cap)
+			        ? fastgame(arena, sub, NULL) : -1;
+			arreset(arena, mark);
+			if (taker < 0)
+				return -1;
+		}
+		ringpush(&deck[taker], c[taker]);
+		ringpush(&deck[taker], c[!taker]);
+	}
+	if (win < 0)
+		win = deck[1].n > 0;
+	if (score != NULL) {
+		*score = 0;
+		for (size_t i = 0; i < deck[win].n; i++)
+			*score += ringat(&deck[win], i) * (deck[win].n - i);
+	}
+	return win;
+}
+
+static int
+fast(Input * const in, AdventResult * const out)
+{
+	Arena * const arena = scratch(out);
+	Card *card[2] = { NULL, NULL };
+	if (!parse(in, arena, card))
+		return EXIT_FAILURE;
+	parsed(out);
+	if (card[0] == NULL || card[1] == NULL) {
+		fputs("At least one deck is empty\n", stderr);
 		return EXIT_FAILURE;
 	}
+	uintmax_t score;
+	if (!regularcombat(arena, card, &score))
+		return EXIT_FAILURE;
+	answeruint(out, 0, "Regular", score);
+	size_t ncard = 0;
+	for (size_t p = 0; p < 2; p++) {
+		for (const Card *c = card[p]; c != NULL; c = c->next)
+			ncard++;
+	}
+	Ring deck[2];
+	for (size_t p = 0; p < 2; p++) {
+		Ring from = { .card = NULL, .head = 0, .n = 0, .mask = 0 };
+		if (!ringcopy(arena, &deck[p], &from, 0, ncard)) {
+			fputs("Could not allocate decks\n", stderr);
+			return EXIT_FAILURE;
+		}
+		for (const Card *c = card[p]; c != NULL; c = c->next)
+			ringpush(&deck[p], c->val);
+	}
+	if (fastgame(arena, deck, &score) < 0) {
+		fputs("Could not unroll recursive combat game\n", stderr);
+		return EXIT_FAILURE;
+	}
+	answeruint(out, 1, "Recurs", score);
+	return EXIT_SUCCESS;
+}
+
+int
+day22(Input * const in, AdventResult * const out)
+{
+	Arena * const arena = scratch(out);
+	Card *card[2] = { NULL, NULL };
+	if (!parse(in, arena, card))
+		return EXIT_FAILURE;
+	parsed(out);
 	if (card[0] == NULL || card[1] == NULL) {
 		fputs("At least one deck is empty\n", stderr);
 		return EXIT_FAILURE;
 	}
-	printf("Regular\t%ju\n", regularcombat());
-	uintmax_t score = 0;
-	if (recursivecombat(&score) < 0) {
+	uintmax_t score;
+	if (!regularcombat(arena, card, &score))
+		return EXIT_FAILURE;
+	answeruint(out, 0, "Regular", score);
+	score = 0;
+	if (recursivecombat(arena, card, &score) < 0) {
 		fputs("Could not unroll recursive combat game\n", stderr);
 		return EXIT_FAILURE;
 	}
-	printf("Recurs\t%ju\n", score);
+	answeruint(out, 1, "Recurs", score);
 	return EXIT_SUCCESS;
 }
+
+const Engine engines22[] = {
+	{ .name = "reference", .solve = day22 },
+	{ .name = "fast", .solve = fast },
+	{ .name = NULL }
+};
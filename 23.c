@@ -10,6 +10,12 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
 
 static bool
 pickedup(const uint_fast32_t dest, const uint_fast32_t pickup[const 3])
@@ -57,15 +63,19 @@ label(uint_fast8_t ncups,
 	out[ncups - 1] = 0;
 }
 
-static uint_fast64_t
+/* Cups are followed at random, so their array goes on huge pages */
+static bool
 stars(const uint_fast32_t ncups,
-      const uint_fast8_t icups[const ncups])
+      const uint_fast8_t icups[const restrict ncups],
+      uint_fast64_t * const restrict product,
+      AdventResult * const restrict out)
 {
 	/* Too big to fit properly on the stack -- detected by valgrind */
-	uint_fast32_t * const cups = malloc(1000000 * sizeof(uint_fast32_t));
+	uint_fast32_t * const cups = bigtable(out,
+	                                      1000000 * sizeof(uint_fast32_t));
 	if (cups == NULL) {
 		fputs("Could not allocate the cup array\n", stderr);
-		exit(EXIT_FAILURE);
+		return false;
 	}
 	for (uint_fast32_t i = 0; i < 999999; i++) {
 		const uint_fast32_t x = i < ncups? icups[i] - 1u : i;
@@ -74,23 +84,23 @@ stars(const uint_fast32_t ncups,
 	cups[999999] = icups[0] - 1;
 	play(1000000, cups, icups[0] - 1, UINT32_C(10000000));
 	uint_fast64_t a = cups[0] + 1, b = cups[cups[0]] + 1;
-	free(cups);
 	if (a >= UINT_FAST64_MAX / b) {
 		fprintf(stderr,
 		        "%" PRIuFAST64 " * %" PRIuFAST64 " wraps around\n",
 		        a,
 		        b);
-		exit(EXIT_FAILURE);
+		return false;
 	}
-	return a * b;
+	*product = a * b;
+	return true;
 }
 
 int
-day23(FILE * const in)
+day23(Input * const in, AdventResult * const out)
 {
 	uint_fast8_t cups[9], ncups = 0;
 	int c;
-	while ((c = fgetc(in)) != EOF && ncups <= 9) {
+	while (ncups < 9 && (c = inget(in)) != EOF) {
 		if (isspace(c))
 			continue;
 		if (!isdigit(c)) {
@@ -99,7 +109,8 @@ day23(FILE * const in)
 		}
 		cups[ncups++] = c - '0';
 	}
-	if (ferror(in) || !feof(in)) {
+	inspace(in);
+	if (!ineof(in)) {
 		fputs("Puzzle input parsing failed\n", stderr);
 		return EXIT_FAILURE;
 	}
@@ -107,6 +118,7 @@ day23(FILE * const in)
 		fprintf(stderr, "%" PRIuFAST8 " cups is not enough\n", ncups);
 		return EXIT_FAILURE;
 	}
+	parsed(out);
 	uint_fast16_t found = 0;
 	for (uint_fast8_t i = 0; i < ncups; i++)
 		found |= 1u << (cups[i] - 1);
@@ -116,9 +128,13 @@ day23(FILE * const in)
 		        ncups);
 		return EXIT_FAILURE;
 	}
-	char out[ncups];
-	label(ncups, cups, out);
-	printf("Labels\t%s\n", out);
-	printf("Stars\t%" PRIuFAST64 "\n", stars(ncups, cups));
+	char labels[ncups];
+	label(ncups, cups, labels);
+	if (!answerstr(out, 0, "Labels", labels))
+		return EXIT_FAILURE;
+	uint_fast64_t product;
+	if (!stars(ncups, cups, &product, out))
+		return EXIT_FAILURE;
+	answeruint(out, 1, "Stars", product);
 	return EXIT_SUCCESS;
 }
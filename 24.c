@@ -7,209 +7,208 @@
  */
 #include <limits.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+#include "grid.h"
+#include "life.h"
+
 /* Upper bound to how many digits a given type may hold */
 #define DIGITS(T) (CHAR_BIT * 10 * sizeof(T) / (9 * sizeof(char)))
 
-static bool *tile = NULL;
-static size_t width = 1, height = 1;
-static size_t refx = 0, refy = 0;
+typedef struct {
+	Grid tile;
+	size_t refx, refy;
+} Floor;
 
-static void
-panic(const char * const str)
+/* Moves the tiles `dx` and `dy` further into a floor of `width` by `height` */
+static bool
+regrow(Floor * const f,
+       const size_t width,
+       const size_t height,
+       const size_t dx,
+       const size_t dy)
 {
-	fprintf(stderr, "%s\n", str);
-	exit(EXIT_FAILURE);
+	const size_t words = gridwords(width, height);
+	uint64_t * const w = words > 0? malloc(words * sizeof(uint64_t))
+	                     : NULL;
+	if (w == NULL) {
+		fputs("Could not reallocate tiles\n", stderr);
+		return false;
+	}
+	Grid new;
+	gridinit(&new, w, width, height);
+	gridput(&new, &f->tile, dx, dy);
+	free(f->tile.w);
+	f->tile = new;
+	f->refx += dx;
+	f->refy += dy;
+	return true;
 }
 
-static size_t
-doublewidth(const size_t x)
+/* Grows the floor around its center and moves `x` along */
+static bool
+doublewidth(Floor * const restrict f, size_t * const restrict x)
 {
+	const size_t width = f->tile.width;
 	if (width >= (SIZE_MAX - 1) / 2) {
 		fprintf(stderr, "Error: 2 * %zu + 1 wraps around\n", width);
-		exit(EXIT_FAILURE);
+		return false;
 	}
-	const size_t newwidth = 2 * width + 1, quarter = width / 2;
-	bool * const new = malloc(newwidth * height * sizeof(bool));
-	if (new == NULL)
-		panic("Could not reallocate tiles");
-	for (size_t y = 0; y < height; y++) {
-		for (size_t x = 0; x < newwidth; x++)
-			new[y * newwidth + x] =
-				(quarter + 1 <= x && x < quarter + 1 + width)
-				&& tile[y * width + x - quarter - 1];
-	}
-	free(tile);
-	tile = new;
-	width = newwidth;
-	refx += quarter + 1;
-	return x + quarter + 1;
+	const size_t quarter = width / 2;
+	if (!regrow(f, 2 * width + 1, f->tile.height, quarter + 1, 0))
+		return false;
+	*x += quarter + 1;
+	return true;
 }
 
-static size_t
-doubleheight(const size_t y)
+static bool
+doubleheight(Floor * const restrict f, size_t * const restrict y)
 {
+	const size_t height = f->tile.height;
 	if (height >= (SIZE_MAX - 1) / 2) {
 		fprintf(stderr, "Error: 2 * %zu + 1 wraps around\n", height);
-		exit(EXIT_FAILURE);
-	}
-	const size_t newheight = 2 * height + 1, quarter = height / 2;
-	bool * const new = malloc(width * newheight * sizeof(bool));
-	if (new == NULL)
-		panic("Could not reallocate tiles");
-	for (size_t y = 0; y < newheight; y++) {
-		for (size_t x = 0; x < width; x++)
-			new[y * width + x] =
-				(quarter + 1 <= y && y < quarter + 1 + height)
-				&& tile[(y - quarter - 1) * width + x];
+		return false;
 	}
-	free(tile);
-	tile = new;
-	height = newheight;
-	refy += quarter + 1;
-	return y + quarter + 1;
+	const size_t quarter = height / 2;
+	if (!regrow(f, f->tile.width, 2 * height + 1, 0, quarter + 1))
+		return false;
+	*y += quarter + 1;
+	return true;
 }
 
-static void
+static bool
 unexpectedchar(const uintmax_t line, const int c)
 {
 	fprintf(stderr, "Unexpected character on line %ju: %c\n", line, c);
-	exit(EXIT_FAILURE);
+	return false;
+}
+
+static bool
+movewest(Floor * const restrict f, size_t * const restrict x)
+{
+	if (*x == 0 && !doublewidth(f, x))
+		return false;
+	(*x)--;
+	return true;
 }
 
-static void
-movevertically(FILE * const restrict in,
+static bool
+moveeast(Floor * const restrict f, size_t * const restrict x)
+{
+	if (*x == f->tile.width - 1 && !doublewidth(f, x))
+		return false;
+	(*x)++;
+	return true;
+}
+
+static bool
+movevertically(Input * const restrict in,
+               Floor * const restrict f,
                const uintmax_t line,
                size_t * const restrict x,
                size_t * const restrict y,
                const int_fast8_t dir)
 {
 	int c;
-	*y = ((*y == 0 || *y == height - 1)? doubleheight(*y) : *y) + dir;
-	if ((c = fgetc(in)) == EOF && feof(in)) {
+	if ((*y == 0 || *y == f->tile.height - 1) && !doubleheight(f, y))
+		return false;
+	*y += dir;
+	if ((c = inget(in)) == EOF) {
 		fprintf(stderr, "Input ends prematurely on line %ju\n", line);
-		exit(EXIT_FAILURE);
+		return false;
 	} else if (c == '\n') {
 		fprintf(stderr, "Line %ju ends prematurely\n", line);
-		exit(EXIT_FAILURE);
+		return false;
 	} else if (dir > 0 && c == 'w') {
-		*x = (*x == 0? doublewidth(*x) : *x) - 1;
+		return movewest(f, x);
 	} else if (dir < 0 && c == 'e') {
-		*x = (*x == width - 1? doublewidth(*x) : *x) + 1;
+		return moveeast(f, x);
 	} else if (!((dir < 0 && c == 'w') || (dir > 0 && c == 'e'))) {
-		unexpectedchar(line, c);
+		return unexpectedchar(line, c);
 	}
+	return true;
 }
 
-static void
-parse(FILE * const restrict in)
+static bool
+parse(Input * const restrict in, Floor * const restrict f)
 {
 	uintmax_t line = 1;
-	while (!feof(in) && !ferror(in)) {
-		size_t x = refx, y = refy;
-		bool nonempty = false;
+	while (!ineof(in)) {
+		size_t x = f->refx, y = f->refy;
+		bool nonempty = false, success = true;
 		int c;
-		while ((c = fgetc(in)) != EOF && c != '\n') {
+		while (success && (c = inget(in)) != EOF && c != '\n') {
 			nonempty = true;
 			if (c == 'w')
-				x = (x == 0? doublewidth(x) : x) - 1;
+				success = movewest(f, &x);
 			else if (c == 'e')
-				x = (x == width - 1? doublewidth(x) : x) + 1;
+				success = moveeast(f, &x);
 			else if (c == 'n')
-				movevertically(in, line, &x, &y, -1);
+				success = movevertically(in,
+				                         f,
+				                         line,
+				                         &x,
+				                         &y,
+				                         -1);
 			else if (c == 's')
-				movevertically(in, line, &x, &y, 1);
+				success = movevertically(in,
+				                         f,
+				                         line,
+				                         &x,
+				                         &y,
+				                         1);
 			else
-				unexpectedchar(line, c);
+				success = unexpectedchar(line, c);
 		}
+		if (!success)
+			return false;
 		if (nonempty)
-			tile[y * width + x] = !tile[y * width + x];
+			gridset(&f->tile, x, y, !gridget(&f->tile, x, y));
 		line++;
 	}
+	return true;
 }
 
-static uint_fast8_t
-numblackneighbors(const size_t x, const size_t y)
-{
-	uint_fast8_t count = 0;
-	if (y > 0) {
-		count += tile[(y - 1) * width + x];
-		if (x + 1 < width)
-			count += tile[(y - 1) * width + x + 1];
-	}
-	if (x > 0)
-		count += tile[y * width + x - 1];
-	if (x + 1 < width)
-		count += tile[y * width + x + 1];
-	if (y + 1 < height) {
-		count += tile[(y + 1) * width + x];
-		if (x > 0)
-			count += tile[(y + 1) * width + x - 1];
-	}
-	return count;
-}
-
-static void
-passday(void)
-{
-	for (size_t x = 0; x < width; x++) {
-		if (tile[x] || tile[(height - 1) * width + x]) {
-			doubleheight(0);
-			break;
-		}
-	}
-	for (size_t y = 0; y < height; y++) {
-		if (tile[y * width] || tile[y * width + width - 1]) {
-			doublewidth(0);
-			break;
-		}
-	}
-	bool * const new = malloc(width * height * sizeof(bool));
-	if (new == NULL)
-		panic("Could not reallocate tiles");
-	for (size_t y = 0; y < height; y++) {
-		for (size_t x = 0; x < width; x++) {
-			const uint_fast8_t neigh = numblackneighbors(x, y);
-			new[y * width + x] = neigh == 2 || (neigh == 1 && tile[y * width + x]);
-		}
-	}
-	free(tile);
-	tile = new;
-}
-
-static uintmax_t
-countblacktiles(void)
+static int
+solve(Input * const restrict in,
+      Floor * const restrict f,
+      AdventResult * const restrict out)
 {
-	uintmax_t count = 0;
-	for (size_t t = 0; t < width * height; t++)
-		count += tile[t];
-	return count;
-}
-
-static void
-freetiles(void)
-{
-	free(tile);
+	if (!parse(in, f))
+		return EXIT_FAILURE;
+	parsed(out);
+	answeruint(out, 0, "Day 0", gridpopcount(&f->tile));
+	Life l = {
+		.topology = LIFE_HEX,
+		.rule = { .bornlo = 2, .bornhi = 2, .staylo = 1, .stayhi = 2 },
+		.grow = true
+	};
+	const bool ok = lifeinit(&l, &f->tile) && liferun(&l, 100);
+	if (ok)
+		answeruint(out, 1, "Day 100", lifepopcount(&l));
+	lifefree(&l);
+	return ok? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 int
-day24(FILE * const in)
+day24(Input * const in, AdventResult * const out)
 {
-	if (atexit(freetiles) != 0)
-		fputs("Call to `atexit` failed; memory may leak\n", stderr);
-	if ((tile = malloc(sizeof(bool))) == NULL)
-		panic("Could not reallocate tiles");
-	tile[0] = false;
-	parse(in);
-	if (ferror(in))
-		panic("Puzzle input parsing failed");
-	printf("Day 0\t%ju\n", countblacktiles());
-	for (int day = 0; day < 100; day++)
-		passday();
-	printf("Day 100\t%ju\n", countblacktiles());
-	return EXIT_SUCCESS;
+	Floor f = { .refx = 0, .refy = 0 };
+	uint64_t * const w = malloc(gridwords(1, 1) * sizeof(uint64_t));
+	if (w == NULL) {
+		fputs("Could not reallocate tiles\n", stderr);
+		return EXIT_FAILURE;
+	}
+	gridinit(&f.tile, w, 1, 1);
+	const int result = solve(in, &f, out);
+	free(f.tile.w);
+	return result;
 }
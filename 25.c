@@ -6,24 +6,26 @@
  * http://www.wtfpl.net/ for more details.
  */
 #include <ctype.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-static void
-checkeof(FILE * const in)
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+
+static bool
+checkeof(Input * const in)
 {
-	int c;
-	while ((c = fgetc(in)) != EOF) {
-		if (!isspace(c)) {
-			fprintf(stderr, "Unexpected character: %c\n", c);
-			exit(EXIT_FAILURE);
-		}
-	}
-	if (!feof(in) || ferror(in)) {
-		fputs("Puzzle input parsing failed\n", stderr);
-		exit(EXIT_FAILURE);
+	inspace(in);
+	if (!ineof(in)) {
+		fprintf(stderr, "Unexpected character: %c\n", *in->p);
+		return false;
 	}
+	return true;
 }
 
 static uintmax_t
@@ -47,14 +49,21 @@ findloop(const uintmax_t key)
 }
 
 int
-day25(FILE * const in)
+day25(Input * const in, AdventResult * const out)
 {
 	uintmax_t doork, cardk;
-	if (fscanf(in, "%ju%*[ \n\t]%ju", &doork, &cardk) < 2) {
+	if (!inuint(in, &doork) || !isspace(inpeek(in))) {
 		fputs("Puzzle input parsing failed\n", stderr);
 		return EXIT_FAILURE;
 	}
-	checkeof(in);
-	printf("Key\t%ju\n", transform(cardk, findloop(doork)));
+	inspace(in);
+	if (!inuint(in, &cardk)) {
+		fputs("Puzzle input parsing failed\n", stderr);
+		return EXIT_FAILURE;
+	}
+	if (!checkeof(in))
+		return EXIT_FAILURE;
+	parsed(out);
+	answeruint(out, 0, "Key", transform(cardk, findloop(doork)));
 	return EXIT_SUCCESS;
 }
@@ -5,69 +5,234 @@
  * To Public License, Version 2, as published by Sam Hocevar. See
  * http://www.wtfpl.net/ for more details.
  */
+#define _XOPEN_SOURCE 700
+
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <time.h>
+#include <unistd.h>
+
+#include "advent.h"
+#include "cold.h"
+#include "counters.h"
+#include "profile.h"
+
+/* Rough cost of each day in milliseconds, used to schedule long days first */
+static const unsigned cost[] = {
+	4, 1, 1, 2, 2, 1, 8, 2, 2, 2, 110, 2, 2,
+	12, 1300, 5, 28, 2, 4, 350, 3, 45, 750, 6, 41
+};
+
+/*
+ * Calls to the allocator and bytes asked of it; `live` counts bytes not yet
+ * freed and `peak` the most there ever were
+ */
+typedef struct {
+	size_t mallocs, reallocs, frees;
+	uintmax_t bytes;
+	size_t live, peak;
+} MemStats;
+
+/*
+ * What a worker sends back. For the trace, `start` is when the day's input
+ * started loading, `load` and `solving` are the seconds after it at which
+ * loading ended and solving began, and `solve` is the time spent past parsing.
+ * Workers are forks, so the span names still point into the same strings.
+ */
+typedef struct {
+	int status;
+	double wall, cpu, parse;
+	size_t allocs, bytes;
+	AdventPages pages;
+	MemStats mem;
+	long maxrss, majflt;
+	CounterSample hw;
+	int hwerr;
+	struct timespec start;
+	double load, solving, solve;
+	AdventTrace trace;
+} Report;
+
+typedef struct {
+	pid_t pid;
+	int fd;
+	FILE *out, *err;
+	bool done;
+	Report rep;
+} Worker;
+
+/*
+ * Inputs read ahead by `all` in the order the days start, and when reading
+ * each began and ended, so as to tell how much of it the day did not wait for
+ */
+typedef struct {
+	const size_t *order;
+	size_t n;
+	struct timespec begin[ADVENT_DAYS], end[ADVENT_DAYS];
+	bool read[ADVENT_DAYS];
+	uintmax_t bytes;
+} Prefetch;
+
+typedef struct {
+	double min, median, p90, stddev;
+} Stats;
+
+typedef enum { WALL, CPU, PARSE, SOLVE, NMETRICS } Metric;
+
+static const char *const metricname[NMETRICS] = {
+	"wall", "cpu", "parse", "solve"
+};
 
-int day01(FILE *);
-int day02(FILE *);
-int day03(FILE *);
-int day04(FILE *);
-int day05(FILE *);
-int day06(FILE *);
-int day07(FILE *);
-int day08(FILE *);
-int day09(FILE *);
-int day10(FILE *);
-int day11(FILE *);
-int day12(FILE *);
-int day13(FILE *);
-int day14(FILE *);
-int day15(FILE *);
-int day16(FILE *);
-int day17(FILE *);
-int day18(FILE *);
-int day19(FILE *);
-int day20(FILE *);
-int day21(FILE *);
-int day22(FILE *);
-int day23(FILE *);
-int day24(FILE *);
-int day25(FILE *);
-
-static int (*days[])(FILE *) = {
-	day01,
-	day02,
-	day03,
-	day04,
-	day05,
-	day06,
-	day07,
-	day08,
-	day09,
-	day10,
-	day11,
-	day12,
-	day13,
-	day14,
-	day15,
-	day16,
-	day17,
-	day18,
-	day19,
-	day20,
-	day21,
-	day22,
-	day23,
-	day24,
-	day25
+/*
+ * Largest growth exponent of each day's time in its input bytes that `scale`
+ * accepts: linear with some noise, cubic for the day 1 triples, quadratic for
+ * the day 7 insertion sort, the day 8 reruns, the day 11 rounds and the day
+ * 20 backtracking
+ */
+static const double budget[] = {
+	3.25, 1.25, 1.25, 1.25, 1.25, 1.25, 2.25, 2.25, 1.25, 1.25, 2.25, 1.25,
+	1.25, 1.25, 1.25, 1.25, 1.25, 1.25, 1.25, 2.25, 1.25, 1.25, 1.25, 1.25,
+	1.25
 };
 
-static FILE *file = NULL;
+/* Longest line of the manifest or of a day's answers */
+#define MANIFEST_LINE 1024
+
+/* A day's line of the manifest; answers missing from the output are "-" */
+typedef struct {
+	bool known;
+	char *answer[2];
+	double median;
+} Expected;
+
+typedef struct {
+	uintmax_t scale, bytes;
+	char path[32];
+} Size;
+
+/* Set by -p; whoever runs a day then counts hardware events around it */
+static bool counting;
+
+/* Set by -t; whoever runs a day then records the phases it marks */
+static bool tracing;
+
+/* Samples per second set by -f; whoever runs a day then profiles it */
+static unsigned profiling;
+
+/* Set by --cold; whoever starts a day then evicts caches and its input first */
+static bool cold;
+
+/* Functions shown in a profile */
+#define PROFILE_TOP 20
+
+/* Keeps the alignment malloc guarantees after the size prefix */
+typedef union {
+	size_t size;
+	uintmax_t u;
+	long double d;
+	void *p;
+} Header;
+
+/*
+ * The binary is linked with --wrap for the allocator functions, so calls made
+ * by advent.o and libadvent.a land here; memory libc allocates for itself is
+ * not counted. Each worker solves a single day, so the counters of its process
+ * are those of the day.
+ */
+static MemStats mem;
+
+void *__real_malloc(size_t);
+void *__real_calloc(size_t, size_t);
+void *__real_realloc(void *, size_t);
+void __real_free(void *);
+
+/* Days may allocate from several threads at once */
+static pthread_mutex_t memlock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Counts a call, and `size` bytes taken in place of `freed` ones */
+static void
+track(size_t *const calls, const size_t freed, const size_t size)
+{
+	pthread_mutex_lock(&memlock);
+	(*calls)++;
+	mem.bytes += size;
+	mem.live = mem.live - freed + size;
+	if (mem.live > mem.peak)
+		mem.peak = mem.live;
+	pthread_mutex_unlock(&memlock);
+}
+
+void *
+__wrap_malloc(const size_t size)
+{
+	Header *const h = size <= SIZE_MAX - sizeof(Header)
+	                  ? __real_malloc(sizeof(Header) + size)
+	                  : NULL;
+	if (h == NULL) {
+		track(&mem.mallocs, 0, 0);
+		return NULL;
+	}
+	h->size = size;
+	track(&mem.mallocs, 0, size);
+	return h + 1;
+}
+
+void *
+__wrap_calloc(const size_t n, const size_t size)
+{
+	Header *const h = size == 0 || n <= (SIZE_MAX - sizeof(Header)) / size
+	                  ? __real_calloc(1, sizeof(Header) + n * size)
+	                  : NULL;
+	if (h == NULL) {
+		track(&mem.mallocs, 0, 0);
+		return NULL;
+	}
+	h->size = n * size;
+	track(&mem.mallocs, 0, n * size);
+	return h + 1;
+}
+
+void *
+__wrap_realloc(void *const p, const size_t size)
+{
+	Header *const old = p != NULL? (Header *) p - 1 : NULL;
+	const size_t oldsize = old != NULL? old->size : 0;
+	Header *const h = size <= SIZE_MAX - sizeof(Header)
+	                  ? __real_realloc(old, sizeof(Header) + size)
+	                  : NULL;
+	if (h == NULL) {
+		track(&mem.reallocs, 0, 0);
+		return NULL;
+	}
+	h->size = size;
+	track(&mem.reallocs, oldsize, size);
+	return h + 1;
+}
+
+void
+__wrap_free(void *const p)
+{
+	if (p == NULL) {
+		track(&mem.frees, 0, 0);
+		return;
+	}
+	Header *const h = (Header *) p - 1;
+	track(&mem.frees, h->size, 0);
+	__real_free(h);
+}
 
 static uint8_t
 parseday(const char *s)
@@ -83,93 +248,1562 @@ parseday(const char *s)
 	return acc;
 }
 
+static bool
+parsecount(const char *const s, size_t *const n)
+{
+	char *end;
+	errno = 0;
+	const unsigned long x = strtoul(s, &end, 10);
+	if (errno != 0 || !isdigit(*s) || *end != 0 || x > SIZE_MAX)
+		return false;
+	*n = x;
+	return true;
+}
+
+static bool
+parsereal(const char *const s, double *const x)
+{
+	char *end;
+	errno = 0;
+	*x = strtod(s, &end);
+	return errno == 0 && isdigit(*s) && *end == 0;
+}
+
+/* Limits large tables of days to the pages named `s` */
+static bool
+parsepages(const char *const s)
+{
+	AdventPages p = ADVENT_PAGES_HUGETLB;
+	for (; p <= ADVENT_PAGES_MALLOC; p++) {
+		if (strcmp(s, advent_pagesname(p)) == 0) {
+			advent_pages(p);
+			return true;
+		}
+	}
+	fprintf(stderr, "Unknown kind of pages: %s\n", s);
+	return false;
+}
+
+static double
+elapsed(const struct timespec *const restrict begin,
+        const struct timespec *const restrict end)
+{
+	return (double) (end->tv_sec - begin->tv_sec)
+	       + 1e-9 * (double) (end->tv_nsec - begin->tv_nsec);
+}
+
+static double
+cputime(void)
+{
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return (double) (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec)
+	       + 1e-6 * (double) (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
 static void
-closefile(void)
+printresult(const AdventResult *const res)
 {
-	if (file != NULL)
-		fclose(file);
+	for (unsigned p = 0; p < 2; p++) {
+		const AdventAnswer *const a = &res->part[p];
+		switch (a->type) {
+		case ADVENT_UINT:
+			printf("%s\t%ju\n", a->label, a->val.u);
+			break;
+		case ADVENT_INT:
+			printf("%s\t%jd\n", a->label, a->val.i);
+			break;
+		case ADVENT_STR:
+			printf("%s\t%s\n", a->label, a->val.s);
+			break;
+		case ADVENT_NONE:
+			break;
+		}
+	}
+}
+
+/*
+ * Solves and prints a day; the parse time in `rep` includes the time spent
+ * loading input. Input which is not a file is folded as it is read by the days
+ * which can, unless the day is traced.
+ */
+static int
+run(const size_t d, const int fd, Report *const rep)
+{
+	struct timespec begin, loaded, solving;
+	AdventInput in;
+	struct stat st;
+	const bool streamed = !tracing && fstat(fd, &st) == 0
+	                      && !S_ISREG(st.st_mode);
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	if (!streamed && advent_load(fd, &in) != EXIT_SUCCESS)
+		return EXIT_FAILURE;
+	clock_gettime(CLOCK_MONOTONIC, &loaded);
+	AdventResult res;
+	Counters c;
+	CounterSample hw = { .val = { 0 } };
+	const bool counted = counting && countopen(&c);
+	const int hwerr = counting && !counted? errno : 0;
+	if (counted)
+		countstart(&c);
+	const bool profiled = profiling > 0 && profstart(profiling);
+	const int proferr = profiling > 0 && !profiled? errno : 0;
+	clock_gettime(CLOCK_MONOTONIC, &solving);
+	const int status = streamed? advent_stream(d + 1, fd, &res)
+	                           : advent_trace(d + 1,
+	                                          in.buf,
+	                                          in.len,
+	                                          &res,
+	                                          tracing && rep != NULL
+	                                          ? &rep->trace : NULL);
+	if (profiled)
+		profstop();
+	if (counted) {
+		countstop(&c, &hw);
+		countclose(&c);
+	}
+	if (!streamed)
+		advent_unload(&in);
+	printresult(&res);
+	/* The profile's own allocations are not the day's */
+	const MemStats daymem = mem;
+	fflush(stdout);
+	if (profiled)
+		profprint(stderr, PROFILE_TOP);
+	else if (profiling > 0)
+		fprintf(stderr,
+		        "Profiler unavailable: %s\n",
+		        strerror(proferr));
+	mem = daymem;
+	/*
+	 * Mapped tables bypass the allocator; they are held until the day
+	 * returns, so they are counted as live at its peak
+	 */
+	mem.bytes += res.tables;
+	mem.peak += res.tables;
+	if (rep != NULL) {
+		rep->parse = res.parse > 0? elapsed(&begin, &loaded) + res.parse
+		                          : 0;
+		rep->allocs = res.allocs;
+		rep->bytes = res.bytes;
+		rep->pages = res.pages;
+		rep->hw = hw;
+		rep->hwerr = hwerr;
+		rep->start = begin;
+		rep->load = elapsed(&begin, &loaded);
+		rep->solving = elapsed(&begin, &solving);
+		rep->solve = res.solve;
+	}
+	advent_free(&res);
+	return status;
 }
 
 static void
-runall(void)
+printcounterhead(void)
 {
-	const size_t ndays = sizeof(days) / sizeof(int (*)(FILE *));
-	clock_t total = 0, chrono[ndays];
-	if (atexit(closefile) != 0)
-		fputs("Call to `atexit` failed;"
-		      "last file may not be closed properly\n",
-		      stderr);
+	fputs("Day", stderr);
+	for (Counter i = 0; i < NCOUNTERS; i++) {
+		fprintf(stderr, "\t%s", countername[i]);
+		if (i == INSTRUCTIONS)
+			fputs("\tIPC", stderr);
+	}
+	fputc('\n', stderr);
+}
+
+/* Events which could not be counted show as - */
+static void
+printcounters(const size_t d, const CounterSample *const hw)
+{
+	fprintf(stderr, "%zu", d + 1);
+	for (Counter i = 0; i < NCOUNTERS; i++) {
+		if (hw->ok[i])
+			fprintf(stderr, "\t%ju", (uintmax_t) hw->val[i]);
+		else
+			fputs("\t-", stderr);
+		if (i != INSTRUCTIONS)
+			continue;
+		if (hw->ok[CYCLES] && hw->ok[INSTRUCTIONS]
+		    && hw->val[CYCLES] > 0)
+			fprintf(stderr,
+			        "\t%.2lf",
+			        (double) hw->val[INSTRUCTIONS]
+			        / (double) hw->val[CYCLES]);
+		else
+			fputs("\t-", stderr);
+	}
+	fputc('\n', stderr);
+}
+
+/* A complete event of the trace, from seconds after the run began */
+static void
+traceevent(FILE *const restrict f,
+           const size_t d,
+           const char *const restrict name,
+           const double begin,
+           const double end)
+{
+	fprintf(f,
+	        ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,"
+	        "\"ts\":%.3lf,\"dur\":%.3lf}",
+	        name,
+	        d + 1,
+	        1e6 * begin,
+	        1e6 * (end - begin));
+}
+
+/*
+ * Each day gets a thread of its own in the trace, holding the whole day, its
+ * loading, parsing and solving and the phases it marked. Phases left open by
+ * a failure end with the day.
+ */
+static void
+traceday(FILE *const f,
+         const size_t d,
+         const Report *const rep,
+         const struct timespec *const origin)
+{
+	const double start = elapsed(origin, &rep->start);
+	const double solving = start + rep->solving;
+	const double parse = rep->parse > 0? rep->parse - rep->load : 0;
+	const double end = solving + parse + rep->solve;
+	char name[16];
+	sprintf(name, "Day %zu", d + 1);
+	fprintf(f,
+	        ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+	        "\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+	        d + 1,
+	        name);
+	traceevent(f, d, name, start, end);
+	traceevent(f, d, "Load", start, start + rep->load);
+	if (parse > 0)
+		traceevent(f, d, "Parse", solving, solving + parse);
+	traceevent(f, d, "Solve", solving + parse, end);
+	for (size_t i = 0; i < rep->trace.n; i++) {
+		const AdventSpan *const sp = &rep->trace.span[i];
+		traceevent(f,
+		           d,
+		           sp->name,
+		           solving + sp->begin,
+		           sp->end > 0? solving + sp->end : end);
+	}
+}
+
+/* Writes Chrome trace events for the days whose report is given */
+static bool
+writetrace(const char *const path,
+           const Report *const rep[const],
+           const struct timespec *const origin)
+{
+	const size_t ndays = ADVENT_DAYS;
+	FILE *const f = fopen(path, "w");
+	if (f == NULL) {
+		perror(path);
+		return false;
+	}
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+	      "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+	      "\"args\":{\"name\":\"advent\"}}",
+	      f);
 	for (size_t d = 0; d < ndays; d++) {
-		fprintf(stderr, "\tDay %zu\n", d + 1);
-		char fname[16];
-		sprintf(fname, "input-%zu", d + 1);
-		errno = 0;
-		if ((file = fopen(fname, "r")) == NULL) {
-			if (errno != 0)
-				perror(fname);
-			else
-				fprintf(stderr, "Could not open %s\n", fname);
-			chrono[d] = 0;
+		if (rep[d] != NULL)
+			traceday(f, d, rep[d], origin);
+	}
+	fputs("\n]}\n", f);
+	if (fclose(f) != 0) {
+		perror(path);
+		return false;
+	}
+	return true;
+}
+
+static void
+redirect(FILE *const restrict f, const int fd)
+{
+	const int new = f != NULL? fileno(f) : open("/dev/null", O_WRONLY);
+	if (new < 0 || dup2(new, fd) < 0) {
+		perror("Could not redirect worker output");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Runs in the child: day output goes to the worker's temporary files, or is
+ * discarded if there are none
+ */
+static void
+runworker(const size_t d, const int in, const Worker *const w)
+{
+	redirect(w->out, STDOUT_FILENO);
+	if (w->err != NULL)
+		redirect(w->err, STDERR_FILENO);
+	Report rep;
+	struct timespec begin, end;
+	const double cpu = cputime();
+	mem = (MemStats) { .live = 0 };
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	rep.status = run(d, in, &rep);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	rep.cpu = cputime() - cpu;
+	rep.wall = elapsed(&begin, &end);
+	rep.mem = mem;
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	rep.maxrss = ru.ru_maxrss;
+	rep.majflt = ru.ru_majflt;
+	fflush(stdout);
+	if (write(w->fd, &rep, sizeof(Report)) != sizeof(Report))
+		perror("Could not report to the runner");
+	exit(rep.status);
+}
+
+/* Reading buffer of the prefetch thread */
+#define PREFETCH_BUFFER 65536
+
+/*
+ * Reads the inputs through to the page cache, where the workers map them
+ * from. Workers are forked meanwhile, so this must not allocate, lest a fork
+ * copy the allocator's lock while this thread holds it.
+ */
+static void *
+prefetch(void *const arg)
+{
+	Prefetch *const pf = arg;
+	static char buf[PREFETCH_BUFFER];
+	for (size_t i = 0; i < pf->n; i++) {
+		const size_t d = pf->order[i];
+		char path[16];
+		sprintf(path, "input-%zu", d + 1);
+		clock_gettime(CLOCK_MONOTONIC, &pf->begin[d]);
+		const int fd = open(path, O_RDONLY);
+		if (fd < 0)
+			continue;
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		ssize_t n;
+		while ((n = read(fd, buf, sizeof(buf))) > 0
+		       || (n < 0 && errno == EINTR))
+			pf->bytes += n > 0? n : 0;
+		close(fd);
+		clock_gettime(CLOCK_MONOTONIC, &pf->end[d]);
+		pf->read[d] = true;
+	}
+	return NULL;
+}
+
+/*
+ * Prints how much reading was over before the days it was for started, which
+ * is I/O they would otherwise have waited for
+ */
+static void
+printprefetch(const Prefetch *const pf, const Worker w[const])
+{
+	double saved = 0;
+	size_t ready = 0, read = 0;
+	for (size_t d = 0; d < ADVENT_DAYS; d++) {
+		if (!pf->read[d] || w[d].pid == 0 || w[d].rep.start.tv_sec == 0)
+			continue;
+		const double took = elapsed(&pf->begin[d], &pf->end[d]);
+		const double ahead = elapsed(&pf->begin[d], &w[d].rep.start);
+		saved += ahead < 0? 0 : ahead < took? ahead : took;
+		ready += ahead >= took;
+		read++;
+	}
+	fprintf(stderr,
+	        "Prefetch\t%7.2lf\t\t%zu of %zu inputs read ahead, %ju KiB\n\n",
+	        1000. * saved,
+	        ready,
+	        read,
+	        pf->bytes / 1024);
+}
+
+static bool
+spawn(const size_t d,
+      const char *const path,
+      Worker *const w,
+      const bool quiet)
+{
+	const int in = open(path, O_RDONLY);
+	if (in < 0) {
+		perror(path);
+		return false;
+	}
+	if (cold && !evictcaches(in))
+		perror("Could not evict caches");
+	int fd[2];
+	w->out = w->err = NULL;
+	if ((!quiet && ((w->out = tmpfile()) == NULL
+	                || (w->err = tmpfile()) == NULL))
+	    || pipe(fd) < 0) {
+		perror("Could not set up worker");
+		exit(EXIT_FAILURE);
+	}
+	fflush(NULL);
+	if ((w->pid = fork()) < 0) {
+		perror("Could not fork worker");
+		exit(EXIT_FAILURE);
+	} else if (w->pid == 0) {
+		close(fd[0]);
+		w->fd = fd[1];
+		runworker(d, in, w);
+	}
+	close(fd[1]);
+	close(in);
+	w->fd = fd[0];
+	return true;
+}
+
+static void
+reap(Worker *const w, const size_t n)
+{
+	int status;
+	pid_t pid;
+	while ((pid = wait(&status)) < 0 && errno == EINTR);
+	if (pid < 0) {
+		perror("Could not wait for worker");
+		exit(EXIT_FAILURE);
+	}
+	for (size_t d = 0; d < n; d++) {
+		if (w[d].pid != pid)
 			continue;
+		w[d].done = true;
+		if (read(w[d].fd, &w[d].rep, sizeof(Report)) != sizeof(Report))
+			w[d].rep = (Report) { .status = EXIT_FAILURE };
+		close(w[d].fd);
+		return;
+	}
+}
+
+static void
+replay(FILE *const restrict from, FILE *const restrict to)
+{
+	char buf[BUFSIZ];
+	size_t n;
+	rewind(from);
+	while ((n = fread(buf, 1, sizeof(buf), from)) > 0)
+		fwrite(buf, 1, n, to);
+	fclose(from);
+}
+
+static bool
+runall(const size_t jobs, const char *const trace)
+{
+	const size_t ndays = ADVENT_DAYS;
+	size_t order[ndays], running = 0;
+	Worker w[ndays];
+	for (size_t d = 0; d < ndays; d++) {
+		order[d] = d;
+		w[d].pid = 0;
+		w[d].done = false;
+		w[d].out = w[d].err = NULL;
+		w[d].rep = (Report) { .status = EXIT_FAILURE };
+	}
+	/* Longest expected job first */
+	for (size_t i = 1; i < ndays; i++) {
+		for (size_t j = i; j > 0 && cost[order[j]] > cost[order[j - 1]]; j--) {
+			const size_t temp = order[j];
+			order[j] = order[j - 1];
+			order[j - 1] = temp;
 		}
-		const clock_t begin = clock();
-		days[d](file);
-		chrono[d] = clock() - begin;
-		fclose(file);
-		total += chrono[d];
+	}
+	struct timespec begin, end;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	Prefetch pf = { .order = order, .n = ndays, .read = { false } };
+	pthread_t reader;
+	const bool prefetching = !cold && pthread_create(&reader,
+	                                                 NULL,
+	                                                 prefetch,
+	                                                 &pf) == 0;
+	for (size_t i = 0; i < ndays; i++) {
+		if (running == jobs) {
+			reap(w, ndays);
+			running--;
+		}
+		char path[16];
+		sprintf(path, "input-%zu", order[i] + 1);
+		if (spawn(order[i], path, &w[order[i]], false))
+			running++;
+	}
+	while (running-- > 0)
+		reap(w, ndays);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if (prefetching)
+		pthread_join(reader, NULL);
+	double wall = 0, cpu = 0;
+	for (size_t d = 0; d < ndays; d++) {
+		if (w[d].pid == 0)
+			continue;
+		fflush(stdout);
+		fprintf(stderr, "\tDay %zu\n", d + 1);
+		replay(w[d].out, stdout);
+		fflush(stdout);
+		replay(w[d].err, stderr);
+		if (w[d].rep.status != EXIT_SUCCESS)
+			fprintf(stderr, "Day %zu failed\n", d + 1);
 		fputc('\n', stderr);
+		wall += w[d].rep.wall;
+		cpu += w[d].rep.cpu;
 	}
-	file = NULL;
-	fputs("Summary\nDay\tTicks\tms\t%\n", stderr);
+	fprintf(stderr, "Summary (%zu job%s)\n", jobs, jobs > 1? "s" : "");
+	fputs("Day\tWall ms\tCPU ms\t%\tMalloc\tRealloc\tFree\t"
+	      "Req KiB\tPeak KiB\tRSS KiB\tFaults\n",
+	      stderr);
+	MemStats total = { .peak = 0 };
+	long maxrss = 0, majflt = 0;
+	for (size_t d = 0; d < ndays; d++) {
+		const MemStats *const m = &w[d].rep.mem;
+		fprintf(stderr,
+		        "%zu\t%7.2lf\t%7.2lf\t%2.3lf\t"
+		        "%zu\t%zu\t%zu\t%ju\t%zu\t%ld\t%ld\n",
+		        d + 1,
+		        1000. * w[d].rep.wall,
+		        1000. * w[d].rep.cpu,
+		        cpu > 0? 100. * w[d].rep.cpu / cpu : 0.,
+		        m->mallocs,
+		        m->reallocs,
+		        m->frees,
+		        m->bytes / 1024,
+		        m->peak / 1024,
+		        w[d].rep.maxrss,
+		        w[d].rep.majflt);
+		total.mallocs += m->mallocs;
+		total.reallocs += m->reallocs;
+		total.frees += m->frees;
+		total.bytes += m->bytes;
+		if (m->peak > total.peak)
+			total.peak = m->peak;
+		if (w[d].rep.maxrss > maxrss)
+			maxrss = w[d].rep.maxrss;
+		majflt += w[d].rep.majflt;
+	}
+	/* Days run apart, so the total peaks are those of the worst day */
+	fprintf(stderr,
+	        "Total\t%7.2lf\t%7.2lf\t100\t"
+	        "%zu\t%zu\t%zu\t%ju\t%zu\t%ld\t%ld\n",
+	        1000. * wall,
+	        1000. * cpu,
+	        total.mallocs,
+	        total.reallocs,
+	        total.frees,
+	        total.bytes / 1024,
+	        total.peak / 1024,
+	        maxrss,
+	        majflt);
+	/* Serial run time is about the sum of CPU times */
+	fprintf(stderr,
+	        "Elapsed\t%7.2lf\t\t%.2lfx\n",
+	        1000. * elapsed(&begin, &end),
+	        cpu / elapsed(&begin, &end));
+	if (prefetching)
+		printprefetch(&pf, w);
+	else
+		fputc('\n', stderr);
+	/* Workers which died without reporting are left out */
+	const Report *rep[ndays];
+	for (size_t d = 0; d < ndays; d++) {
+		rep[d] = w[d].pid != 0 && w[d].rep.start.tv_sec != 0? &w[d].rep
+		                                                     : NULL;
+	}
+	if (trace != NULL && !writetrace(trace, rep, &begin))
+		return false;
+	if (!counting)
+		return true;
+	int hwerr = 0;
+	bool any = false;
+	for (size_t d = 0; d < ndays; d++) {
+		for (Counter i = 0; i < NCOUNTERS; i++)
+			any |= w[d].rep.hw.ok[i];
+		if (hwerr == 0)
+			hwerr = w[d].rep.hwerr;
+	}
+	if (!any) {
+		fprintf(stderr,
+		        "Hardware counters unavailable: %s\n\n",
+		        counterror(hwerr != 0? hwerr : ENOENT));
+		return true;
+	}
+	fputs("Hardware counters\n", stderr);
+	printcounterhead();
 	for (size_t d = 0; d < ndays; d++)
+		printcounters(d, &w[d].rep.hw);
+	fputc('\n', stderr);
+	return true;
+}
+
+static int
+cmpdouble(const void *x, const void *y)
+{
+	const double xx = *(const double *) x;
+	const double yy = *(const double *) y;
+	if (xx < yy)
+		return -1;
+	else if (xx > yy)
+		return 1;
+	return 0;
+}
+
+/* Sorts the samples; quantiles use the nearest rank */
+static Stats
+summarize(double *const x, const size_t n)
+{
+	Stats s;
+	double mean = 0, var = 0;
+	qsort(x, n, sizeof(double), cmpdouble);
+	for (size_t i = 0; i < n; i++)
+		mean += x[i] / (double) n;
+	for (size_t i = 0; i < n; i++)
+		var += (x[i] - mean) * (x[i] - mean);
+	s.min = x[0];
+	s.median = n % 2 == 1? x[n / 2] : (x[n / 2 - 1] + x[n / 2]) / 2;
+	s.p90 = x[(9 * n + 9) / 10 - 1];
+	s.stddev = n > 1? sqrt(var / (double) (n - 1)) : 0;
+	return s;
+}
+
+static double
+sample(const Report *const rep, const Metric m)
+{
+	switch (m) {
+	case WALL:
+		return rep->wall;
+	case CPU:
+		return rep->cpu;
+	case PARSE:
+		return rep->parse;
+	default:
+		return rep->wall - rep->parse;
+	}
+}
+
+/* Allocations do not vary between runs, so `last` keeps those of the last */
+static bool
+benchday(const size_t d,
+         const char *const path,
+         const size_t runs,
+         const size_t warmup,
+         Stats stats[const NMETRICS],
+         Report *const last)
+{
+	Report rep[runs];
+	for (size_t r = 0; r < warmup + runs; r++) {
+		Worker w;
+		if (!spawn(d, path, &w, true))
+			return false;
+		reap(&w, 1);
+		if (w.rep.status != EXIT_SUCCESS) {
+			fprintf(stderr, "Day %zu failed\n", d + 1);
+			return false;
+		}
+		if (r >= warmup)
+			rep[r - warmup] = w.rep;
+	}
+	for (Metric m = 0; m < NMETRICS; m++) {
+		double x[runs];
+		for (size_t r = 0; r < runs; r++)
+			x[r] = sample(rep + r, m);
+		stats[m] = summarize(x, runs);
+	}
+	*last = rep[runs - 1];
+	return true;
+}
+
+static void
+writejson(FILE *const f,
+          const size_t runs,
+          const size_t warmup,
+          const bool done[const],
+          const Stats stats[const][NMETRICS],
+          const Report last[const])
+{
+	const size_t ndays = ADVENT_DAYS;
+	bool first = true;
+	fprintf(f,
+	        "{\"runs\":%zu,\"warmup\":%zu,\"isa\":\"%s\","
+	        "\"caches\":\"%s\",\"days\":[",
+	        runs,
+	        warmup,
+	        advent_isaname(),
+	        cold? "cold" : "warm");
+	for (size_t d = 0; d < ndays; d++) {
+		if (!done[d])
+			continue;
+		fprintf(f,
+		        "%s\n{\"day\":%zu,\"allocs\":%zu,\"bytes\":%zu,"
+		        "\"pages\":\"%s\"",
+		        first? "" : ",",
+		        d + 1,
+		        last[d].allocs,
+		        last[d].bytes,
+		        advent_pagesname(last[d].pages));
+		for (Metric m = 0; m < NMETRICS; m++) {
+			const Stats *const s = &stats[d][m];
+			fprintf(f,
+			        ",\"%s\":{\"min\":%.6lf,\"median\":%.6lf,"
+			        "\"p90\":%.6lf,\"stddev\":%.6lf}",
+			        metricname[m],
+			        1000. * s->min,
+			        1000. * s->median,
+			        1000. * s->p90,
+			        1000. * s->stddev);
+		}
+		fputc('}', f);
+		first = false;
+	}
+	fputs("\n]}\n", f);
+}
+
+static void
+writecsv(FILE *const f,
+         const size_t runs,
+         const bool done[const],
+         const Stats stats[const][NMETRICS],
+         const Report last[const])
+{
+	const size_t ndays = ADVENT_DAYS;
+	fputs("day,metric,runs,min_ms,median_ms,p90_ms,stddev_ms,"
+	      "allocs,bytes,isa,pages,caches\n",
+	      f);
+	for (size_t d = 0; d < ndays; d++) {
+		if (!done[d])
+			continue;
+		for (Metric m = 0; m < NMETRICS; m++) {
+			const Stats *const s = &stats[d][m];
+			fprintf(f,
+			        "%zu,%s,%zu,%.6lf,%.6lf,%.6lf,%.6lf,"
+			        "%zu,%zu,%s,%s,%s\n",
+			        d + 1,
+			        metricname[m],
+			        runs,
+			        1000. * s->min,
+			        1000. * s->median,
+			        1000. * s->p90,
+			        1000. * s->stddev,
+			        last[d].allocs,
+			        last[d].bytes,
+			        advent_isaname(),
+			        advent_pagesname(last[d].pages),
+			        cold? "cold" : "warm");
+		}
+	}
+}
+
+static bool
+writebench(const char *const path,
+           const size_t runs,
+           const size_t warmup,
+           const bool done[const],
+           const Stats stats[const][NMETRICS],
+           const Report last[const])
+{
+	const char *const ext = strrchr(path, '.');
+	const bool json = ext != NULL && strcmp(ext, ".json") == 0;
+	if (!json && (ext == NULL || strcmp(ext, ".csv") != 0)) {
+		fprintf(stderr, "%s: output must end in .json or .csv\n", path);
+		return false;
+	}
+	FILE *const f = fopen(path, "w");
+	if (f == NULL) {
+		perror(path);
+		return false;
+	}
+	if (json)
+		writejson(f, runs, warmup, done, stats, last);
+	else
+		writecsv(f, runs, done, stats, last);
+	if (fclose(f) != 0) {
+		perror(path);
+		return false;
+	}
+	return true;
+}
+
+/* Benchmarks one day, or all of them if `day` is 0 */
+static bool
+runbench(const uint8_t day,
+         const size_t runs,
+         const size_t warmup,
+         const char *const path)
+{
+	const size_t ndays = ADVENT_DAYS;
+	bool done[ndays];
+	Stats stats[ndays][NMETRICS];
+	Report last[ndays];
+	fprintf(stderr,
+	        "Kernels: %s, %s caches\n",
+	        advent_isaname(),
+	        cold? "cold" : "warm");
+	fprintf(stderr, "Day\tMetric\tMin ms\tMedian\tP90\tStddev\n");
+	for (size_t d = 0; d < ndays; d++) {
+		char path[16];
+		sprintf(path, "input-%zu", d + 1);
+		done[d] = (day == 0 || d + 1 == day)
+		          && benchday(d,
+		                      path,
+		                      runs,
+		                      warmup,
+		                      stats[d],
+		                      last + d);
+		for (Metric m = 0; done[d] && m < NMETRICS; m++)
+			fprintf(stderr,
+			        "%zu\t%s\t%7.3lf\t%7.3lf\t%7.3lf\t%7.3lf\n",
+			        d + 1,
+			        metricname[m],
+			        1000. * stats[d][m].min,
+			        1000. * stats[d][m].median,
+			        1000. * stats[d][m].p90,
+			        1000. * stats[d][m].stddev);
+		if (done[d])
+			fprintf(stderr,
+			        "%zu\tarena\t%zu allocations, %zu bytes\n",
+			        d + 1,
+			        last[d].allocs,
+			        last[d].bytes);
+		if (done[d] && last[d].pages != ADVENT_PAGES_NONE)
+			fprintf(stderr,
+			        "%zu\tpages\t%s\n",
+			        d + 1,
+			        advent_pagesname(last[d].pages));
+	}
+	if (path != NULL
+	    && !writebench(path, runs, warmup, done, stats, last))
+		return false;
+	return day == 0 || done[day - 1];
+}
+
+/* Slope of the least squares line through (log x, log y) */
+static bool
+fitexponent(const double *const x,
+            const double *const y,
+            const size_t n,
+            double *const k)
+{
+	double mx = 0, my = 0, sxx = 0, sxy = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (x[i] <= 0 || y[i] <= 0)
+			return false;
+		mx += log(x[i]) / (double) n;
+		my += log(y[i]) / (double) n;
+	}
+	for (size_t i = 0; i < n; i++) {
+		sxx += (log(x[i]) - mx) * (log(x[i]) - mx);
+		sxy += (log(x[i]) - mx) * (log(y[i]) - my);
+	}
+	if (sxx <= 0)
+		return false;
+	*k = sxy / sxx;
+	return true;
+}
+
+/* Finds the input-N-S files of a day, sorted by scale S */
+static size_t
+findsizes(const size_t d, Size **const sizes)
+{
+	char pattern[32];
+	glob_t g;
+	sprintf(pattern, "input-%zu-*", d + 1);
+	*sizes = NULL;
+	if (glob(pattern, 0, NULL, &g) != 0)
+		return 0;
+	size_t n = 0;
+	if ((*sizes = malloc(g.gl_pathc * sizeof(Size))) == NULL) {
+		perror("Could not list input sizes");
+		globfree(&g);
+		return 0;
+	}
+	for (size_t i = 0; i < g.gl_pathc; i++) {
+		const char *const path = g.gl_pathv[i];
+		Size *const it = *sizes + n;
+		size_t scale;
+		struct stat st;
+		if (strlen(path) >= sizeof(it->path)
+		    || !parsecount(path + strlen(pattern) - 1, &scale)
+		    || stat(path, &st) != 0)
+			continue;
+		it->scale = scale;
+		it->bytes = st.st_size;
+		strcpy(it->path, path);
+		n++;
+	}
+	globfree(&g);
+	Size *const s = *sizes;
+	for (size_t i = 1; i < n; i++) {
+		for (size_t j = i; j > 0 && s[j].scale < s[j - 1].scale; j--) {
+			const Size temp = s[j];
+			s[j] = s[j - 1];
+			s[j - 1] = temp;
+		}
+	}
+	return n;
+}
+
+/*
+ * Times a day on each of its sizes and fits how its median time and peak
+ * heap grow with the input bytes; `over` is set past the day's budget
+ */
+static bool
+scaleday(const size_t d,
+         const size_t runs,
+         const size_t warmup,
+         const double limit,
+         bool *const over)
+{
+	Size *sizes;
+	const size_t n = findsizes(d, &sizes);
+	if (n < 2) {
+		free(sizes);
+		return false;
+	}
+	double bytes[n], wall[n], peak[n];
+	for (size_t i = 0; i < n; i++) {
+		Stats stats[NMETRICS];
+		Report last;
+		if (!benchday(d, sizes[i].path, runs, warmup, stats, &last)) {
+			free(sizes);
+			return false;
+		}
+		bytes[i] = (double) sizes[i].bytes;
+		wall[i] = stats[WALL].median;
+		peak[i] = (double) last.mem.peak;
 		fprintf(stderr,
-		        "%zu\t%7.0lf\t%4.2lf\t%2.3lf\n",
+		        "%zu\t%ju\t%ju\t%7.3lf\t%zu\t%ld\n",
 		        d + 1,
-		        (double) chrono[d],
-		        1000. * (double) chrono[d] / (double) CLOCKS_PER_SEC,
-		        100. * (double) chrono[d] / (double) total);
+		        sizes[i].scale,
+		        sizes[i].bytes / 1024,
+		        1000. * wall[i],
+		        last.mem.peak / 1024,
+		        last.maxrss);
+	}
+	free(sizes);
+	double k, m;
+	if (!fitexponent(bytes, wall, n, &k)) {
+		fprintf(stderr, "%zu\tfit\tneeds inputs of different sizes\n",
+		        d + 1);
+		return false;
+	}
+	*over = k > limit;
+	fprintf(stderr, "%zu\tfit\tO(n^%.2lf) time", d + 1, k);
+	if (fitexponent(bytes, peak, n, &m))
+		fprintf(stderr, ", O(n^%.2lf) heap", m);
 	fprintf(stderr,
-	        "Total\t%7.0lf\t%4.2lf\t100\n\n",
-	        (double) total,
-	        1000. * (double) total / (double) CLOCKS_PER_SEC);
+	        ", budget O(n^%.2lf)%s\n",
+	        limit,
+	        *over? ", over budget" : "");
+	return true;
+}
+
+/*
+ * Fits one day, or all days with at least two sizes if `day` is 0; fails if
+ * a day is over budget. A negative `limit` keeps each day's own budget.
+ */
+static bool
+runscale(const uint8_t day,
+         const size_t runs,
+         const size_t warmup,
+         const double limit)
+{
+	const size_t ndays = ADVENT_DAYS;
+	bool ok = true, any = false;
+	fputs("Day\tScale\tKiB\tMedian ms\tPeak KiB\tRSS KiB\n", stderr);
+	for (size_t d = 0; d < ndays; d++) {
+		bool over = false;
+		if (day != 0 && d + 1 != day)
+			continue;
+		if (!scaleday(d, runs, warmup, limit < 0? budget[d] : limit,
+		              &over))
+			continue;
+		any = true;
+		ok &= !over;
+	}
+	if (!any)
+		fputs("No day was fitted; each needs input-N-S files of at "
+		      "least two sizes\n",
+		      stderr);
+	return any && ok;
+}
+
+static void
+freeexpected(Expected *const e, const size_t n)
+{
+	for (size_t d = 0; d < n; d++) {
+		free(e[d].answer[0]);
+		free(e[d].answer[1]);
+		e[d] = (Expected) { .known = false };
+	}
+}
+
+/*
+ * strdup and getline allocate inside libc, past the wrapped malloc, so the
+ * manifest code copies strings itself and reads lines into a fixed buffer
+ */
+static char *
+copystr(const char *const str)
+{
+	const size_t len = strlen(str) + 1;
+	char *const new = malloc(len);
+	return new != NULL? memcpy(new, str, len) : NULL;
+}
+
+/* Splits `line` at tabs in place; returns how many fields there were */
+static size_t
+splittabs(char *line, char *field[const], const size_t max)
+{
+	size_t n = 0;
+	line[strcspn(line, "\n")] = 0;
+	while (n < max) {
+		field[n++] = line;
+		if ((line = strchr(line, '\t')) == NULL)
+			break;
+		*line++ = 0;
+	}
+	return n;
+}
+
+/*
+ * Reads the manifest: one day per line with its number, part 1 and part 2
+ * answers and baseline median in milliseconds, separated by tabs. Lines
+ * starting with # are comments.
+ */
+static bool
+loadmanifest(const char *const path, Expected e[const])
+{
+	FILE *const f = fopen(path, "r");
+	if (f == NULL) {
+		perror(path);
+		return false;
+	}
+	char line[MANIFEST_LINE];
+	uintmax_t n = 0;
+	bool ok = true;
+	while (ok && fgets(line, sizeof(line), f) != NULL) {
+		char *field[5];
+		uint8_t d;
+		double ms;
+		n++;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		ok = strchr(line, '\n') != NULL
+		     && splittabs(line, field, 5) == 4
+		     && (d = parseday(field[0])) > 0
+		     && parsereal(field[3], &ms) && !e[d - 1].known;
+		if (!ok) {
+			fprintf(stderr, "%s:%ju: Malformed line\n", path, n);
+			break;
+		}
+		e[d - 1].answer[0] = copystr(field[1]);
+		e[d - 1].answer[1] = copystr(field[2]);
+		e[d - 1].median = ms / 1000.;
+		e[d - 1].known = e[d - 1].answer[0] != NULL
+		                 && e[d - 1].answer[1] != NULL;
+		if (!e[d - 1].known) {
+			perror("Could not load the manifest");
+			ok = false;
+		}
+	}
+	fclose(f);
+	if (!ok)
+		freeexpected(e, ADVENT_DAYS);
+	return ok;
+}
+
+static bool
+writemanifest(const char *const path, const Expected e[const])
+{
+	FILE *const f = fopen(path, "w");
+	if (f == NULL) {
+		perror(path);
+		return false;
+	}
+	fputs("# day\tpart 1\tpart 2\tmedian ms\n", f);
+	for (size_t d = 0; d < ADVENT_DAYS; d++) {
+		if (e[d].known)
+			fprintf(f,
+			        "%zu\t%s\t%s\t%.6lf\n",
+			        d + 1,
+			        e[d].answer[0],
+			        e[d].answer[1],
+			        1000. * e[d].median);
+	}
+	if (fclose(f) != 0) {
+		perror(path);
+		return false;
+	}
+	return true;
+}
+
+/* Takes the values of the label and value lines a day printed */
+static bool
+readanswers(FILE *const f, Expected *const got)
+{
+	char line[MANIFEST_LINE];
+	rewind(f);
+	for (size_t p = 0; p < 2; p++) {
+		char *field[2];
+		const bool has = fgets(line, sizeof(line), f) != NULL
+		                 && splittabs(line, field, 2) == 2;
+		got->answer[p] = copystr(has? field[1] : "-");
+	}
+	fclose(f);
+	return got->answer[0] != NULL && got->answer[1] != NULL;
+}
+
+/* Runs a day once for its answers, then benchmarks it for its median */
+static bool
+answerday(const size_t d,
+          const size_t runs,
+          const size_t warmup,
+          Expected *const got)
+{
+	char path[16];
+	Worker w;
+	sprintf(path, "input-%zu", d + 1);
+	if (!spawn(d, path, &w, false))
+		return false;
+	reap(&w, 1);
+	if (w.rep.status != EXIT_SUCCESS) {
+		replay(w.out, stdout);
+		replay(w.err, stderr);
+		fprintf(stderr, "Day %zu failed\n", d + 1);
+		return false;
+	}
+	fclose(w.err);
+	Stats stats[NMETRICS];
+	Report last;
+	if (!readanswers(w.out, got)) {
+		perror("Could not read the answers");
+		return false;
+	}
+	got->known = benchday(d, path, runs, warmup, stats, &last);
+	got->median = stats[WALL].median;
+	return got->known;
+}
+
+/*
+ * Checks the answers and median time of one day, or of all days with an
+ * input if `day` is 0, against `manifest`; fails on a wrong answer, a day
+ * missing from the manifest or a median more than `slower` percent above the
+ * baseline. With `path`, the
+ * days' answers and medians are saved there as a new manifest instead.
+ */
+static bool
+runcheck(const uint8_t day,
+         const size_t runs,
+         const size_t warmup,
+         const double slower,
+         const char *const path)
+{
+	const size_t ndays = ADVENT_DAYS;
+	Expected want[ndays], got[ndays];
+	for (size_t d = 0; d < ndays; d++)
+		want[d] = got[d] = (Expected) { .known = false };
+	if (path == NULL && !loadmanifest("manifest", want))
+		return false;
+	bool ok = true;
+	fputs("Day\tAnswers\tMedian ms\tBaseline\tChange\n", stderr);
+	for (size_t d = 0; d < ndays; d++) {
+		if (day != 0 && d + 1 != day)
+			continue;
+		if (path == NULL && !want[d].known) {
+			char input[16];
+			sprintf(input, "input-%zu", d + 1);
+			if (day == 0 && access(input, F_OK) != 0)
+				continue;
+			fprintf(stderr, "%zu\tmissing\n", d + 1);
+			ok = false;
+			continue;
+		}
+		if (!answerday(d, runs, warmup, got + d)) {
+			ok = false;
+			continue;
+		}
+		if (path != NULL) {
+			fprintf(stderr,
+			        "%zu\tsaved\t%7.3lf\n",
+			        d + 1,
+			        1000. * got[d].median);
+			continue;
+		}
+		const Expected *const g = got + d, *const w = want + d;
+		const bool right = strcmp(g->answer[0], w->answer[0]) == 0
+		                   && strcmp(g->answer[1], w->answer[1]) == 0;
+		const double change = w->median > 0
+		                      ? 100. * (g->median / w->median - 1)
+		                      : 0;
+		fprintf(stderr,
+		        "%zu\t%s\t%7.3lf\t%7.3lf\t%+.1lf%%%s\n",
+		        d + 1,
+		        right? "ok" : "wrong",
+		        1000. * g->median,
+		        1000. * w->median,
+		        change,
+		        change > slower? "\tslower" : "");
+		for (size_t p = 0; !right && p < 2; p++)
+			fprintf(stderr,
+			        "\tpart %zu: got %s, expected %s\n",
+			        p + 1,
+			        g->answer[p],
+			        w->answer[p]);
+		ok &= right && change <= slower;
+	}
+	if (path != NULL)
+		ok &= writemanifest(path, got);
+	freeexpected(want, ndays);
+	freeexpected(got, ndays);
+	return ok;
+}
+
+/*
+ * Runs every engine of one day, or of each day which has more than one if
+ * `day` is 0, and compares their answers and medians with the reference's;
+ * fails if an engine answers differently
+ */
+static bool
+rundiff(const uint8_t day, const size_t runs, const size_t warmup)
+{
+	bool ok = true, any = false;
+	fputs("Day\tEngine\tAnswers\tMedian ms\tSpeedup\n", stderr);
+	for (size_t d = 0; d < ADVENT_DAYS; d++) {
+		if ((day != 0 && d + 1 != day)
+		    || (day == 0 && advent_engines(d + 1, 1) == NULL))
+			continue;
+		Expected ref = { .known = false };
+		const char *name;
+		any = true;
+		for (unsigned i = 0; (name = advent_engines(d + 1, i)) != NULL;
+		     i++) {
+			Expected got = { .known = false };
+			if (!advent_engine(name)
+			    || !answerday(d, runs, warmup, &got)) {
+				freeexpected(&got, 1);
+				ok = false;
+				if (i == 0)
+					break;
+				continue;
+			}
+			const bool same = i == 0
+			                  || (strcmp(got.answer[0],
+			                             ref.answer[0]) == 0
+			                      && strcmp(got.answer[1],
+			                                ref.answer[1]) == 0);
+			fprintf(stderr,
+			        "%zu\t%s\t%s\t%7.3lf\t%.2lfx\n",
+			        d + 1,
+			        name,
+			        i == 0? "-" : same? "same" : "differ",
+			        1000. * got.median,
+			        i == 0? 1. : ref.median / got.median);
+			for (size_t p = 0; !same && p < 2; p++)
+				fprintf(stderr,
+				        "\tpart %zu: got %s, reference %s\n",
+				        p + 1,
+				        got.answer[p],
+				        ref.answer[p]);
+			ok &= same;
+			if (i == 0)
+				ref = got;
+			else
+				freeexpected(&got, 1);
+		}
+		freeexpected(&ref, 1);
+	}
+	advent_engine(NULL);
+	if (!any)
+		fputs("No day has more than one engine\n", stderr);
+	return any && ok;
+}
+
+/* Builds compare puts side by side */
+#define COMPARE_FILES 8
+
+/* Reads the medians of the days a CSV file saved by bench holds */
+static bool
+readmedians(const char *const path,
+            double median[const][NMETRICS],
+            bool known[const][NMETRICS])
+{
+	FILE *const f = fopen(path, "r");
+	if (f == NULL) {
+		perror(path);
+		return false;
+	}
+	char line[MANIFEST_LINE];
+	uintmax_t n = 0;
+	bool ok = true;
+	while (ok && fgets(line, sizeof(line), f) != NULL) {
+		char name[16];
+		size_t d, runs;
+		double min, ms;
+		Metric m = 0;
+		if (n++ == 0 && strncmp(line, "day,", 4) == 0)
+			continue;
+		ok = sscanf(line,
+		            "%zu,%15[^,],%zu,%lf,%lf",
+		            &d,
+		            name,
+		            &runs,
+		            &min,
+		            &ms) == 5
+		     && d >= 1 && d <= ADVENT_DAYS;
+		while (ok && m < NMETRICS && strcmp(name, metricname[m]) != 0)
+			m++;
+		if (!ok || m == NMETRICS) {
+			fprintf(stderr, "%s:%ju: Malformed line\n", path, n);
+			ok = false;
+			break;
+		}
+		median[d - 1][m] = ms;
+		known[d - 1][m] = true;
+	}
+	fclose(f);
+	return ok;
+}
+
+/*
+ * Prints the medians saved by bench -o for several builds side by side, with
+ * how many times faster than the first build each other one is
+ */
+static bool
+runcompare(const size_t n, char *const path[const])
+{
+	const size_t ndays = ADVENT_DAYS;
+	double median[n][ndays][NMETRICS];
+	bool known[n][ndays][NMETRICS];
+	memset(known, 0, sizeof(known));
+	for (size_t i = 0; i < n; i++) {
+		if (!readmedians(path[i], median[i], known[i]))
+			return false;
+	}
+	fputs("Day\tMetric", stderr);
+	for (size_t i = 0; i < n; i++)
+		fprintf(stderr, "\t%s", path[i]);
+	fputc('\n', stderr);
+	for (size_t d = 0; d < ndays; d++) {
+		for (Metric m = 0; m < NMETRICS; m++) {
+			if (!known[0][d][m])
+				continue;
+			fprintf(stderr,
+			        "%zu\t%s\t%7.3lf",
+			        d + 1,
+			        metricname[m],
+			        median[0][d][m]);
+			for (size_t i = 1; i < n; i++) {
+				if (!known[i][d][m] || median[i][d][m] <= 0)
+					fputs("\t-", stderr);
+				else
+					fprintf(stderr,
+					        "\t%7.3lf %.2lfx",
+					        median[i][d][m],
+					        median[0][d][m]
+					        / median[i][d][m]);
+			}
+			fputc('\n', stderr);
+		}
+	}
+	return true;
 }
 
 static void
 usage(const char *const cmd)
 {
-	const size_t ndays = sizeof(days) / sizeof(int (*)(FILE *));
-	fprintf(stderr, "usage: %s day\n", cmd);
+	const size_t ndays = ADVENT_DAYS;
+	fprintf(stderr,
+	        "usage: %s [-p] [-c threads] [-j jobs] [-t trace.json] [-f hz] "
+	        "[-r dir] [--isa=isa] [--pages=pages]\n"
+	        "       [--cpu=n] [--cold] [--engine=engine] day|all\n",
+	        cmd);
+	fprintf(stderr,
+	        "       %s [-n runs] [-w warmup] [-o out.json|out.csv] "
+	        "bench day|all\n",
+	        cmd);
+	fprintf(stderr,
+	        "       %s [-n runs] [-w warmup] [-k exponent] scale day|all\n",
+	        cmd);
+	fprintf(stderr,
+	        "       %s [-n runs] [-w warmup] [-s percent] [-o manifest] "
+	        "check day|all\n",
+	        cmd);
+	fprintf(stderr,
+	        "       %s [-n runs] [-w warmup] diff day|all\n",
+	        cmd);
+	fprintf(stderr, "       %s compare results.csv...\n", cmd);
 	fprintf(stderr, "day must be an integer between 1 and %zu\n\n", ndays);
 	fputs("Puzzle input must be piped into standard input.\n", stderr);
 	fprintf(stderr, "Easiest way to do it is: %s day < input\n", cmd);
+	fputs("With all and bench, days read input-N; all runs them in up to\n"
+	      "jobs workers and bench times runs of them after warmup ones.\n"
+	      "scale times input-N-S files for each scale S and fits the\n"
+	      "growth of the day, failing past the exponent given by -k.\n"
+	      "check compares answers and median times with the manifest\n"
+	      "file, failing on wrong answers or days -s percent slower;\n"
+	      "with -o it saves a new manifest instead.\n"
+	      "diff runs each engine of the days which have several and\n"
+	      "compares its answers and median time with the reference's.\n"
+	      "compare shows the medians bench -o saved for several builds\n"
+	      "and how many times faster than the first one the others are.\n"
+	      "-c sets how many threads a day may use; one per processor by\n"
+	      "default.\n"
+	      "-p counts cycles, instructions and cache misses of the days.\n"
+	      "-t saves when each day loads, parses, solves and runs the\n"
+	      "phases it marks, as Chrome trace events.\n"
+	      "-f samples where each day spends its time hz times per second\n"
+	      "and prints the functions it found most.\n"
+	      "-r saves what days 7, 8 and 20 parse into dir and reads it\n"
+	      "back on later runs of the same input instead of parsing.\n"
+	      "--isa forces the kernels of days onto generic, sse2, avx2 or\n"
+	      "avx512 code instead of the widest the processor has.\n"
+	      "--pages keeps the large tables of days 15 and 23 off pages\n"
+	      "larger than hugetlb, thp or malloc ones.\n"
+	      "--cpu runs everything on processor n, with one thread per day\n"
+	      "unless -c says otherwise.\n"
+	      "--cold evicts caches and drops the input of each day from the\n"
+	      "page cache before it starts, and all then reads no input\n"
+	      "ahead.\n"
+	      "--engine solves days 1 and 22 with their reference or fast\n"
+	      "engine instead of the fastest one.\n",
+	      stderr);
 }
 
 int
 main(int argc, char *argv[])
 {
-	const size_t ndays = sizeof(days) / sizeof(int (*)(FILE *));
+	const size_t ndays = ADVENT_DAYS;
+	size_t jobs = 1, runs = 10, warmup = 2, hz = 0, threads = 0, cpu = 0;
+	bool pinned = false;
+	double limit = -1, slower = 10;
+	const char *out = NULL, *trace = NULL;
 	uint8_t day;
-	switch (argc) {
-	case 0:
+	int arg = 1;
+	if (argc == 0) {
 		fputs("Standard library failed to initialize\n", stderr);
 		return EXIT_FAILURE;
-	case 2:
-		if (strcmp(argv[1], "all") == 0) {
-			runall();
-			return EXIT_SUCCESS;
-		} else {
-			day = parseday(argv[1]);
-			if (1 <= day && day <= ndays) {
-				return days[day - 1](stdin);
-			} else {
-				fprintf(stderr,
-					"Day must be an integer between 1 and %zu\n",
-					ndays);
+	}
+	for (; arg + 1 < argc && argv[arg][0] == '-'; arg++) {
+		const char *const opt = argv[arg], *const val = argv[++arg];
+		if (strcmp(opt, "-p") == 0) {
+			counting = true;
+			arg--;
+			continue;
+		}
+		if (strncmp(opt, "--isa=", 6) == 0) {
+			if (!advent_isa(opt + 6))
+				return EXIT_FAILURE;
+			arg--;
+			continue;
+		}
+		if (strncmp(opt, "--engine=", 9) == 0) {
+			if (!advent_engine(opt + 9))
+				return EXIT_FAILURE;
+			arg--;
+			continue;
+		}
+		if (strcmp(opt, "--cold") == 0) {
+			cold = true;
+			arg--;
+			continue;
+		}
+		if (strncmp(opt, "--cpu=", 6) == 0) {
+			if (!parsecount(opt + 6, &cpu) || cpu >= UINT_MAX) {
+				usage(argv[0]);
 				return EXIT_FAILURE;
 			}
+			pinned = true;
+			arg--;
+			continue;
+		}
+		if (strncmp(opt, "--pages=", 8) == 0) {
+			if (!parsepages(opt + 8))
+				return EXIT_FAILURE;
+			arg--;
+			continue;
+		}
+		if ((strcmp(opt, "-j") == 0 && parsecount(val, &jobs) && jobs > 0)
+		    || (strcmp(opt, "-n") == 0 && parsecount(val, &runs)
+		        && runs > 0)
+		    || (strcmp(opt, "-w") == 0 && parsecount(val, &warmup))
+		    || (strcmp(opt, "-k") == 0 && parsereal(val, &limit))
+		    || (strcmp(opt, "-s") == 0 && parsereal(val, &slower))
+		    || (strcmp(opt, "-f") == 0 && parsecount(val, &hz)
+		        && hz > 0 && hz <= 1000000 && (profiling = hz))
+		    || (strcmp(opt, "-c") == 0 && parsecount(val, &threads)
+		        && threads > 0 && threads <= UINT_MAX))
+			continue;
+		if (strcmp(opt, "-o") == 0) {
+			out = val;
+			continue;
+		}
+		if (strcmp(opt, "-t") == 0) {
+			trace = val;
+			tracing = true;
+			continue;
+		}
+		if (strcmp(opt, "-r") == 0) {
+			advent_snapshots(val);
+			continue;
 		}
-	default:
 		usage(argv[0]);
 		return EXIT_FAILURE;
 	}
+	/* A pinned run has a single processor to share out */
+	if (pinned && !pincpu(cpu)) {
+		fprintf(stderr,
+		        "Could not pin to processor %zu: %s\n",
+		        cpu,
+		        strerror(errno));
+		return EXIT_FAILURE;
+	}
+	advent_threads(pinned && threads == 0? 1 : threads);
+	if (argc - arg >= 3 && argc - arg <= COMPARE_FILES + 1
+	    && strcmp(argv[arg], "compare") == 0)
+		return runcompare(argc - arg - 1, argv + arg + 1)? EXIT_SUCCESS
+		                                                 : EXIT_FAILURE;
+	if (argc - arg == 2 && (strcmp(argv[arg], "bench") == 0
+	                        || strcmp(argv[arg], "scale") == 0
+	                        || strcmp(argv[arg], "check") == 0
+	                        || strcmp(argv[arg], "diff") == 0)) {
+		day = strcmp(argv[arg + 1], "all") == 0? 0 : parseday(argv[arg + 1]);
+		if (day == 0 && strcmp(argv[arg + 1], "all") != 0) {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+		if (strcmp(argv[arg], "scale") == 0)
+			return runscale(day, runs, warmup, limit)? EXIT_SUCCESS
+			                                         : EXIT_FAILURE;
+		if (strcmp(argv[arg], "diff") == 0)
+			return rundiff(day, runs, warmup)? EXIT_SUCCESS
+			                                 : EXIT_FAILURE;
+		if (strcmp(argv[arg], "check") == 0)
+			return runcheck(day, runs, warmup, slower, out)
+			       ? EXIT_SUCCESS
+			       : EXIT_FAILURE;
+		return runbench(day, runs, warmup, out)? EXIT_SUCCESS
+		                                       : EXIT_FAILURE;
+	} else if (argc - arg != 1) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (strcmp(argv[arg], "all") == 0)
+		return runall(jobs, trace)? EXIT_SUCCESS : EXIT_FAILURE;
+	day = parseday(argv[arg]);
+	if (cold && 1 <= day && day <= ndays && !evictcaches(STDIN_FILENO))
+		perror("Could not evict caches");
+	if (1 <= day && day <= ndays && !counting && !tracing)
+		return run(day - 1, STDIN_FILENO, NULL);
+	if (1 <= day && day <= ndays) {
+		Report rep = { .trace = { .n = 0 } };
+		const int status = run(day - 1, STDIN_FILENO, &rep);
+		if (counting && rep.hwerr != 0) {
+			fprintf(stderr,
+			        "Hardware counters unavailable: %s\n",
+			        counterror(rep.hwerr));
+		} else if (counting) {
+			printcounterhead();
+			printcounters(day - 1, &rep.hw);
+		}
+		const Report *reps[ndays];
+		for (size_t d = 0; d < ndays; d++)
+			reps[d] = d + 1 == day? &rep : NULL;
+		if (tracing && rep.start.tv_sec != 0
+		    && !writetrace(trace, reps, &rep.start))
+			return EXIT_FAILURE;
+		return status;
+	}
+	fprintf(stderr, "Day must be an integer between 1 and %zu\n", ndays);
+	return EXIT_FAILURE;
 }
@@ -0,0 +1,169 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/* Requires <stdbool.h>, <stddef.h> and <stdint.h> */
+
+#define ADVENT_DAYS 25
+
+/* Marks what the library exports, everything else being built hidden */
+#ifdef __GNUC__
+#define ADVENT_API __attribute__((visibility("default")))
+#else
+#define ADVENT_API
+#endif
+
+typedef enum {
+	ADVENT_NONE,
+	ADVENT_UINT,
+	ADVENT_INT,
+	ADVENT_STR
+} AdventType;
+
+typedef struct {
+	AdventType type;
+	const char *label;
+	union { uintmax_t u; intmax_t i; char *s; } val;
+} AdventAnswer;
+
+/*
+ * Pages backing the large tables of a day, from the largest to the smallest:
+ * huge pages reserved by the system, transparent huge pages the kernel was
+ * asked for, or what malloc gives. ADVENT_PAGES_NONE means there was no table.
+ */
+typedef enum {
+	ADVENT_PAGES_NONE,
+	ADVENT_PAGES_HUGETLB,
+	ADVENT_PAGES_THP,
+	ADVENT_PAGES_MALLOC
+} AdventPages;
+
+/*
+ * Answers to both parts of a day, and how many seconds were spent before and
+ * after the puzzle input was parsed. A part may be answered even if solving
+ * failed later on. `allocs` and `bytes` count the scratch allocations the day
+ * made, all of which are released before advent_solve returns, `pages` is
+ * the smallest kind of page which backed one of its large tables, and
+ * `tables` the bytes mapped for those tables rather than taken from malloc.
+ */
+typedef struct {
+	AdventAnswer part[2];
+	double parse, solve;
+	size_t allocs, bytes;
+	AdventPages pages;
+	size_t tables;
+} AdventResult;
+
+/*
+ * Solves `day` (1 to ADVENT_DAYS) for the puzzle input held in the `len`
+ * bytes at `buf`. Returns EXIT_SUCCESS or EXIT_FAILURE; errors are described
+ * on standard error. The result must be released with advent_free.
+ */
+ADVENT_API int advent_solve(unsigned day,
+                            const char *buf,
+                            size_t len,
+                            AdventResult *out);
+ADVENT_API void advent_free(AdventResult *res);
+
+/* Most phases traced in a day; later ones are dropped */
+#define ADVENT_SPANS 32
+
+/*
+ * A phase the day marked, in seconds since it was called. Names are string
+ * literals of the library; `end` stays 0 if the day failed within the phase.
+ */
+typedef struct {
+	const char *name;
+	double begin, end;
+} AdventSpan;
+
+typedef struct {
+	AdventSpan span[ADVENT_SPANS];
+	size_t n;
+} AdventTrace;
+
+/*
+ * Same as advent_solve, but also records the phases marked by the day into
+ * `trace` unless it is a null pointer
+ */
+ADVENT_API int advent_trace(unsigned day,
+                            const char *buf,
+                            size_t len,
+                            AdventResult *out,
+                            AdventTrace *trace);
+
+/*
+ * Same as advent_solve, but reads the puzzle input from `fd`, which is left
+ * open. Days which fold their input record by record solve it as it is read,
+ * keeping a few fixed buffers of it in memory; other days load it all first.
+ */
+ADVENT_API int advent_stream(unsigned day, int fd, AdventResult *out);
+
+/*
+ * Sets how many threads days may share, counting the caller; 0, the default,
+ * means one per online processor. Only calls made before the first day runs
+ * take effect.
+ */
+ADVENT_API void advent_threads(unsigned n);
+
+/*
+ * Makes days which can keep what they parsed in a snapshot save it in `dir`,
+ * keyed by a hash of their input, and map it back rather than parse the same
+ * input again. A null pointer, the default, turns snapshots off. Snapshots are
+ * only read back by builds of the same days on the same kind of machine.
+ */
+ADVENT_API void advent_snapshots(const char *dir);
+
+/*
+ * Makes the vectorized kernels days share use the variant for the instruction
+ * set `name`: "generic", "sse2", "avx2" or "avx512". A null pointer, the
+ * default, picks the widest one the processor has. Returns false if the name
+ * is unknown or the processor lacks the set. Only calls made before the first
+ * day runs take effect.
+ */
+ADVENT_API bool advent_isa(const char *name);
+
+/* Name of the instruction set the kernels use */
+ADVENT_API const char *advent_isaname(void);
+
+/*
+ * Makes days which have an engine called `name` solve with it, such as
+ * "reference" for the plain solvers faster engines are checked against, while
+ * other days keep their own. A null pointer, the default, runs the last engine
+ * of each day, its fastest. Returns false if no day has such an engine.
+ */
+ADVENT_API bool advent_engine(const char *name);
+
+/* Name of engine `i` of `day`, the reference first, or NULL past the last */
+ADVENT_API const char *advent_engines(unsigned day, unsigned i);
+
+/*
+ * Keeps large tables of days off pages larger than `best`, which is
+ * ADVENT_PAGES_HUGETLB by default, so as to measure what huge pages gain.
+ * ADVENT_PAGES_NONE is taken as the default.
+ */
+ADVENT_API void advent_pages(AdventPages best);
+
+/* Name of a kind of pages: "-", "hugetlb", "thp" or "malloc" */
+ADVENT_API const char *advent_pagesname(AdventPages);
+
+/*
+ * Puzzle input mapped from a regular file, or read from anything else into one
+ * contiguous buffer
+ */
+typedef struct {
+	const char *buf;
+	size_t len;
+	bool mapped;
+} AdventInput;
+
+/*
+ * Loads everything readable from `fd`, which is left open. Returns
+ * EXIT_SUCCESS or EXIT_FAILURE; the input must be released with advent_unload.
+ */
+ADVENT_API int advent_load(int fd, AdventInput *in);
+ADVENT_API void advent_unload(AdventInput *in);
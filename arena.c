@@ -0,0 +1,67 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+/* Size of the first block; each new block is twice as big as the last */
+#define BLOCK_SIZE 16384
+
+struct ArenaBlock {
+	ArenaBlock *prev;
+	size_t cap;
+	ArenaAlign data[];
+};
+
+void *
+argrow(Arena * const a, const size_t size)
+{
+	size_t cap = a->cap < BLOCK_SIZE? BLOCK_SIZE
+	             : a->cap <= SIZE_MAX / 2? 2 * a->cap : a->cap;
+	if (cap < size)
+		cap = size;
+	if (cap > SIZE_MAX - sizeof(ArenaBlock))
+		return NULL;
+	ArenaBlock * const b = malloc(sizeof(ArenaBlock) + cap);
+	if (b == NULL)
+		return NULL;
+	b->prev = a->block;
+	b->cap = cap;
+	a->block = b;
+	a->base = (char *) b->data;
+	a->cap = cap;
+	a->used = size;
+	return a->base;
+}
+
+void
+arrelease(Arena * const a)
+{
+	arreset(a, (ArenaMark) { .block = NULL, .used = 0 });
+}
+
+void
+arreset(Arena * const a, const ArenaMark mark)
+{
+	while (a->block != mark.block) {
+		ArenaBlock * const prev = a->block->prev;
+		free(a->block);
+		a->block = prev;
+	}
+	if (a->block == NULL) {
+		a->base = NULL;
+		a->cap = 0;
+	} else {
+		a->base = (char *) a->block->data;
+		a->cap = a->block->cap;
+	}
+	a->used = mark.used;
+}
@@ -0,0 +1,99 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/* Requires <stddef.h>, <stdint.h> and <string.h> */
+
+/* Allocations are aligned for any of these */
+typedef union {
+	uintmax_t u;
+	long double d;
+	void *p;
+	void (*f)(void);
+} ArenaAlign;
+
+typedef struct ArenaBlock ArenaBlock;
+
+/*
+ * Scratch memory handed out by bumping an offset through malloc'd blocks, and
+ * released all at once. `allocs` and `bytes` count what was asked of it.
+ */
+typedef struct {
+	ArenaBlock *block;
+	char *base;
+	size_t used, cap;
+	size_t allocs, bytes;
+} Arena;
+
+/* Point to which an arena can be rolled back, freeing what came after */
+typedef struct {
+	ArenaBlock *block;
+	size_t used;
+} ArenaMark;
+
+/* Starts a block big enough for `size` bytes; use aralloc instead */
+void *argrow(Arena *, size_t);
+
+/* Frees every block, leaving the counters for the caller to read */
+void arrelease(Arena *);
+
+/* Frees everything allocated since `mark` was taken */
+void arreset(Arena *, ArenaMark);
+
+static inline ArenaMark
+armark(const Arena * const a)
+{
+	return (ArenaMark) { .block = a->block, .used = a->used };
+}
+
+/* Returns `size` uninitialized bytes, or NULL if memory is exhausted */
+static inline void *
+aralloc(Arena * const a, const size_t size)
+{
+	const size_t align = sizeof(ArenaAlign);
+	if (size > SIZE_MAX - align)
+		return NULL;
+	const size_t rounded = size == 0? align
+	                       : (size + align - 1) / align * align;
+	a->allocs++;
+	a->bytes += size;
+	if (rounded > a->cap - a->used)
+		return argrow(a, rounded);
+	void * const p = a->base + a->used;
+	a->used += rounded;
+	return p;
+}
+
+/* Objects of one size recycled through a free list on top of an arena */
+typedef struct {
+	Arena *arena;
+	size_t size;
+	void *free;
+} Pool;
+
+#define POOL(a, type) ((Pool) { \
+	.arena = (a), \
+	.size = sizeof(type) < sizeof(void *)? sizeof(void *) : sizeof(type), \
+	.free = NULL \
+})
+
+static inline void *
+poolalloc(Pool * const pool)
+{
+	void * const p = pool->free;
+	if (p == NULL)
+		return aralloc(pool->arena, pool->size);
+	memcpy(&pool->free, p, sizeof(void *));
+	return p;
+}
+
+static inline void
+poolfree(Pool * const pool, void * const p)
+{
+	memcpy(p, &pool->free, sizeof(void *));
+	pool->free = p;
+}
@@ -0,0 +1,99 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "cold.h"
+
+/* Cache size assumed where the system does not tell, and the line size */
+#define COLD_CACHE ((size_t) 64 << 20)
+#define COLD_LINE 64
+
+bool
+pincpu(const unsigned cpu)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	if (cpu >= CPU_SETSIZE) {
+		errno = EINVAL;
+		return false;
+	}
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+	(void) cpu;
+	errno = ENOSYS;
+	return false;
+#endif
+}
+
+/* Size of the largest cache the system tells of */
+static size_t
+lastcache(void)
+{
+	long size = 0;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+	const long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+	size = l2 > size? l2 : size;
+#endif
+#ifdef _SC_LEVEL3_CACHE_SIZE
+	const long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+	size = l3 > size? l3 : size;
+#endif
+#ifdef _SC_LEVEL4_CACHE_SIZE
+	const long l4 = sysconf(_SC_LEVEL4_CACHE_SIZE);
+	size = l4 > size? l4 : size;
+#endif
+	return size > 0? (size_t) size : COLD_CACHE;
+}
+
+/*
+ * Lines are written and read through a volatile pointer, lest the compiler
+ * drop accesses to memory which is freed right after
+ */
+static bool
+streambuffer(void)
+{
+	const size_t len = 2 * lastcache();
+	char * const buf = malloc(len);
+	if (buf == NULL)
+		return false;
+	volatile char * const p = buf;
+	for (size_t i = 0; i < len; i += COLD_LINE)
+		p[i] = (char) i;
+	for (size_t i = 0; i < len; i += COLD_LINE)
+		(void) p[i];
+	free(buf);
+	return true;
+}
+
+bool
+evictcaches(const int fd)
+{
+	struct stat st;
+	if (!streambuffer())
+		return false;
+	if (fstat(fd, &st) < 0)
+		return false;
+	if (!S_ISREG(st.st_mode))
+		return true;
+	const int err = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	errno = err;
+	return err == 0;
+}
@@ -0,0 +1,23 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/* Requires <stdbool.h> */
+
+/*
+ * Pins the calling thread, and the threads and processes it starts later on,
+ * to processor `cpu`. Returns false and sets errno if it cannot.
+ */
+bool pincpu(unsigned cpu);
+
+/*
+ * Leaves caches cold for the next day: writes and reads back a buffer twice as
+ * large as the last level cache, then drops what the page cache holds of the
+ * file open as `fd`, if it is a regular file. Returns false and sets errno if
+ * either failed.
+ */
+bool evictcaches(int fd);
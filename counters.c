@@ -0,0 +1,176 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "counters.h"
+#include "parallel.h"
+
+const char *const countername[NCOUNTERS] = {
+	"Cycles", "Instr", "L1d miss", "LLC miss", "Br miss", "dTLB miss"
+};
+
+#ifdef __linux__
+#define READMISS(cache) ((cache) | PERF_COUNT_HW_CACHE_OP_READ << 8 \
+                         | PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+
+static const struct {
+	uint32_t type;
+	uint64_t config;
+} events[NCOUNTERS] = {
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HW_CACHE, READMISS(PERF_COUNT_HW_CACHE_L1D) },
+	{ PERF_TYPE_HW_CACHE, READMISS(PERF_COUNT_HW_CACHE_LL) },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ PERF_TYPE_HW_CACHE, READMISS(PERF_COUNT_HW_CACHE_DTLB) }
+};
+#endif
+
+#ifdef __linux__
+/*
+ * The caller's counters are inherited by the threads it starts while they are
+ * open, such as the pool starting during the first day that uses it. Pool
+ * threads started before them get counters of their own.
+ */
+static int
+open1(const Counter i, const long tid, const bool inherit)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = events[i].type;
+	attr.config = events[i].config;
+	attr.disabled = 1;
+	attr.inherit = inherit;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+	                   | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+}
+#endif
+
+bool
+countopen(Counters * const c)
+{
+	bool any = false;
+	int err = ENOSYS;
+	long tid[COUNTED_THREADS];
+	tid[0] = 0;
+	c->nthreads = 1 + paralleltids(tid + 1, COUNTED_THREADS - 1);
+	/* Opened apart, so that a missing event spares the rest */
+	for (size_t t = 0; t < c->nthreads; t++) {
+		for (Counter i = 0; i < NCOUNTERS; i++) {
+			c->fd[t][i] = -1;
+#ifdef __linux__
+			c->fd[t][i] = open1(i, tid[t], t == 0);
+			if (c->fd[t][i] < 0)
+				err = errno;
+			else
+				any = true;
+#endif
+		}
+	}
+	if (!any)
+		errno = err;
+	return any;
+}
+
+void
+countstart(const Counters * const c)
+{
+#ifdef __linux__
+	for (size_t t = 0; t < c->nthreads; t++) {
+		for (Counter i = 0; i < NCOUNTERS; i++) {
+			if (c->fd[t][i] < 0)
+				continue;
+			ioctl(c->fd[t][i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(c->fd[t][i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+#else
+	(void) c;
+#endif
+}
+
+/*
+ * Counts are scaled up when the kernel had to share the hardware. An event is
+ * `ok` once any thread counted it.
+ */
+void
+countstop(const Counters * const c, CounterSample * const s)
+{
+	for (Counter i = 0; i < NCOUNTERS; i++) {
+		s->val[i] = 0;
+		s->ok[i] = false;
+	}
+#ifdef __linux__
+	for (size_t t = 0; t < c->nthreads; t++) {
+		for (Counter i = 0; i < NCOUNTERS; i++) {
+			uint64_t buf[3];
+			if (c->fd[t][i] < 0)
+				continue;
+			ioctl(c->fd[t][i], PERF_EVENT_IOC_DISABLE, 0);
+			if (read(c->fd[t][i], buf, sizeof(buf)) != sizeof(buf)
+			    || buf[2] == 0)
+				continue;
+			s->val[i] += buf[2] < buf[1]
+			             ? (uint64_t) ((double) buf[0]
+			                           * (double) buf[1]
+			                           / (double) buf[2])
+			             : buf[0];
+			s->ok[i] = true;
+		}
+	}
+#else
+	(void) c;
+#endif
+}
+
+const char *
+counterror(const int err)
+{
+	switch (err) {
+	case ENOENT:
+	case ENODEV:
+	case EOPNOTSUPP:
+		return "the CPU or hypervisor does not expose them";
+	case EACCES:
+	case EPERM:
+		return "not permitted by kernel.perf_event_paranoid";
+	case ENOSYS:
+		return "perf_event_open is not supported";
+	default:
+		return strerror(err);
+	}
+}
+
+void
+countclose(Counters * const c)
+{
+	for (size_t t = 0; t < c->nthreads; t++) {
+		for (Counter i = 0; i < NCOUNTERS; i++) {
+			if (c->fd[t][i] >= 0)
+				close(c->fd[t][i]);
+			c->fd[t][i] = -1;
+		}
+	}
+	c->nthreads = 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/* Requires <stdbool.h>, <stddef.h> and <stdint.h> */
+
+/* Hardware events counted in user space around a day */
+typedef enum {
+	CYCLES,
+	INSTRUCTIONS,
+	L1DMISS,
+	LLCMISS,
+	BRANCHMISS,
+	DTLBMISS,
+	NCOUNTERS
+} Counter;
+
+extern const char *const countername[NCOUNTERS];
+
+/* Events the CPU could not count are not `ok` */
+typedef struct {
+	uint64_t val[NCOUNTERS];
+	bool ok[NCOUNTERS];
+} CounterSample;
+
+/* Threads counted apart: the caller and the pool threads already running */
+#define COUNTED_THREADS 64
+
+typedef struct {
+	int fd[COUNTED_THREADS][NCOUNTERS];
+	size_t nthreads;
+} Counters;
+
+/*
+ * Opens whichever counters the kernel and CPU offer. Returns false and sets
+ * errno if there are none, in which case the other calls do nothing. Samples
+ * sum the caller, the threads it starts meanwhile and the pool threads.
+ */
+bool countopen(Counters *);
+void countstart(const Counters *);
+void countstop(const Counters *, CounterSample *);
+void countclose(Counters *);
+
+/* Describes why countopen failed, given its errno */
+const char *counterror(int);
@@ -0,0 +1,118 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/* Requires "advent.h", "arena.h" and "input.h" */
+
+int day01(Input *, AdventResult *);
+int day02(Input *, AdventResult *);
+int day03(Input *, AdventResult *);
+int day04(Input *, AdventResult *);
+int day05(Input *, AdventResult *);
+int day06(Input *, AdventResult *);
+int day07(Input *, AdventResult *);
+int day08(Input *, AdventResult *);
+int day09(Input *, AdventResult *);
+int day10(Input *, AdventResult *);
+int day11(Input *, AdventResult *);
+int day12(Input *, AdventResult *);
+int day13(Input *, AdventResult *);
+int day14(Input *, AdventResult *);
+int day15(Input *, AdventResult *);
+int day16(Input *, AdventResult *);
+int day17(Input *, AdventResult *);
+int day18(Input *, AdventResult *);
+int day19(Input *, AdventResult *);
+int day20(Input *, AdventResult *);
+int day21(Input *, AdventResult *);
+int day22(Input *, AdventResult *);
+int day23(Input *, AdventResult *);
+int day24(Input *, AdventResult *);
+int day25(Input *, AdventResult *);
+
+/*
+ * A way of solving a day. Days with several list them in an array ended by a
+ * null name, starting with the reference: the straightforward solver which
+ * faster engines are checked against. The last one runs unless another is
+ * asked for. Other days only have their reference.
+ */
+typedef struct {
+	const char *name;
+	int (*solve)(Input *, AdventResult *);
+} Engine;
+
+extern const Engine engines01[], engines22[];
+
+/*
+ * Days whose input is a sequence of records they fold one at a time may take
+ * it in chunks of whole records as it is read, each chunk but the last ending
+ * with `sep`. The fold keeps `size` bytes of state in scratch memory, zeroed
+ * then set up by `begin` if any; `fold` takes a chunk and `finish` gives the
+ * answers. `release`, if any, is called last once `begin` has succeeded.
+ */
+typedef struct {
+	const char *sep;
+	size_t size;
+	bool (*begin)(void *, AdventResult *);
+	bool (*fold)(void *, Input *);
+	int (*finish)(void *, AdventResult *);
+	void (*release)(void *);
+} Stream;
+
+extern const Stream stream02, stream04, stream05, stream06, stream12, stream18;
+
+/* Solves a day which may stream from input read beforehand */
+int foldinput(const Stream *, Input *, AdventResult *);
+
+/*
+ * Reads `fd` to its end on a thread of its own and folds whole records as
+ * they come. Returns false if reading or folding failed.
+ */
+bool streamfeed(int, const char *, bool (*)(void *, Input *), void *);
+
+/*
+ * With snapshots on, returns what the day saved with snapsave at the same
+ * `version` after parsing this same input, setting `size`, so that it need not
+ * parse it again; returns NULL otherwise. The bytes stay mapped until the day
+ * returns, so they must hold no pointers. Bump `version` whenever what the day
+ * saves changes.
+ */
+const void *snapload(AdventResult *, unsigned version, size_t *size);
+
+/* Saves `size` bytes for snapload; failing to is told but not fatal */
+void snapsave(AdventResult *, unsigned version, const void *, size_t size);
+
+/*
+ * Called by a day once its puzzle input is read. Days which fold records as
+ * they read them count that work as parsing.
+ */
+void parsed(AdventResult *);
+
+/*
+ * Marks the beginning of a phase of the day and returns what ends it; phases
+ * may nest. Both do next to nothing unless the caller traces the day.
+ */
+size_t tracebegin(AdventResult *, const char *);
+void traceend(AdventResult *, size_t);
+
+/*
+ * Scratch memory of the running day, released with everything in it when the
+ * day returns
+ */
+Arena *scratch(AdventResult *);
+
+/*
+ * Returns `size` uninitialized bytes for a large table the day reaches at
+ * random, on huge pages where the system allows, or NULL if memory is
+ * exhausted. Tables are released when the day returns.
+ */
+void *bigtable(AdventResult *, size_t size);
+
+/* Record the answer to part 0 or 1; strings are copied */
+void answeruint(AdventResult *, unsigned, const char *, uintmax_t);
+void answerint(AdventResult *, unsigned, const char *, intmax_t);
+bool answerstr(AdventResult *, unsigned, const char *, const char *);
@@ -0,0 +1,1188 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Day 7 cannot parse more rules than this */
+#define MAX_RULES 1024
+/* Day 9 numbers stop growing once they reach this */
+#define DAY09_CAP (UINT64_C(1) << 40)
+
+typedef struct {
+	uint64_t state;
+} Rng;
+
+typedef bool Gen(Rng *, uintmax_t);
+
+/* splitmix64, so that any seed gives a well mixed stream */
+static uint64_t
+next(Rng * const r)
+{
+	uint64_t z = r->state += UINT64_C(0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+	return z ^ (z >> 31);
+}
+
+static uint64_t
+below(Rng * const r, const uint64_t n)
+{
+	return next(r) % n;
+}
+
+static int64_t
+between(Rng * const r, const int64_t lo, const int64_t hi)
+{
+	return lo + (int64_t) below(r, (uint64_t) (hi - lo) + 1);
+}
+
+static bool
+chance(Rng * const r, const double p)
+{
+	return (double) (next(r) >> 11) * 0x1p-53 < p;
+}
+
+static void
+shuffle(Rng * const r, size_t * const a, const size_t n)
+{
+	for (size_t i = n; i > 1; i--) {
+		const size_t j = below(r, i), t = a[i - 1];
+		a[i - 1] = a[j];
+		a[j] = t;
+	}
+}
+
+/* Returns 0, 1, ..., n - 1 in random order */
+static size_t *
+permutation(Rng * const r, const size_t n)
+{
+	size_t * const a = malloc((n > 0? n : 1) * sizeof(size_t));
+	if (a == NULL) {
+		fprintf(stderr, "Could not allocate %zu indices\n", n);
+		return NULL;
+	}
+	for (size_t i = 0; i < n; i++)
+		a[i] = i;
+	shuffle(r, a, n);
+	return a;
+}
+
+/* Multiplies the base size, refusing counts that do not fit */
+static bool
+scaled(const uintmax_t base,
+       const uintmax_t scale,
+       const uintmax_t max,
+       size_t * const n)
+{
+	if (scale > max / base) {
+		fprintf(stderr, "Scale %ju is too large for this day\n", scale);
+		return false;
+	}
+	*n = base * scale;
+	return true;
+}
+
+static bool
+forbidden01(const int64_t x, const int64_t t[3], const int64_t a)
+{
+	for (size_t i = 0; i < 3; i++) {
+		if (x == t[i] || x == a - t[i] || x == 2020 - t[i])
+			return true;
+	}
+	return x == a;
+}
+
+/* Planted pair and triple; fillers never make another 2020 */
+static bool
+gen01(Rng * const r, const uintmax_t scale)
+{
+	size_t n, pos[5];
+	if (!scaled(200, scale, SIZE_MAX, &n))
+		return false;
+	int64_t t[3], a;
+	do {
+		t[0] = between(r, 500, 800);
+		t[1] = between(r, 500, 800);
+		t[2] = 2020 - t[0] - t[1];
+	} while (t[0] == t[1] || t[0] == t[2] || t[1] == t[2]);
+	do {
+		a = between(r, 1011, 2019);
+	} while (a == t[0] + t[1] || a == t[0] + t[2] || a == t[1] + t[2]
+	         || a == t[0] || a == t[1] || a == t[2]
+	         || 2020 - a == t[0] || 2020 - a == t[1] || 2020 - a == t[2]);
+	const int64_t special[5] = { a, 2020 - a, t[0], t[1], t[2] };
+	for (size_t i = 0; i < 5; i++) {
+		bool taken;
+		do {
+			pos[i] = below(r, n);
+			taken = false;
+			for (size_t j = 0; j < i; j++)
+				taken |= pos[j] == pos[i];
+		} while (taken);
+	}
+	for (size_t i = 0; i < n; i++) {
+		int64_t x = 0;
+		bool planted = false;
+		for (size_t j = 0; j < 5; j++) {
+			if (pos[j] == i) {
+				x = special[j];
+				planted = true;
+			}
+		}
+		while (!planted
+		       && forbidden01(x = between(r, 1011, 2020), t, a));
+		printf("%" PRId64 "\n", x);
+	}
+	return true;
+}
+
+static bool
+gen02(Rng * const r, const uintmax_t scale)
+{
+	size_t n;
+	if (!scaled(1000, scale, SIZE_MAX, &n))
+		return false;
+	for (size_t i = 0; i < n; i++) {
+		const int64_t lo = between(r, 1, 8);
+		const int64_t hi = between(r, lo + 1, 16);
+		const int64_t len = between(r, hi, 20);
+		printf("%" PRId64 "-%" PRId64 " %c: ",
+		       lo,
+		       hi,
+		       (int) ('a' + below(r, 10)));
+		for (int64_t j = 0; j < len; j++)
+			putchar('a' + (int) below(r, 10));
+		putchar('\n');
+	}
+	return true;
+}
+
+static bool
+gen03(Rng * const r, const uintmax_t scale)
+{
+	size_t n;
+	if (!scaled(323, scale, SIZE_MAX, &n))
+		return false;
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j < 31; j++)
+			putchar(chance(r, .25)? '#' : '.');
+		putchar('\n');
+	}
+	return true;
+}
+
+static void
+putrandom(Rng * const r, const char * const set, const size_t len)
+{
+	const size_t n = strlen(set);
+	for (size_t i = 0; i < len; i++)
+		putchar(set[below(r, n)]);
+}
+
+static void
+field04(Rng * const r, const size_t k, const bool ok)
+{
+	static const char *const ecl[] = {
+		"amb", "blu", "brn", "gry", "grn", "hzl", "oth"
+	};
+	static const char *const badecl[] = { "xry", "blu2", "wat" };
+	switch (k) {
+	case 0:
+		printf("%" PRId64,
+		       ok? between(r, 1920, 2002) : between(r, 1900, 2030));
+		break;
+	case 1:
+		printf("%" PRId64,
+		       ok? between(r, 2010, 2020) : between(r, 2000, 2030));
+		break;
+	case 2:
+		printf("%" PRId64,
+		       ok? between(r, 2020, 2030) : between(r, 2010, 2040));
+		break;
+	case 3:
+		if (!ok)
+			printf("%" PRId64, between(r, 50, 200));
+		else if (chance(r, .5))
+			printf("%" PRId64 "cm", between(r, 150, 193));
+		else
+			printf("%" PRId64 "in", between(r, 59, 76));
+		break;
+	case 4:
+		putchar(ok? '#' : 'z');
+		putrandom(r, "0123456789abcdef", 6);
+		break;
+	case 5:
+		fputs(ok? ecl[below(r, 7)] : badecl[below(r, 3)], stdout);
+		break;
+	case 6:
+		putrandom(r, "0123456789", ok? 9 : 8);
+		break;
+	default:
+		printf("%" PRId64, between(r, 100, 350));
+	}
+}
+
+static bool
+gen04(Rng * const r, const uintmax_t scale)
+{
+	static const char *const name[] = {
+		"byr", "iyr", "eyr", "hgt", "hcl", "ecl", "pid", "cid"
+	};
+	size_t n;
+	if (!scaled(280, scale, SIZE_MAX, &n))
+		return false;
+	for (size_t i = 0; i < n; i++) {
+		size_t f[8], nf;
+		do {
+			nf = 0;
+			for (size_t k = 0; k < 8; k++) {
+				if (chance(r, .93))
+					f[nf++] = k;
+			}
+		} while (nf == 0);
+		shuffle(r, f, nf);
+		if (i > 0)
+			putchar('\n');
+		char sep = ' ';
+		for (size_t k = 0; k < nf; k++) {
+			if (k > 0)
+				putchar(sep);
+			printf("%s:", name[f[k]]);
+			field04(r, f[k], chance(r, .9));
+			sep = chance(r, .3)? '\n' : ' ';
+		}
+		putchar('\n');
+	}
+	return true;
+}
+
+static void
+pass05(const size_t id)
+{
+	for (int k = 9; k >= 0; k--) {
+		const bool high = (id >> k) & 1;
+		putchar(k >= 3? (high? 'B' : 'F') : (high? 'R' : 'L'));
+	}
+	putchar('\n');
+}
+
+/* The plane has 1024 seats, so larger scales repeat boarding passes */
+static bool
+gen05(Rng * const r, const uintmax_t scale)
+{
+	size_t extra;
+	if (!scaled(839, scale - 1, SIZE_MAX, &extra))
+		return false;
+	size_t * const id = permutation(r, 839);
+	if (id == NULL)
+		return false;
+	for (size_t i = 0; i < 839; i++) {
+		id[i] += 60;
+		if (id[i] >= 517)
+			id[i]++;
+		pass05(id[i]);
+	}
+	for (size_t i = 0; i < extra; i++)
+		pass05(id[below(r, 839)]);
+	free(id);
+	return true;
+}
+
+static bool
+gen06(Rng * const r, const uintmax_t scale)
+{
+	size_t n;
+	if (!scaled(480, scale, SIZE_MAX, &n))
+		return false;
+	for (size_t i = 0; i < n; i++) {
+		if (i > 0)
+			putchar('\n');
+		for (int64_t p = between(r, 1, 5); p > 0; p--) {
+			char q[26];
+			size_t m = 26;
+			for (size_t k = 0; k < 26; k++)
+				q[k] = 'a' + k;
+			for (int64_t k = between(r, 1, 15); k > 0; k--) {
+				const size_t j = below(r, m);
+				putchar(q[j]);
+				q[j] = q[--m];
+			}
+			putchar('\n');
+		}
+	}
+	return true;
+}
+
+typedef struct {
+	size_t child[4], qty[4], n;
+} Rule07;
+
+/* Adjective, colour, then a letter suffix once the pairs run out */
+static void
+name07(size_t v)
+{
+	static const char *const adj[] = {
+		"light", "dark", "bright", "muted", "shiny", "faded",
+		"dotted", "vibrant", "dull", "pale", "clear", "wavy",
+		"drab", "dim", "plaid", "posh", "mirrored", "striped"
+	};
+	static const char *const col[] = {
+		"red", "orange", "white", "yellow", "gold", "olive", "plum",
+		"black", "blue", "tan", "teal", "lime", "cyan", "coral",
+		"beige", "brown", "gray", "green", "indigo", "lavender",
+		"magenta", "maroon", "salmon", "silver", "violet"
+	};
+	printf("%s %s", adj[v % 18], col[v / 18 % 25]);
+	for (v /= 18 * 25; v > 0; v /= 26)
+		putchar('a' + (int) (v % 26));
+}
+
+/* Children always come later, so the rules form a DAG */
+static bool
+gen07(Rng * const r, const uintmax_t scale)
+{
+	size_t n;
+	if (!scaled(420, scale, SIZE_MAX, &n))
+		return false;
+	if (n > MAX_RULES)
+		n = MAX_RULES;
+	Rule07 * const rule = malloc(n * sizeof(Rule07));
+	size_t * const name = permutation(r, n);
+	size_t * const order = permutation(r, n);
+	if (rule == NULL || name == NULL || order == NULL) {
+		fputs("Could not allocate the rules\n", stderr);
+		free(rule);
+		free(name);
+		free(order);
+		return false;
+	}
+	/* Shiny gold is index 4 + 18 * 4, with 120 rules below it */
+	for (size_t i = 0; i < n; i++) {
+		if (name[i] == 76) {
+			name[i] = name[n - 120];
+			name[n - 120] = 76;
+		}
+	}
+	for (size_t i = 0; i < n; i++) {
+		rule[i].n = 0;
+		if (i + 20 > n || chance(r, .08))
+			continue;
+		const size_t k = between(r, 1, 4);
+		while (rule[i].n < k && rule[i].n < n - i - 1) {
+			const size_t c = i + 1 + below(r, n - i - 1);
+			bool seen = false;
+			for (size_t j = 0; j < rule[i].n; j++)
+				seen |= rule[i].child[j] == c;
+			if (seen)
+				continue;
+			rule[i].child[rule[i].n] = c;
+			rule[i].qty[rule[i].n++] = between(r, 1, 5);
+		}
+	}
+	for (size_t o = 0; o < n; o++) {
+		const Rule07 * const it = &rule[order[o]];
+		name07(name[order[o]]);
+		fputs(" bags contain ", stdout);
+		if (it->n == 0)
+			fputs("no other bags", stdout);
+		for (size_t j = 0; j < it->n; j++) {
+			printf("%s%zu ", j > 0? ", " : "", it->qty[j]);
+			name07(name[it->child[j]]);
+			fputs(it->qty[j] > 1? " bags" : " bag", stdout);
+		}
+		fputs(".\n", stdout);
+	}
+	free(rule);
+	free(name);
+	free(order);
+	return true;
+}
+
+/*
+ * Jumps only go forward, so the boot code runs to the end until one
+ * executed instruction past the plant point jumps back onto its own path.
+ */
+static bool
+gen08(Rng * const r, const uintmax_t scale)
+{
+	size_t n, recent[32], nrecent = 0, pc = 0;
+	if (!scaled(620, scale, SIZE_MAX / 2, &n))
+		return false;
+	const size_t plant = n / 2 + below(r, n / 4);
+	bool planted = false;
+	for (size_t i = 0; i < n; i++) {
+		if (i + 1 == n) {
+			puts("acc +7");
+			break;
+		}
+		const bool run = !planted && i == pc;
+		if (run && nrecent > 0 && (i >= plant || i + 6 >= n)) {
+			printf("jmp -%zu\n", i - recent[below(r, nrecent)]);
+			planted = true;
+			continue;
+		}
+		const double p = (double) (next(r) >> 11) * 0x1p-53;
+		int64_t x = 1;
+		if (p < .5) {
+			x = between(r, -50, 50);
+			printf("acc %+" PRId64 "\n", x != 0? x : 1);
+			x = 1;
+		} else if (p < .75 && i + 5 < n) {
+			x = between(r, 1, 4);
+			printf("jmp %+" PRId64 "\n", x);
+		} else if (p < .75) {
+			puts("acc +3");
+		} else {
+			const int64_t lo = i < 30? -(int64_t) i : -30;
+			x = i > 0? between(r, lo, -1) : 0;
+			printf("nop %+" PRId64 "\n", x);
+			x = 1;
+		}
+		if (run) {
+			recent[nrecent < 32? nrecent++ : i % 32] = i;
+			pc = i + (size_t) x;
+		}
+	}
+	return true;
+}
+
+static bool
+pairsum09(const uint64_t w[25], const uint64_t x)
+{
+	for (size_t i = 0; i < 24; i++) {
+		for (size_t j = i + 1; j < 25; j++) {
+			if (w[i] + w[j] == x)
+				return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Two zeros in every window keep the numbers bounded: any number already
+ * in the window is itself plus zero.
+ */
+static bool
+gen09(Rng * const r, const uintmax_t scale)
+{
+	size_t n;
+	if (!scaled(1000, scale, SIZE_MAX, &n))
+		return false;
+	uint64_t head[420], w[25];
+	size_t k = between(r, 500, 699);
+	if (k % 25 < 2)
+		k += 2 - k % 25;
+	for (size_t i = 0; i < n; i++) {
+		uint64_t x;
+		if (i % 25 < 2) {
+			x = 0;
+		} else if (i < 25) {
+			bool seen;
+			do {
+				x = between(r, 1, 59);
+				seen = false;
+				for (size_t j = 2; j < i; j++)
+					seen |= head[j] == x;
+			} while (seen);
+		} else if (i == k) {
+			size_t s, e;
+			do {
+				s = between(r, 100, 400);
+				e = s + between(r, 3, 15);
+				x = 0;
+				for (size_t j = s; j < e; j++)
+					x += head[j];
+			} while (pairsum09(w, x));
+		} else {
+			const size_t a = below(r, 25);
+			const size_t b = (a + 1 + below(r, 24)) % 25;
+			x = w[a] + w[b];
+			if (x > DAY09_CAP)
+				x = w[a];
+		}
+		if (i < 420)
+			head[i] = x;
+		w[i % 25] = x;
+		printf("%" PRIu64 "\n", x);
+	}
+	return true;
+}
+
+/*
+ * Runs of ones stay below five, as in the puzzle, and past the first
+ * hundred adapters they stay single, so new adapters keep the number of
+ * arrangements unchanged and within 64 bits.
+ */
+static bool
+gen10(Rng * const r, const uintmax_t scale)
+{
+	size_t n;
+	if (!scaled(100, scale, SIZE_MAX / sizeof(size_t), &n))
+		return false;
+	size_t * const a = malloc(n * sizeof(size_t));
+	if (a == NULL) {
+		fputs("Could not allocate the adapters\n", stderr);
+		return false;
+	}
+	size_t j = 0, ones = 0;
+	for (size_t i = 0; i < n; i++) {
+		const bool one = i < 100? ones < 4 && below(r, 4) < 3
+		                         : ones == 0 && below(r, 3) == 0;
+		ones = one? ones + 1 : 0;
+		a[i] = j += one? 1 : 3;
+	}
+	shuffle(r, a, n);
+	for (size_t i = 0; i < n; i++)
+		printf("%zu\n", a[i]);
+	free(a);
+	return true;
+}
+
+/*
+ * Random floor makes seats that flip forever; whole aisles of floor split
+ * the hall into blocks that always settle.
+ */
+static bool
+gen11(Rng * const r, const uintmax_t scale)
+{
+	bool aisle[95] = { false };
+	size_t n;
+	if (!scaled(90, scale, SIZE_MAX, &n))
+		return false;
+	for (size_t j = between(r, 3, 12); j < 93; j += between(r, 4, 14))
+		aisle[j] = true;
+	for (size_t i = 0; i < n; i++) {
+		const bool row = i > 0 && i + 1 < n && chance(r, .08);
+		for (size_t j = 0; j < 95; j++)
+			putchar(row || aisle[j]? '.' : 'L');
+		putchar('\n');
+	}
+	return true;
+}
+
+static bool
+gen12(Rng * const r, const uintmax_t scale)
+{
+	size_t n;
+	if (!scaled(780, scale, SIZE_MAX, &n))
+		return false;
+	for (size_t i = 0; i < n; i++) {
+		const char a = "NSEWLRF"[below(r, 7)];
+		const int64_t v = a == 'L' || a == 'R'? 90 * between(r, 1, 3)
+		                                     : between(r, 1, 99);
+		printf("%c%" PRId64 "\n", a, v);
+	}
+	return true;
+}
+
+/* The bus ids stay the same so that their product fits */
+static bool
+gen13(Rng * const r, const uintmax_t scale)
+{
+	static const unsigned prime[] = { 7, 13, 17, 19, 23, 29, 31, 37, 41 };
+	size_t n;
+	if (!scaled(60, scale, SIZE_MAX, &n))
+		return false;
+	unsigned char * const slot = calloc(n, 1);
+	if (slot == NULL) {
+		fputs("Could not allocate the schedule\n", stderr);
+		return false;
+	}
+	for (size_t i = 0; i < 9; i++)
+		slot[i > 0? below(r, n) : 0] = i + 1;
+	fputs("1000391\n", stdout);
+	for (size_t i = 0; i < n; i++) {
+		if (i > 0)
+			putchar(',');
+		if (slot[i] > 0)
+			printf("%u", prime[slot[i] - 1]);
+		else
+			putchar('x');
+	}
+	putchar('\n');
+	free(slot);
+	return true;
+}
+
+static bool
+gen14(Rng * const r, const uintmax_t scale)
+{
+	size_t n;
+	if (!scaled(100, scale, SIZE_MAX, &n))
+		return false;
+	for (size_t i = 0; i < n; i++) {
+		bool floating[36] = { false };
+		for (int64_t k = between(r, 3, 8); k > 0; k--) {
+			size_t b;
+			while (floating[b = below(r, 36)]);
+			floating[b] = true;
+		}
+		fputs("mask = ", stdout);
+		for (size_t b = 36; b-- > 0;)
+			putchar(floating[b]? 'X' : "01"[below(r, 2)]);
+		putchar('\n');
+		for (int64_t k = between(r, 2, 5); k > 0; k--) {
+			const int64_t addr = between(r, 0, 65535);
+			printf("mem[%" PRId64 "] = %" PRId64 "\n",
+			       addr,
+			       between(r, 1, 1000000000));
+		}
+	}
+	return true;
+}
+
+/* The game always runs for 30000000 turns; only the start varies */
+static bool
+gen15(Rng * const r, const uintmax_t scale)
+{
+	(void) scale;
+	size_t * const start = permutation(r, 20);
+	if (start == NULL)
+		return false;
+	for (size_t i = 0; i < 6; i++)
+		printf("%zu%c", start[i], i < 5? ',' : '\n');
+	free(start);
+	return true;
+}
+
+static void
+ticket16(Rng * const r,
+         const int64_t limit[20],
+         const size_t field[20],
+         int64_t t[20])
+{
+	for (size_t c = 0; c < 20; c++)
+		t[c] = between(r, 1, limit[field[c]]);
+}
+
+static void
+putticket16(const int64_t t[20])
+{
+	for (size_t c = 0; c < 20; c++)
+		printf("%" PRId64 "%c", t[c], c < 19? ',' : '\n');
+}
+
+/*
+ * Field k accepts 1 to limit[k] and limits shrink with k, so one ticket
+ * per column rules out all the later fields and the order is unique.
+ */
+static bool
+gen16(Rng * const r, const uintmax_t scale)
+{
+	static const char *const name[] = {
+		"departure location", "departure station",
+		"departure platform", "departure track", "departure date",
+		"departure time", "arrival location", "arrival station",
+		"arrival platform", "arrival track", "class", "duration",
+		"price", "route", "row", "seat", "train", "type", "wagon",
+		"zone"
+	};
+	size_t n, pos[19];
+	if (!scaled(200, scale, SIZE_MAX - 19, &n))
+		return false;
+	n += 19;
+	int64_t limit[20], t[20], forced[19][20];
+	for (size_t k = 0; k < 20; k++)
+		limit[k] = 40 + 45 * (20 - (int64_t) k);
+	size_t * const field = permutation(r, 20);
+	if (field == NULL)
+		return false;
+	for (size_t k = 0; k < 20; k++) {
+		const int64_t m = between(r, 5, limit[k] - 5);
+		printf("%s: 1-%" PRId64 " or %" PRId64 "-%" PRId64 "\n",
+		       name[k],
+		       m,
+		       m + 1,
+		       limit[k]);
+	}
+	fputs("\nyour ticket:\n", stdout);
+	ticket16(r, limit, field, t);
+	putticket16(t);
+	fputs("\nnearby tickets:\n", stdout);
+	size_t nforced = 0;
+	for (size_t c = 0; c < 20; c++) {
+		const size_t k = field[c];
+		if (k + 1 >= 20)
+			continue;
+		ticket16(r, limit, field, forced[nforced]);
+		forced[nforced][c] = between(r, limit[k + 1] + 1, limit[k]);
+		bool taken;
+		do {
+			pos[nforced] = below(r, n);
+			taken = false;
+			for (size_t j = 0; j < nforced; j++)
+				taken |= pos[j] == pos[nforced];
+		} while (taken);
+		nforced++;
+	}
+	for (size_t i = 0; i < n; i++) {
+		const int64_t *it = t;
+		for (size_t j = 0; j < nforced; j++) {
+			if (pos[j] == i)
+				it = forced[j];
+		}
+		if (it == t) {
+			ticket16(r, limit, field, t);
+			if (chance(r, .25))
+				t[below(r, 20)] = between(r, limit[0] + 1, 999);
+		}
+		putticket16(it);
+	}
+	free(field);
+	return true;
+}
+
+static bool
+gen17(Rng * const r, const uintmax_t scale)
+{
+	size_t n;
+	if (!scaled(8, scale, SIZE_MAX, &n))
+		return false;
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j < 8; j++)
+			putchar(chance(r, .45)? '#' : '.');
+		putchar('\n');
+	}
+	return true;
+}
+
+static void
+expr18(Rng * const r, const unsigned depth)
+{
+	for (int64_t i = 0, n = between(r, 2, 4); i < n; i++) {
+		if (i > 0)
+			fputs(below(r, 2)? " * " : " + ", stdout);
+		if (depth < 2 && chance(r, .3)) {
+			putchar('(');
+			expr18(r, depth + 1);
+			putchar(')');
+		} else {
+			putchar('1' + (int) below(r, 9));
+		}
+	}
+}
+
+static bool
+gen18(Rng * const r, const uintmax_t scale)
+{
+	size_t n;
+	if (!scaled(370, scale, SIZE_MAX, &n))
+		return false;
+	for (size_t i = 0; i < n; i++) {
+		expr18(r, 0);
+		putchar('\n');
+	}
+	return true;
+}
+
+/* 42 is a(aa|bb) | b(ab|ba) and 31 is b(aa|bb) | a(ab|ba) */
+static void
+chunk19(Rng * const r, const bool is42)
+{
+	const bool first = below(r, 2);
+	putchar(first ^ is42? 'b' : 'a');
+	fputs(first? (below(r, 2)? "aa" : "bb") : (below(r, 2)? "ab" : "ba"),
+	      stdout);
+}
+
+static bool
+gen19(Rng * const r, const uintmax_t scale)
+{
+	static const char *const rule[] = {
+		"0: 8 11", "8: 42", "11: 42 31", "42: 1 5 | 14 9",
+		"31: 14 5 | 1 9", "5: 1 1 | 14 14", "9: 1 14 | 14 1",
+		"1: \"a\"", "14: \"b\""
+	};
+	size_t n;
+	if (!scaled(400, scale, SIZE_MAX, &n))
+		return false;
+	size_t * const order = permutation(r, 9);
+	if (order == NULL)
+		return false;
+	for (size_t i = 0; i < 9; i++)
+		puts(rule[order[i]]);
+	free(order);
+	putchar('\n');
+	for (size_t i = 0; i < n; i++) {
+		const double p = (double) (next(r) >> 11) * 0x1p-53;
+		if (p < .3) {
+			chunk19(r, true);
+			chunk19(r, true);
+			chunk19(r, false);
+		} else if (p < .6) {
+			const int64_t m = between(r, 2, 6);
+			const int64_t k = between(r, 1, m - 1);
+			for (int64_t j = 0; j < m; j++)
+				chunk19(r, true);
+			for (int64_t j = 0; j < k; j++)
+				chunk19(r, false);
+		} else {
+			putrandom(r, "ab", between(r, 6, 30));
+		}
+		putchar('\n');
+	}
+	return true;
+}
+
+typedef struct {
+	size_t side, tile, image;
+	unsigned char *img;
+	uint64_t *hor, *ver;
+} Jigsaw;
+
+/* Pixel (y, x) of tile (ty, tx) before it is flipped and rotated */
+static bool
+pixel20(const Jigsaw * const j,
+        const size_t ty,
+        const size_t tx,
+        const size_t y,
+        const size_t x)
+{
+	const size_t s = j->side, e = j->tile - 1;
+	if (y == 0 || y == e)
+		return j->hor[(ty + (y == e)) * s + tx] >> x & 1;
+	if (x == 0 || x == e)
+		return j->ver[ty * (s + 1) + tx + (x == e)] >> y & 1;
+	return j->img[(ty * (e - 1) + y - 1) * j->image + tx * (e - 1) + x - 1];
+}
+
+static void
+puttile20(Rng * const r, const Jigsaw * const j, const size_t tile)
+{
+	const size_t ty = tile / j->side, tx = tile % j->side, e = j->tile - 1;
+	const bool flip = below(r, 2);
+	const uint64_t rot = below(r, 4);
+	for (size_t y = 0; y <= e; y++) {
+		for (size_t x = 0; x <= e; x++) {
+			size_t sy = y, sx = x;
+			for (uint64_t k = 0; k < rot; k++) {
+				const size_t t = sy;
+				sy = e - sx;
+				sx = t;
+			}
+			if (flip)
+				sx = e - sx;
+			putchar(pixel20(j, ty, tx, sy, sx)? '#' : '.');
+		}
+		putchar('\n');
+	}
+}
+
+static uint64_t
+reverse20(uint64_t v, const size_t bits)
+{
+	uint64_t rev = 0;
+	for (size_t i = 0; i < bits; i++, v >>= 1)
+		rev = rev << 1 | (v & 1);
+	return rev;
+}
+
+/*
+ * Gives every edge a pattern no other edge has either way round, so each
+ * side matches exactly one neighbour as in the puzzle. Corner bits are
+ * shared with the crossing edges and only the middle bits are drawn.
+ */
+static bool
+edges20(Rng * const r, Jigsaw * const j, const unsigned char * const corner)
+{
+	const size_t s = j->side, e = j->tile - 1, n = 2 * s * (s + 1);
+	size_t cap = 1;
+	while (cap < 2 * n)
+		cap *= 2;
+	uint64_t * const seen = calloc(cap, sizeof(uint64_t));
+	if (seen == NULL)
+		return false;
+	for (size_t i = 0; i < n; i++) {
+		const bool vertical = i >= s * (s + 1);
+		const size_t k = vertical? i - s * (s + 1) : i;
+		const size_t y = vertical? k / (s + 1) : k / s;
+		const size_t x = vertical? k % (s + 1) : k % s;
+		const size_t c = y * (s + 1) + x, d = vertical? s + 1 : 1;
+		const uint64_t ends = corner[c] | (uint64_t) corner[c + d] << e;
+		for (;;) {
+			const uint64_t mid = below(r, UINT64_C(1) << (e - 1));
+			const uint64_t v = ends | mid << 1;
+			const uint64_t rev = reverse20(v, e + 1);
+			const uint64_t key = (v < rev? v : rev) + 1;
+			size_t h = key * UINT64_C(0x9e3779b97f4a7c15) >> 32;
+			while (seen[h % cap] != 0 && seen[h % cap] != key)
+				h++;
+			if (seen[h % cap] == key)
+				continue;
+			seen[h % cap] = key;
+			*(vertical? &j->ver[k] : &j->hor[k]) = v;
+			break;
+		}
+	}
+	free(seen);
+	return true;
+}
+
+static void
+freejigsaw(Jigsaw * const j)
+{
+	free(j->img);
+	free(j->hor);
+	free(j->ver);
+}
+
+/*
+ * The first scale keeps the puzzle's 10 pixel tiles; larger jigsaws get
+ * larger tiles so that the edges can stay unique.
+ */
+static bool
+gen20(Rng * const r, const uintmax_t scale)
+{
+	static const char *const monster[3] = {
+		"                  # ",
+		"#    ##    ##    ###",
+		" #  #  #  #  #  #   "
+	};
+	size_t s = 1, tile = 10, area;
+	if (!scaled(144, scale, SIZE_MAX / 2, &area))
+		return false;
+	while (s * s < area)
+		s++;
+	/* Drawing unique edges slows down once 70% of the patterns are used */
+	while ((UINT64_C(7) << (tile - 2)) < 10 * s * (s + 1))
+		tile++;
+	Jigsaw j = { .side = s, .tile = tile, .image = s * (tile - 2) };
+	const size_t n = s * s, nid = n > 750? 4 * n : 3000;
+	const size_t nmonster = j.image * j.image / 368;
+	unsigned char * const corner = malloc((s + 1) * (s + 1));
+	j.img = malloc(j.image * j.image);
+	j.hor = malloc((s + 1) * s * sizeof(uint64_t));
+	j.ver = malloc(s * (s + 1) * sizeof(uint64_t));
+	size_t * const id = permutation(r, nid);
+	size_t * const order = permutation(r, n);
+	if (corner == NULL || j.img == NULL || j.hor == NULL || j.ver == NULL
+	    || id == NULL || order == NULL) {
+		fputs("Could not allocate the jigsaw\n", stderr);
+		free(corner);
+		freejigsaw(&j);
+		free(id);
+		free(order);
+		return false;
+	}
+	for (size_t i = 0; i < j.image * j.image; i++)
+		j.img[i] = chance(r, .35);
+	for (size_t m = 0; m < nmonster; m++) {
+		const size_t y = below(r, j.image - 2);
+		const size_t x = below(r, j.image - 19);
+		for (size_t dy = 0; dy < 3; dy++) {
+			for (size_t dx = 0; dx < 20; dx++) {
+				if (monster[dy][dx] == '#')
+					j.img[(y + dy) * j.image + x + dx] = 1;
+			}
+		}
+	}
+	for (size_t i = 0; i < (s + 1) * (s + 1); i++)
+		corner[i] = below(r, 2);
+	const bool ok = edges20(r, &j, corner);
+	free(corner);
+	for (size_t i = 0; ok && i < n; i++) {
+		if (i > 0)
+			putchar('\n');
+		printf("Tile %zu:\n", 1000 + id[order[i]]);
+		puttile20(r, &j, order[i]);
+	}
+	if (!ok)
+		fputs("Could not allocate the edge table\n", stderr);
+	freejigsaw(&j);
+	free(id);
+	free(order);
+	return ok;
+}
+
+/* Each allergen's ingredient is in every food listing it */
+static bool
+gen21(Rng * const r, const uintmax_t scale)
+{
+	static const char *const allergen[] = {
+		"dairy", "eggs", "fish", "nuts", "peanuts", "sesame",
+		"shellfish", "soy"
+	};
+	char ing[200][9];
+	size_t n, source[8], list[200];
+	if (!scaled(40, scale, SIZE_MAX, &n))
+		return false;
+	for (size_t i = 0; i < 200; i++) {
+		bool seen;
+		do {
+			const size_t len = between(r, 4, 8);
+			for (size_t k = 0; k < len; k++)
+				ing[i][k] = 'a' + below(r, 26);
+			ing[i][len] = 0;
+			seen = false;
+			for (size_t k = 0; k < i; k++)
+				seen |= strcmp(ing[k], ing[i]) == 0;
+		} while (seen);
+	}
+	size_t * const pick = permutation(r, 200);
+	if (pick == NULL)
+		return false;
+	memcpy(source, pick, sizeof(source));
+	free(pick);
+	for (size_t i = 0; i < n; i++) {
+		bool has[200] = { false };
+		size_t ag[8], nag = between(r, 1, 3), nlist = 0;
+		for (size_t k = 0; k < 8; k++)
+			ag[k] = k;
+		for (size_t k = 0; k < nag; k++) {
+			const size_t t = k + below(r, 8 - k), a = ag[t];
+			ag[t] = ag[k];
+			ag[k] = a;
+			has[source[a]] = true;
+		}
+		for (int64_t k = between(r, 30, 60); k > 0; k--)
+			has[below(r, 200)] = true;
+		for (size_t k = 0; k < 200; k++) {
+			if (has[k])
+				list[nlist++] = k;
+		}
+		shuffle(r, list, nlist);
+		for (size_t k = 0; k < nlist; k++)
+			printf("%s ", ing[list[k]]);
+		fputs("(contains ", stdout);
+		for (size_t k = 0; k < nag; k++)
+			printf("%s%s", k > 0? ", " : "", allergen[ag[k]]);
+		puts(")");
+	}
+	return true;
+}
+
+/*
+ * Only fifty cards are low enough to start a sub-game. The others outnumber
+ * the deck and player 1 holds the higher half of them, so every game ends.
+ */
+static bool
+gen22(Rng * const r, const uintmax_t scale)
+{
+	size_t n;
+	if (!scaled(50, scale, SIZE_MAX / 2, &n))
+		return false;
+	size_t * const card = permutation(r, 50);
+	size_t * const deck = malloc(n * sizeof(size_t));
+	if (card == NULL || deck == NULL) {
+		fputs("Could not allocate the decks\n", stderr);
+		free(card);
+		free(deck);
+		return false;
+	}
+	for (size_t i = 0; i < 50; i++)
+		deck[i < 25? i : n / 2 + i - 25] = card[i] + 1;
+	for (size_t i = 0; i < n / 2 - 25; i++) {
+		deck[25 + i] = 2 * n - 50 - i - 1;
+		deck[n / 2 + 25 + i] = n + i;
+	}
+	for (size_t p = 0; p < 2; p++) {
+		shuffle(r, deck + p * n / 2, n / 2);
+		printf("%sPlayer %zu:\n", p > 0? "\n" : "", p + 1);
+		for (size_t i = 0; i < n / 2; i++)
+			printf("%zu\n", deck[p * n / 2 + i]);
+	}
+	free(card);
+	free(deck);
+	return true;
+}
+
+/* The game is always ten million moves over a million cups */
+static bool
+gen23(Rng * const r, const uintmax_t scale)
+{
+	(void) scale;
+	size_t * const cup = permutation(r, 9);
+	if (cup == NULL)
+		return false;
+	for (size_t i = 0; i < 9; i++)
+		putchar('1' + (int) cup[i]);
+	putchar('\n');
+	free(cup);
+	return true;
+}
+
+static bool
+gen24(Rng * const r, const uintmax_t scale)
+{
+	static const char *const dir[] = { "e", "w", "ne", "nw", "se", "sw" };
+	size_t n;
+	if (!scaled(400, scale, SIZE_MAX, &n))
+		return false;
+	for (size_t i = 0; i < n; i++) {
+		for (int64_t k = between(r, 15, 25); k > 0; k--)
+			fputs(dir[below(r, 6)], stdout);
+		putchar('\n');
+	}
+	return true;
+}
+
+static uint64_t
+publickey25(uint64_t loop)
+{
+	uint64_t key = 1, base = 7;
+	for (; loop > 0; loop /= 2) {
+		if (loop % 2)
+			key = key * base % 20201227;
+		base = base * base % 20201227;
+	}
+	return key;
+}
+
+/* Loop sizes are bounded by the modulus, not by the input */
+static bool
+gen25(Rng * const r, const uintmax_t scale)
+{
+	(void) scale;
+	for (size_t i = 0; i < 2; i++)
+		printf("%" PRIu64 "\n",
+		       publickey25(between(r, 1000000, 9000000)));
+	return true;
+}
+
+static Gen *const gen[] = {
+	gen01, gen02, gen03, gen04, gen05, gen06, gen07, gen08, gen09, gen10,
+	gen11, gen12, gen13, gen14, gen15, gen16, gen17, gen18, gen19, gen20,
+	gen21, gen22, gen23, gen24, gen25
+};
+
+static bool
+parsenum(const char * const s, uintmax_t * const x)
+{
+	char *end;
+	errno = 0;
+	*x = strtoumax(s, &end, 10);
+	return errno == 0 && end != s && *end == 0 && *s != '-';
+}
+
+int
+main(int argc, char *argv[])
+{
+	uintmax_t day = 0, scale = 1, seed = 2020;
+	if (argc < 2 || argc > 4 || !parsenum(argv[1], &day) || day < 1
+	    || day > 25 || (argc > 2 && (!parsenum(argv[2], &scale)
+	                                 || scale == 0))
+	    || (argc > 3 && !parsenum(argv[3], &seed))) {
+		fprintf(stderr, "usage: %s day [scale [seed]]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	static char buf[1 << 16];
+	setvbuf(stdout, buf, _IOFBF, sizeof(buf));
+	Rng r = { .state = seed };
+	if (!gen[day - 1](&r, scale))
+		return EXIT_FAILURE;
+	if (fflush(stdout) == EOF || ferror(stdout)) {
+		perror("Could not write the puzzle input");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,314 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "grid.h"
+#include "isa.h"
+
+/* Bits of the last word of a row which hold cells */
+static uint64_t
+lastmask(const Grid * const g)
+{
+	return g->width % 64 == 0? ~UINT64_C(0)
+	       : (UINT64_C(1) << g->width % 64) - 1;
+}
+
+/*
+ * The 64 cells of a row of `n` words from column `x` on, which may be
+ * negative; cells before or past the row are clear
+ */
+static uint64_t
+window(const uint64_t * const row, const size_t n, const ptrdiff_t x)
+{
+	if (x <= -64 || (x >= 0 && (size_t) x / 64 >= n))
+		return 0;
+	if (x < 0)
+		return row[0] << -x;
+	const size_t i = x / 64, b = x % 64;
+	if (b == 0)
+		return row[i];
+	return row[i] >> b | (i + 1 < n? row[i + 1] << (64 - b) : 0);
+}
+
+/* Words of moved cells gridadd hands to carrybits at once */
+#define GRID_CHUNK 256
+
+/* Word `i` of row `r` of `src` once moved as by gridshift */
+static uint64_t
+moved(const Grid * const src,
+      const size_t r,
+      const size_t i,
+      const ptrdiff_t dx,
+      const ptrdiff_t dy)
+{
+	const ptrdiff_t from = (ptrdiff_t) r - dy;
+	if (from < 0 || (size_t) from >= src->height)
+		return 0;
+	return window(gridrow(src, from), src->stride, 64 * (ptrdiff_t) i - dx)
+	       & (i + 1 < src->stride? ~UINT64_C(0) : lastmask(src));
+}
+
+/*
+ * Transposes the 64 by 64 cells of a block in place by swapping its top right
+ * and bottom left quarters, then those of each quarter, and so on
+ */
+static void
+transpose64(uint64_t b[64])
+{
+	uint64_t m = UINT64_C(0x00000000ffffffff);
+	for (unsigned j = 32; j != 0; j >>= 1, m ^= m << j) {
+		for (unsigned k = 0; k < 64; k = (k + j + 1) & ~j) {
+			const uint64_t t = (b[k] >> j ^ b[k + j]) & m;
+			b[k] ^= t << j;
+			b[k + j] ^= t;
+		}
+	}
+}
+
+static uint64_t
+reverse(uint64_t w)
+{
+	w = (w >> 1 & UINT64_C(0x5555555555555555))
+	    | (w & UINT64_C(0x5555555555555555)) << 1;
+	w = (w >> 2 & UINT64_C(0x3333333333333333))
+	    | (w & UINT64_C(0x3333333333333333)) << 2;
+	w = (w >> 4 & UINT64_C(0x0f0f0f0f0f0f0f0f))
+	    | (w & UINT64_C(0x0f0f0f0f0f0f0f0f)) << 4;
+	w = (w >> 8 & UINT64_C(0x00ff00ff00ff00ff))
+	    | (w & UINT64_C(0x00ff00ff00ff00ff)) << 8;
+	w = (w >> 16 & UINT64_C(0x0000ffff0000ffff))
+	    | (w & UINT64_C(0x0000ffff0000ffff)) << 16;
+	return w >> 32 | w << 32;
+}
+
+size_t
+gridwords(const size_t width, const size_t height)
+{
+	const size_t stride = width / 64 + (width % 64 != 0);
+	if (stride > 0 && height > SIZE_MAX / sizeof(uint64_t) / stride)
+		return 0;
+	return stride * height;
+}
+
+void
+gridinit(Grid * const g,
+         uint64_t * const w,
+         const size_t width,
+         const size_t height)
+{
+	*g = (Grid) {
+		.w = w,
+		.width = width,
+		.height = height,
+		.stride = width / 64 + (width % 64 != 0)
+	};
+	gridclear(g);
+}
+
+void
+gridclear(Grid * const g)
+{
+	memset(g->w, 0, g->stride * g->height * sizeof(uint64_t));
+}
+
+void
+gridcopy(Grid * const dst, const Grid * const src)
+{
+	memmove(dst->w, src->w, src->stride * src->height * sizeof(uint64_t));
+}
+
+bool
+gridsame(const Grid * const a, const Grid * const b)
+{
+	return memcmp(a->w, b->w, a->stride * a->height * sizeof(uint64_t))
+	       == 0;
+}
+
+uintmax_t
+gridpopcount(const Grid * const g)
+{
+	return countbits(g->w, g->stride * g->height, ~UINT64_C(0));
+}
+
+void
+gridand(Grid * const dst, const Grid * const a, const Grid * const b)
+{
+	for (size_t i = 0; i < a->stride * a->height; i++)
+		dst->w[i] = a->w[i] & b->w[i];
+}
+
+void
+gridandnot(Grid * const dst, const Grid * const a, const Grid * const b)
+{
+	for (size_t i = 0; i < a->stride * a->height; i++)
+		dst->w[i] = a->w[i] & ~b->w[i];
+}
+
+void
+gridor(Grid * const dst, const Grid * const a, const Grid * const b)
+{
+	for (size_t i = 0; i < a->stride * a->height; i++)
+		dst->w[i] = a->w[i] | b->w[i];
+}
+
+void
+gridxor(Grid * const dst, const Grid * const a, const Grid * const b)
+{
+	for (size_t i = 0; i < a->stride * a->height; i++)
+		dst->w[i] = a->w[i] ^ b->w[i];
+}
+
+void
+gridshift(Grid * const restrict dst,
+          const Grid * const restrict src,
+          const ptrdiff_t dx,
+          const ptrdiff_t dy)
+{
+	gridclear(dst);
+	gridput(dst, src, dx, dy);
+}
+
+void
+gridput(Grid * const restrict dst,
+        const Grid * const restrict src,
+        const ptrdiff_t x,
+        const ptrdiff_t y)
+{
+	const uint64_t last = lastmask(dst);
+	for (size_t r = 0; r < dst->height; r++) {
+		const ptrdiff_t from = (ptrdiff_t) r - y;
+		if (from < 0 || (size_t) from >= src->height)
+			continue;
+		const uint64_t * const in = gridrow(src, from);
+		uint64_t * const out = gridrow(dst, r);
+		for (size_t i = 0; i < dst->stride; i++) {
+			const ptrdiff_t col = 64 * (ptrdiff_t) i - x;
+			out[i] |= window(in, src->stride, col)
+			          & (i + 1 < dst->stride? ~UINT64_C(0) : last);
+		}
+	}
+}
+
+/*
+ * Counters are word arrays of the same layout, so the kernels of isa.h add
+ * and compare them whole, rows and all
+ */
+void
+gridadd(Grid count[],
+        const size_t planes,
+        const Grid * const src,
+        const ptrdiff_t dx,
+        const ptrdiff_t dy)
+{
+	const size_t n = src->stride * src->height;
+	uint64_t buf[GRID_CHUNK], *at[planes > 0? planes : 1];
+	size_t r = 0, i = 0;
+	for (size_t k = 0; k < n; k += GRID_CHUNK) {
+		const size_t m = n - k < GRID_CHUNK? n - k : GRID_CHUNK;
+		for (size_t j = 0; j < m; j++) {
+			buf[j] = moved(src, r, i, dx, dy);
+			if (++i == src->stride) {
+				i = 0;
+				r++;
+			}
+		}
+		for (size_t p = 0; p < planes; p++)
+			at[p] = count[p].w + k;
+		carrybits(at, planes, buf, m);
+	}
+}
+
+void
+gridsum(Grid count[],
+        const size_t planes,
+        const Grid add[],
+        const size_t addplanes)
+{
+	uint64_t *to[planes > 0? planes : 1];
+	const uint64_t *from[addplanes > 0? addplanes : 1];
+	for (size_t p = 0; p < planes; p++)
+		to[p] = count[p].w;
+	for (size_t p = 0; p < addplanes; p++)
+		from[p] = add[p].w;
+	sumbits(to, planes, from, addplanes, add[0].stride * add[0].height);
+}
+
+/* Counts of the bits past the width are 0, which `lo` may let through */
+void
+gridrange(Grid * const dst,
+          const Grid count[],
+          const size_t planes,
+          const unsigned lo,
+          const unsigned hi)
+{
+	const uint64_t *at[planes > 0? planes : 1];
+	for (size_t p = 0; p < planes; p++)
+		at[p] = count[p].w;
+	rangebits(dst->w, at, planes, lo, hi, dst->stride * dst->height);
+	if (lo == 0 && dst->stride > 0) {
+		const uint64_t last = lastmask(dst);
+		for (size_t r = 0; r < dst->height; r++)
+			gridrow(dst, r)[dst->stride - 1] &= last;
+	}
+}
+
+/*
+ * Blocks of 64 rows and 64 columns of `src` are gathered, transposed and
+ * scattered to the columns and rows of `dst` they swap with
+ */
+void
+gridtranspose(Grid * const restrict dst, const Grid * const restrict src)
+{
+	uint64_t b[64];
+	for (size_t by = 0; by < src->height; by += 64) {
+		for (size_t bx = 0; bx < src->stride; bx++) {
+			for (size_t r = 0; r < 64; r++)
+				b[r] = by + r < src->height
+				       ? gridrow(src, by + r)[bx] : 0;
+			transpose64(b);
+			for (size_t c = 0; c < 64 && 64 * bx + c < dst->height;
+			     c++)
+				gridrow(dst, 64 * bx + c)[by / 64] = b[c];
+		}
+	}
+}
+
+/* Rows are reversed word by word, then moved back by the bits past the width */
+void
+gridflip(Grid * const dst, const Grid * const src)
+{
+	const size_t n = src->stride, pad = 64 * n - src->width;
+	uint64_t rev[n > 0? n : 1];
+	for (size_t r = 0; r < src->height; r++) {
+		const uint64_t * const in = gridrow(src, r);
+		uint64_t * const out = gridrow(dst, r);
+		for (size_t i = 0; i < n; i++)
+			rev[i] = reverse(in[n - 1 - i]);
+		for (size_t i = 0; i < n; i++)
+			out[i] = window(rev, n, 64 * i + pad);
+	}
+}
+
+/* A transposed grid turned a quarter counterclockwise has its rows reversed */
+void
+gridrotate(Grid * const restrict dst, const Grid * const restrict src)
+{
+	gridtranspose(dst, src);
+	for (size_t r = 0; 2 * r + 1 < dst->height; r++) {
+		uint64_t * const a = gridrow(dst, r);
+		uint64_t * const b = gridrow(dst, dst->height - 1 - r);
+		for (size_t i = 0; i < dst->stride; i++) {
+			const uint64_t t = a[i];
+			a[i] = b[i];
+			b[i] = t;
+		}
+	}
+}
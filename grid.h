@@ -0,0 +1,105 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/* Requires <stdbool.h>, <stddef.h> and <stdint.h> */
+
+/*
+ * Cells of a rectangle, one bit each, `width` to a row. Each row starts on a
+ * word of its own and takes `stride` words, row after row, with cell x of a
+ * row in bit x % 64 of word x / 64. Bits past the width are always clear, so
+ * whole words can be compared and counted.
+ *
+ * Functions taking several grids work word by word and want them of the same
+ * width and height, unless they say otherwise. The one written to may be one
+ * of those read, except for gridshift, gridput, gridtranspose and gridrotate,
+ * and the counters of gridadd and gridsum.
+ */
+typedef struct {
+	uint64_t *w;
+	size_t width, height, stride;
+} Grid;
+
+/* Words a grid of `width` by `height` cells takes, or 0 if that is too many */
+size_t gridwords(size_t width, size_t height);
+
+/* Lays a grid of clear cells over the gridwords(width, height) words at `w` */
+void gridinit(Grid *, uint64_t *w, size_t width, size_t height);
+
+static inline uint64_t *
+gridrow(const Grid * const g, const size_t y)
+{
+	return g->w + y * g->stride;
+}
+
+static inline bool
+gridget(const Grid * const g, const size_t x, const size_t y)
+{
+	return gridrow(g, y)[x / 64] >> x % 64 & 1;
+}
+
+static inline void
+gridset(Grid * const g, const size_t x, const size_t y, const bool on)
+{
+	uint64_t * const w = gridrow(g, y) + x / 64;
+	*w = (*w & ~(UINT64_C(1) << x % 64)) | (uint64_t) on << x % 64;
+}
+
+void gridclear(Grid *);
+void gridcopy(Grid *dst, const Grid *src);
+bool gridsame(const Grid *, const Grid *);
+uintmax_t gridpopcount(const Grid *);
+
+void gridand(Grid *dst, const Grid *a, const Grid *b);
+void gridandnot(Grid *dst, const Grid *a, const Grid *b);
+void gridor(Grid *dst, const Grid *a, const Grid *b);
+void gridxor(Grid *dst, const Grid *a, const Grid *b);
+
+/*
+ * Moves the cells of `src` `dx` columns right and `dy` rows down into `dst`;
+ * cells moved out are lost and those moved in are clear
+ */
+void gridshift(Grid *dst, const Grid *src, ptrdiff_t dx, ptrdiff_t dy);
+
+/*
+ * Sets the cells of `dst` which are set in `src` once its top left corner is
+ * put at column `x` and row `y` of `dst`, which may be of any size
+ */
+void gridput(Grid *dst, const Grid *src, ptrdiff_t x, ptrdiff_t y);
+
+/*
+ * Counters of cells are `planes` grids, the first holding bit 0 of each count,
+ * the next bit 1 and so on. gridadd adds 1 to the counters of the cells set in
+ * `src` once it is moved as by gridshift, and gridsum adds the counters `add`
+ * of `addplanes` grids. Counts which outgrow the planes wrap around. The
+ * neighbors of cells are counted by adding a grid moved once toward each.
+ */
+void gridadd(Grid count[],
+             size_t planes,
+             const Grid *src,
+             ptrdiff_t dx,
+             ptrdiff_t dy);
+void gridsum(Grid count[],
+             size_t planes,
+             const Grid add[],
+             size_t addplanes);
+
+/* Sets the cells of `dst` whose count is between `lo` and `hi` */
+void gridrange(Grid *dst,
+               const Grid count[],
+               size_t planes,
+               unsigned lo,
+               unsigned hi);
+
+/*
+ * gridtranspose swaps rows and columns, gridflip mirrors the columns and
+ * gridrotate turns a quarter counterclockwise: `dst` of gridtranspose and
+ * gridrotate must be as wide as `src` is high and as high as it is wide
+ */
+void gridtranspose(Grid *dst, const Grid *src);
+void gridflip(Grid *dst, const Grid *src);
+void gridrotate(Grid *dst, const Grid *src);
@@ -0,0 +1,95 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "advent.h"
+
+static bool
+mapfile(const int fd, const size_t len, AdventInput * const in)
+{
+	void * const buf = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (buf == MAP_FAILED)
+		return false;
+	posix_madvise(buf, len, POSIX_MADV_SEQUENTIAL);
+	in->buf = buf;
+	in->len = len;
+	in->mapped = true;
+	return true;
+}
+
+static int
+readall(const int fd, AdventInput * const in)
+{
+	size_t cap = BUFSIZ, len = 0;
+	char *buf = malloc(cap);
+	if (buf == NULL) {
+		perror("Could not allocate input buffer");
+		return EXIT_FAILURE;
+	}
+	for (;;) {
+		if (len == cap) {
+			char * const new = cap < SIZE_MAX / 2?
+			                   realloc(buf, 2 * cap) : NULL;
+			if (new == NULL) {
+				perror("Could not grow input buffer");
+				free(buf);
+				return EXIT_FAILURE;
+			}
+			buf = new;
+			cap *= 2;
+		}
+		const ssize_t n = read(fd, buf + len, cap - len);
+		if (n == 0)
+			break;
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0) {
+			perror("Could not read puzzle input");
+			free(buf);
+			return EXIT_FAILURE;
+		}
+		len += n;
+	}
+	in->buf = buf;
+	in->len = len;
+	in->mapped = false;
+	return EXIT_SUCCESS;
+}
+
+int
+advent_load(const int fd, AdventInput * const in)
+{
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0
+	    && (uintmax_t) st.st_size <= SIZE_MAX
+	    && mapfile(fd, st.st_size, in))
+		return EXIT_SUCCESS;
+	/* Pipes, terminals, empty files and files that could not be mapped */
+	return readall(fd, in);
+}
+
+void
+advent_unload(AdventInput * const in)
+{
+	if (in->mapped)
+		munmap((void *) in->buf, in->len);
+	else
+		free((void *) in->buf);
+	in->buf = NULL;
+	in->len = 0;
+}
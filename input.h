@@ -0,0 +1,243 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/* Requires <stdbool.h>, <stdint.h>, <stdio.h> and <string.h> */
+
+/*
+ * Puzzle input as a span of bytes and a cursor moving through it. The bytes
+ * are not NUL-terminated and stay valid until the day returns, so tokens point
+ * into them instead of being copied.
+ */
+typedef struct {
+	const char *p, *end;
+} Input;
+
+typedef struct {
+	const char *s;
+	size_t len;
+} Span;
+
+static inline bool
+ineof(const Input * const in)
+{
+	return in->p == in->end;
+}
+
+/* Next byte as an unsigned char, or EOF, like getc */
+static inline int
+inpeek(const Input * const in)
+{
+	return in->p < in->end? (unsigned char) *in->p : EOF;
+}
+
+static inline int
+inget(Input * const in)
+{
+	return in->p < in->end? (unsigned char) *in->p++ : EOF;
+}
+
+/* Consumes `c` if it comes next */
+static inline bool
+inchar(Input * const in, const char c)
+{
+	if (in->p == in->end || *in->p != c)
+		return false;
+	in->p++;
+	return true;
+}
+
+/* Consumes the string `s` if it comes next */
+static inline bool
+inlit(Input * const restrict in, const char * restrict s)
+{
+	const char *p = in->p;
+	for (; *s != 0; s++, p++) {
+		if (p == in->end || *p != *s)
+			return false;
+	}
+	in->p = p;
+	return true;
+}
+
+/* Skips whitespace like a space in a scanf format, and counts newlines */
+static inline size_t
+inspace(Input * const in)
+{
+	size_t lines = 0;
+	for (; in->p < in->end; in->p++) {
+		const char c = *in->p;
+		if (c == '\n')
+			lines++;
+		else if (c != ' ' && c != '\t' && c != '\r' && c != '\v'
+		         && c != '\f')
+			break;
+	}
+	return lines;
+}
+
+/*
+ * Where the byte order is known, numbers are scanned 8 digits at a time: a
+ * word of input is loaded, its leading digits are counted with bit tricks and
+ * converted with three multiplications.
+ */
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) \
+    && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define INPUT_SWAR
+#endif
+
+#ifdef INPUT_SWAR
+/* Number of leading decimal digits in the 8 bytes of `chunk` */
+static inline unsigned
+swardigits(const uint64_t chunk)
+{
+	const uint64_t high = UINT64_C(0xf0f0f0f0f0f0f0f0);
+	const uint64_t bad = ((chunk & high)
+	                      | (((chunk + UINT64_C(0x0606060606060606)) & high)
+	                         >> 4))
+	                     ^ UINT64_C(0x3333333333333333);
+	return bad == 0? 8 : (unsigned) __builtin_ctzll(bad) / 8;
+}
+
+/* Value of the first `n` digits of `chunk`, with `n` between 1 and 8 */
+static inline uint64_t
+swarvalue(uint64_t chunk, const unsigned n)
+{
+	chunk = (chunk - UINT64_C(0x3030303030303030)) << (8 * (8 - n));
+	chunk = (chunk * 10 + (chunk >> 8)) & UINT64_C(0x00ff00ff00ff00ff);
+	chunk = (chunk * 100 + (chunk >> 16)) & UINT64_C(0x0000ffff0000ffff);
+	return (chunk * 10000 + (chunk >> 32)) & UINT64_C(0x00000000ffffffff);
+}
+#endif
+
+/* Reads a decimal number; fails without consuming if it is empty or too big */
+static inline bool
+inuint(Input * const restrict in, uintmax_t * const restrict x)
+{
+	const char *p = in->p;
+	uintmax_t acc = 0;
+#ifdef INPUT_SWAR
+	static const uint32_t pow10[9] = {
+		1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000
+	};
+	while (in->end - p >= 8) {
+		uint64_t chunk;
+		memcpy(&chunk, p, 8);
+		const unsigned n = swardigits(chunk);
+		if (n == 0)
+			break;
+		const uint64_t val = swarvalue(chunk, n);
+		if (acc > (UINTMAX_MAX - val) / pow10[n])
+			return false;
+		acc = acc * pow10[n] + val;
+		p += n;
+		if (n < 8)
+			break;
+	}
+#endif
+	for (; p < in->end && (unsigned char) (*p - '0') < 10; p++) {
+		const unsigned digit = *p - '0';
+		if (acc > (UINTMAX_MAX - digit) / 10)
+			return false;
+		acc = 10 * acc + digit;
+	}
+	if (p == in->p)
+		return false;
+	in->p = p;
+	*x = acc;
+	return true;
+}
+
+/* Same as inuint with an optional sign */
+static inline bool
+inint(Input * const restrict in, intmax_t * const restrict x)
+{
+	const char * const begin = in->p;
+	const bool neg = inchar(in, '-');
+	uintmax_t u;
+	if (!neg)
+		inchar(in, '+');
+	if (!inuint(in, &u) || u > (uintmax_t) INTMAX_MAX + neg) {
+		in->p = begin;
+		return false;
+	}
+	*x = !neg? (intmax_t) u : u == 0? 0 : -(intmax_t) (u - 1) - 1;
+	return true;
+}
+
+/*
+ * Reads a list of up to `n` numbers separated by `sep`, such as `1,2,3`, and
+ * returns how many were read. A separator which is not followed by a number is
+ * left unread.
+ */
+static inline size_t
+inuints(Input * const restrict in,
+        const char sep,
+        uintmax_t * const restrict vals,
+        const size_t n)
+{
+	if (n == 0 || !inuint(in, vals))
+		return 0;
+	size_t i = 1;
+	for (; i < n && inchar(in, sep); i++) {
+		if (!inuint(in, vals + i)) {
+			in->p--;
+			break;
+		}
+	}
+	return i;
+}
+
+/* Reads up to `delim` or the end of input, leaving `delim` unread */
+static inline Span
+inuntil(Input * const in, const char delim)
+{
+	const Span s = { .s = in->p, .len = in->end - in->p };
+	const char * const found = memchr(s.s, delim, s.len);
+	if (found == NULL) {
+		in->p = in->end;
+		return s;
+	}
+	in->p = found;
+	return (Span) { .s = s.s, .len = found - s.s };
+}
+
+/* Reads a possibly empty run of lowercase letters */
+static inline Span
+inlower(Input * const in)
+{
+	const char * const begin = in->p;
+	while (in->p < in->end && 'a' <= *in->p && *in->p <= 'z')
+		in->p++;
+	return (Span) { .s = begin, .len = in->p - begin };
+}
+
+/* Ends a line: consumes a newline, or succeeds at the end of input */
+static inline bool
+ineol(Input * const in)
+{
+	return inchar(in, '\n') || ineof(in);
+}
+
+static inline bool
+spaneq(const Span a, const Span b)
+{
+	return a.len == b.len && memcmp(a.s, b.s, a.len) == 0;
+}
+
+/* Compares like strcmp, a prefix being less than the longer span */
+static inline int
+spancmp(const Span a, const Span b)
+{
+	const int cmp = memcmp(a.s, b.s, a.len < b.len? a.len : b.len);
+	if (cmp != 0 || a.len == b.len)
+		return cmp;
+	return a.len < b.len? -1 : 1;
+}
+
+/* Span of a string literal */
+#define SPAN(lit) ((Span) { .s = lit, .len = sizeof(lit) - 1 })
@@ -0,0 +1,682 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "advent.h"
+#include "isa.h"
+
+/*
+ * Variants beyond the portable one are built with the target attribute of
+ * GCC and Clang, so that the rest of the program still runs on any x86-64
+ * processor, which all have SSE2
+ */
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define ISA_X86
+#define AVX2 __attribute__((target("avx2")))
+#define AVX512 __attribute__((target("avx512f,avx512bw,popcnt")))
+#endif
+
+typedef struct {
+	uintmax_t (*countbits)(const uint64_t *, size_t, uint64_t);
+	void (*carrybits)(uint64_t *const [],
+	                  size_t,
+	                  const uint64_t *,
+	                  size_t,
+	                  size_t);
+	void (*sumbits)(uint64_t *const [],
+	                size_t,
+	                const uint64_t *const [],
+	                size_t,
+	                size_t,
+	                size_t);
+	void (*rangebits)(uint64_t *,
+	                  const uint64_t *const [],
+	                  size_t,
+	                  unsigned,
+	                  unsigned,
+	                  size_t,
+	                  size_t);
+} Kernels;
+
+static const char *const isaname[NISAS] = {
+	[ISA_GENERIC] = "generic",
+	[ISA_SSE2] = "sse2",
+	[ISA_AVX2] = "avx2",
+	[ISA_AVX512] = "avx512"
+};
+
+static uintmax_t
+countbitsgeneric(const uint64_t * const w,
+                 const size_t n,
+                 const uint64_t mask)
+{
+	uintmax_t count = 0;
+	for (size_t i = 0; i < n; i++) {
+		uint64_t x = w[i] & mask;
+		x -= (x >> 1) & UINT64_C(0x5555555555555555);
+		x = (x & UINT64_C(0x3333333333333333))
+		    + ((x >> 2) & UINT64_C(0x3333333333333333));
+		x = (x + (x >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+		count += (x * UINT64_C(0x0101010101010101)) >> 56;
+	}
+	return count;
+}
+
+/* Bit p of a count, which is clear past the width of unsigned */
+static bool
+countbit(const unsigned n, const size_t p)
+{
+	return p < sizeof(n) * CHAR_BIT && n >> p & 1;
+}
+
+/*
+ * The counter kernels take the first of the `n` words to work on, so that
+ * wider variants can leave the last few to the portable ones
+ */
+static void
+carrybitsgeneric(uint64_t * const plane[],
+                 const size_t planes,
+                 const uint64_t * const add,
+                 size_t i,
+                 const size_t n)
+{
+	for (; i < n; i++) {
+		uint64_t a = add[i];
+		for (size_t p = 0; p < planes && a != 0; p++) {
+			const uint64_t c = plane[p][i];
+			plane[p][i] = c ^ a;
+			a &= c;
+		}
+	}
+}
+
+static void
+sumbitsgeneric(uint64_t * const plane[],
+               const size_t planes,
+               const uint64_t * const add[],
+               const size_t addplanes,
+               size_t i,
+               const size_t n)
+{
+	for (; i < n; i++) {
+		uint64_t c = 0;
+		for (size_t p = 0; p < planes && (p < addplanes || c != 0);
+		     p++) {
+			const uint64_t a = p < addplanes? add[p][i] : 0;
+			const uint64_t x = plane[p][i];
+			plane[p][i] = x ^ a ^ c;
+			c = (x & a) | (c & (x ^ a));
+		}
+	}
+}
+
+/* Bits of word `i` whose count is below `n`, compared from the top plane */
+static uint64_t
+belowgeneric(const uint64_t * const plane[],
+             const size_t planes,
+             const size_t i,
+             const unsigned n)
+{
+	uint64_t lt = 0, eq = ~UINT64_C(0);
+	for (size_t p = planes; p-- > 0;) {
+		const uint64_t c = plane[p][i];
+		if (countbit(n, p)) {
+			lt |= eq & ~c;
+			eq &= c;
+		} else {
+			eq &= ~c;
+		}
+	}
+	return lt;
+}
+
+/* Counts up to UINT_MAX are all below `hi` + 1 */
+static void
+rangebitsgeneric(uint64_t * const dst,
+                 const uint64_t * const plane[],
+                 const size_t planes,
+                 const unsigned lo,
+                 const unsigned hi,
+                 size_t i,
+                 const size_t n)
+{
+	for (; i < n; i++) {
+		const uint64_t upto = hi == UINT_MAX? ~UINT64_C(0)
+		                      : belowgeneric(plane, planes, i, hi + 1);
+		dst[i] = ~belowgeneric(plane, planes, i, lo) & upto;
+	}
+}
+
+#ifdef ISA_X86
+/* Counts bits of each byte with the same steps as the portable variant */
+static uintmax_t
+countbitssse2(const uint64_t * const w, const size_t n, const uint64_t mask)
+{
+	const __m128i m = _mm_set1_epi64x(mask), zero = _mm_setzero_si128();
+	const __m128i m1 = _mm_set1_epi8(0x55), m2 = _mm_set1_epi8(0x33);
+	const __m128i m4 = _mm_set1_epi8(0x0f);
+	__m128i sum = zero;
+	size_t i = 0;
+	for (; n - i >= 2; i += 2) {
+		const __m128i word = _mm_loadu_si128((const void *) (w + i));
+		__m128i x = _mm_and_si128(word, m);
+		x = _mm_sub_epi8(x, _mm_and_si128(_mm_srli_epi64(x, 1), m1));
+		x = _mm_add_epi8(_mm_and_si128(x, m2),
+		                 _mm_and_si128(_mm_srli_epi64(x, 2), m2));
+		x = _mm_and_si128(_mm_add_epi8(x, _mm_srli_epi64(x, 4)), m4);
+		sum = _mm_add_epi64(sum, _mm_sad_epu8(x, zero));
+	}
+	return _mm_cvtsi128_si64(sum)
+	       + _mm_cvtsi128_si64(_mm_unpackhi_epi64(sum, sum))
+	       + countbitsgeneric(w + i, n - i, mask);
+}
+
+static bool
+zerosse2(const __m128i v)
+{
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()))
+	       == 0xffff;
+}
+
+static void
+carrybitssse2(uint64_t * const plane[],
+              const size_t planes,
+              const uint64_t * const add,
+              size_t i,
+              const size_t n)
+{
+	for (; n - i >= 2; i += 2) {
+		__m128i a = _mm_loadu_si128((const void *) (add + i));
+		for (size_t p = 0; p < planes && !zerosse2(a); p++) {
+			const __m128i c =
+				_mm_loadu_si128((const void *) (plane[p] + i));
+			_mm_storeu_si128((void *) (plane[p] + i),
+			                 _mm_xor_si128(c, a));
+			a = _mm_and_si128(a, c);
+		}
+	}
+	carrybitsgeneric(plane, planes, add, i, n);
+}
+
+static void
+sumbitssse2(uint64_t * const plane[],
+            const size_t planes,
+            const uint64_t * const add[],
+            const size_t addplanes,
+            size_t i,
+            const size_t n)
+{
+	for (; n - i >= 2; i += 2) {
+		__m128i c = _mm_setzero_si128();
+		for (size_t p = 0;
+		     p < planes && (p < addplanes || !zerosse2(c));
+		     p++) {
+			const __m128i a = p < addplanes
+			                  ? _mm_loadu_si128((const void *)
+			                                    (add[p] + i))
+			                  : _mm_setzero_si128();
+			const __m128i x =
+				_mm_loadu_si128((const void *) (plane[p] + i));
+			const __m128i ax = _mm_xor_si128(x, a);
+			_mm_storeu_si128((void *) (plane[p] + i),
+			                 _mm_xor_si128(ax, c));
+			c = _mm_or_si128(_mm_and_si128(x, a),
+			                 _mm_and_si128(c, ax));
+		}
+	}
+	sumbitsgeneric(plane, planes, add, addplanes, i, n);
+}
+
+static __m128i
+belowsse2(const uint64_t * const plane[],
+          const size_t planes,
+          const size_t i,
+          const unsigned n)
+{
+	__m128i lt = _mm_setzero_si128(), eq = _mm_set1_epi32(-1);
+	for (size_t p = planes; p-- > 0;) {
+		const __m128i c =
+			_mm_loadu_si128((const void *) (plane[p] + i));
+		if (countbit(n, p)) {
+			lt = _mm_or_si128(lt, _mm_andnot_si128(c, eq));
+			eq = _mm_and_si128(eq, c);
+		} else {
+			eq = _mm_andnot_si128(c, eq);
+		}
+	}
+	return lt;
+}
+
+static void
+rangebitssse2(uint64_t * const dst,
+              const uint64_t * const plane[],
+              const size_t planes,
+              const unsigned lo,
+              const unsigned hi,
+              size_t i,
+              const size_t n)
+{
+	for (; n - i >= 2; i += 2) {
+		const __m128i upto = hi == UINT_MAX? _mm_set1_epi32(-1)
+		                     : belowsse2(plane, planes, i, hi + 1);
+		_mm_storeu_si128((void *) (dst + i),
+		                 _mm_andnot_si128(belowsse2(plane,
+		                                            planes,
+		                                            i,
+		                                            lo),
+		                                  upto));
+	}
+	rangebitsgeneric(dst, plane, planes, lo, hi, i, n);
+}
+
+AVX2 static uintmax_t
+sumwordsavx2(const __m256i v)
+{
+	uint64_t lane[4];
+	_mm256_storeu_si256((void *) lane, v);
+	return lane[0] + lane[1] + lane[2] + lane[3];
+}
+
+/* Looks the bits of each half byte up in a table of 16 bytes */
+AVX2 static uintmax_t
+countbitsavx2(const uint64_t * const w, const size_t n, const uint64_t mask)
+{
+	const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+	                                       1, 2, 2, 3, 2, 3, 3, 4,
+	                                       0, 1, 1, 2, 1, 2, 2, 3,
+	                                       1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i m = _mm256_set1_epi64x(mask);
+	const __m256i low = _mm256_set1_epi8(0x0f);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i sum = zero;
+	size_t i = 0;
+	for (; n - i >= 4; i += 4) {
+		const __m256i x =
+			_mm256_and_si256(_mm256_loadu_si256((const void *)
+			                                    (w + i)),
+			                 m);
+		const __m256i lo = _mm256_and_si256(x, low);
+		const __m256i hi = _mm256_and_si256(_mm256_srli_epi64(x, 4),
+		                                    low);
+		const __m256i bits =
+			_mm256_add_epi8(_mm256_shuffle_epi8(table, lo),
+			                _mm256_shuffle_epi8(table, hi));
+		sum = _mm256_add_epi64(sum, _mm256_sad_epu8(bits, zero));
+	}
+	return sumwordsavx2(sum) + countbitsgeneric(w + i, n - i, mask);
+}
+
+AVX2 static void
+carrybitsavx2(uint64_t * const plane[],
+              const size_t planes,
+              const uint64_t * const add,
+              size_t i,
+              const size_t n)
+{
+	for (; n - i >= 4; i += 4) {
+		__m256i a = _mm256_loadu_si256((const void *) (add + i));
+		for (size_t p = 0; p < planes && !_mm256_testz_si256(a, a);
+		     p++) {
+			const __m256i c =
+				_mm256_loadu_si256((const void *)
+				                   (plane[p] + i));
+			_mm256_storeu_si256((void *) (plane[p] + i),
+			                    _mm256_xor_si256(c, a));
+			a = _mm256_and_si256(a, c);
+		}
+	}
+	carrybitsgeneric(plane, planes, add, i, n);
+}
+
+AVX2 static void
+sumbitsavx2(uint64_t * const plane[],
+            const size_t planes,
+            const uint64_t * const add[],
+            const size_t addplanes,
+            size_t i,
+            const size_t n)
+{
+	for (; n - i >= 4; i += 4) {
+		__m256i c = _mm256_setzero_si256();
+		for (size_t p = 0;
+		     p < planes && (p < addplanes || !_mm256_testz_si256(c, c));
+		     p++) {
+			const __m256i a = p < addplanes
+			                  ? _mm256_loadu_si256((const void *)
+			                                       (add[p] + i))
+			                  : _mm256_setzero_si256();
+			const __m256i x =
+				_mm256_loadu_si256((const void *)
+				                   (plane[p] + i));
+			const __m256i ax = _mm256_xor_si256(x, a);
+			_mm256_storeu_si256((void *) (plane[p] + i),
+			                    _mm256_xor_si256(ax, c));
+			c = _mm256_or_si256(_mm256_and_si256(x, a),
+			                    _mm256_and_si256(c, ax));
+		}
+	}
+	sumbitsgeneric(plane, planes, add, addplanes, i, n);
+}
+
+AVX2 static __m256i
+belowavx2(const uint64_t * const plane[],
+          const size_t planes,
+          const size_t i,
+          const unsigned n)
+{
+	__m256i lt = _mm256_setzero_si256(), eq = _mm256_set1_epi32(-1);
+	for (size_t p = planes; p-- > 0;) {
+		const __m256i c =
+			_mm256_loadu_si256((const void *) (plane[p] + i));
+		if (countbit(n, p)) {
+			lt = _mm256_or_si256(lt, _mm256_andnot_si256(c, eq));
+			eq = _mm256_and_si256(eq, c);
+		} else {
+			eq = _mm256_andnot_si256(c, eq);
+		}
+	}
+	return lt;
+}
+
+AVX2 static void
+rangebitsavx2(uint64_t * const dst,
+              const uint64_t * const plane[],
+              const size_t planes,
+              const unsigned lo,
+              const unsigned hi,
+              size_t i,
+              const size_t n)
+{
+	for (; n - i >= 4; i += 4) {
+		const __m256i upto = hi == UINT_MAX? _mm256_set1_epi32(-1)
+		                     : belowavx2(plane, planes, i, hi + 1);
+		_mm256_storeu_si256((void *) (dst + i),
+		                    _mm256_andnot_si256(belowavx2(plane,
+		                                                  planes,
+		                                                  i,
+		                                                  lo),
+		                                        upto));
+	}
+	rangebitsgeneric(dst, plane, planes, lo, hi, i, n);
+}
+
+AVX512 static uintmax_t
+countbitsavx512(const uint64_t * const w,
+                const size_t n,
+                const uint64_t mask)
+{
+	const __m512i table = _mm512_set4_epi32(0x04030302, 0x03020201,
+	                                        0x03020201, 0x02010100);
+	const __m512i m = _mm512_set1_epi64(mask);
+	const __m512i low = _mm512_set1_epi8(0x0f);
+	const __m512i zero = _mm512_setzero_si512();
+	__m512i sum = zero;
+	for (size_t i = 0; i < n; i += 8) {
+		const __mmask8 k = n - i >= 8? 0xff : (1u << (n - i)) - 1;
+		const __m512i x =
+			_mm512_and_si512(_mm512_maskz_loadu_epi64(k, w + i), m);
+		const __m512i lo = _mm512_and_si512(x, low);
+		const __m512i hi = _mm512_and_si512(_mm512_srli_epi64(x, 4),
+		                                    low);
+		const __m512i bits =
+			_mm512_add_epi8(_mm512_shuffle_epi8(table, lo),
+			                _mm512_shuffle_epi8(table, hi));
+		sum = _mm512_add_epi64(sum, _mm512_sad_epu8(bits, zero));
+	}
+	return _mm512_reduce_add_epi64(sum);
+}
+
+/* Tails are handled with masked loads and stores rather than word by word */
+AVX512 static __mmask8
+tailavx512(const size_t left)
+{
+	return left >= 8? 0xff : (1u << left) - 1;
+}
+
+AVX512 static void
+carrybitsavx512(uint64_t * const plane[],
+                const size_t planes,
+                const uint64_t * const add,
+                size_t i,
+                const size_t n)
+{
+	for (; i < n; i += 8) {
+		const __mmask8 k = tailavx512(n - i);
+		__m512i a = _mm512_maskz_loadu_epi64(k, add + i);
+		for (size_t p = 0; p < planes && _mm512_test_epi64_mask(a, a);
+		     p++) {
+			const __m512i c =
+				_mm512_maskz_loadu_epi64(k, plane[p] + i);
+			_mm512_mask_storeu_epi64(plane[p] + i,
+			                         k,
+			                         _mm512_xor_si512(c, a));
+			a = _mm512_and_si512(a, c);
+		}
+	}
+}
+
+AVX512 static void
+sumbitsavx512(uint64_t * const plane[],
+              const size_t planes,
+              const uint64_t * const add[],
+              const size_t addplanes,
+              size_t i,
+              const size_t n)
+{
+	for (; i < n; i += 8) {
+		const __mmask8 k = tailavx512(n - i);
+		__m512i c = _mm512_setzero_si512();
+		for (size_t p = 0;
+		     p < planes
+		     && (p < addplanes || _mm512_test_epi64_mask(c, c));
+		     p++) {
+			const __m512i a = p < addplanes
+			                  ? _mm512_maskz_loadu_epi64(k,
+			                                             add[p] + i)
+			                  : _mm512_setzero_si512();
+			const __m512i x =
+				_mm512_maskz_loadu_epi64(k, plane[p] + i);
+			const __m512i ax = _mm512_xor_si512(x, a);
+			_mm512_mask_storeu_epi64(plane[p] + i,
+			                         k,
+			                         _mm512_xor_si512(ax, c));
+			c = _mm512_or_si512(_mm512_and_si512(x, a),
+			                    _mm512_and_si512(c, ax));
+		}
+	}
+}
+
+AVX512 static __m512i
+belowavx512(const uint64_t * const plane[],
+            const size_t planes,
+            const size_t i,
+            const __mmask8 k,
+            const unsigned n)
+{
+	__m512i lt = _mm512_setzero_si512(), eq = _mm512_set1_epi64(-1);
+	for (size_t p = planes; p-- > 0;) {
+		const __m512i c = _mm512_maskz_loadu_epi64(k, plane[p] + i);
+		if (countbit(n, p)) {
+			lt = _mm512_or_si512(lt, _mm512_andnot_si512(c, eq));
+			eq = _mm512_and_si512(eq, c);
+		} else {
+			eq = _mm512_andnot_si512(c, eq);
+		}
+	}
+	return lt;
+}
+
+AVX512 static void
+rangebitsavx512(uint64_t * const dst,
+                const uint64_t * const plane[],
+                const size_t planes,
+                const unsigned lo,
+                const unsigned hi,
+                size_t i,
+                const size_t n)
+{
+	for (; i < n; i += 8) {
+		const __mmask8 k = tailavx512(n - i);
+		const __m512i upto = hi == UINT_MAX? _mm512_set1_epi64(-1)
+		                     : belowavx512(plane, planes, i, k, hi + 1);
+		_mm512_mask_storeu_epi64(dst + i,
+		                         k,
+		                         _mm512_andnot_si512(belowavx512(plane,
+		                                                         planes,
+		                                                         i,
+		                                                         k,
+		                                                         lo),
+		                                             upto));
+	}
+}
+
+#endif
+
+static const Kernels kernels[NISAS] = {
+	[ISA_GENERIC] = {
+		.countbits = countbitsgeneric,
+		.carrybits = carrybitsgeneric,
+		.sumbits = sumbitsgeneric,
+		.rangebits = rangebitsgeneric
+	},
+#ifdef ISA_X86
+	[ISA_SSE2] = {
+		.countbits = countbitssse2,
+		.carrybits = carrybitssse2,
+		.sumbits = sumbitssse2,
+		.rangebits = rangebitssse2
+	},
+	[ISA_AVX2] = {
+		.countbits = countbitsavx2,
+		.carrybits = carrybitsavx2,
+		.sumbits = sumbitsavx2,
+		.rangebits = rangebitsavx2
+	},
+	[ISA_AVX512] = {
+		.countbits = countbitsavx512,
+		.carrybits = carrybitsavx512,
+		.sumbits = sumbitsavx512,
+		.rangebits = rangebitsavx512
+	}
+#endif
+};
+
+/* Widest set the processor and its operating system allow, and the one used */
+static pthread_once_t probed = PTHREAD_ONCE_INIT;
+static Isa best = ISA_GENERIC, chosen = NISAS;
+
+static void
+probe(void)
+{
+#ifdef ISA_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")
+	    && __builtin_cpu_supports("avx512bw"))
+		best = ISA_AVX512;
+	else if (__builtin_cpu_supports("avx2"))
+		best = ISA_AVX2;
+	else
+		best = ISA_SSE2;
+#endif
+	if (chosen == NISAS)
+		chosen = best;
+}
+
+static const Kernels *
+active(void)
+{
+	pthread_once(&probed, probe);
+	return &kernels[chosen];
+}
+
+bool
+advent_isa(const char * const name)
+{
+	pthread_once(&probed, probe);
+	if (name == NULL) {
+		chosen = best;
+		return true;
+	}
+	for (Isa i = 0; i < NISAS; i++) {
+		if (strcmp(name, isaname[i]) != 0)
+			continue;
+		if (i > best) {
+			fprintf(stderr,
+			        "This processor cannot run %s kernels\n",
+			        name);
+			return false;
+		}
+		chosen = i;
+		return true;
+	}
+	fprintf(stderr, "Unknown instruction set: %s\n", name);
+	return false;
+}
+
+const char *
+advent_isaname(void)
+{
+	pthread_once(&probed, probe);
+	return isaname[chosen];
+}
+
+uintmax_t
+countbits(const uint64_t * const w, const size_t n, const uint64_t mask)
+{
+	return active()->countbits(w, n, mask);
+}
+
+void
+carrybits(uint64_t * const plane[],
+          const size_t planes,
+          const uint64_t * const add,
+          const size_t n)
+{
+	active()->carrybits(plane, planes, add, 0, n);
+}
+
+void
+sumbits(uint64_t * const plane[],
+        const size_t planes,
+        const uint64_t * const add[],
+        const size_t addplanes,
+        const size_t n)
+{
+	active()->sumbits(plane, planes, add, addplanes, 0, n);
+}
+
+/*
+ * Bounds past the largest count the planes hold are settled here, so that the
+ * kernels only compare
+ */
+void
+rangebits(uint64_t * const dst,
+          const uint64_t * const plane[],
+          const size_t planes,
+          const unsigned lo,
+          unsigned hi,
+          const size_t n)
+{
+	const bool fits = planes < sizeof(lo) * CHAR_BIT;
+	if (fits && lo >> planes != 0) {
+		memset(dst, 0, n * sizeof(*dst));
+		return;
+	}
+	if (fits && hi != UINT_MAX && (hi + 1) >> planes != 0)
+		hi = UINT_MAX;
+	active()->rangebits(dst, plane, planes, lo, hi, 0, n);
+}
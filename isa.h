@@ -0,0 +1,49 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/* Requires <stddef.h> and <stdint.h> */
+
+/*
+ * Kernels below come in a variant for each of these instruction sets, which
+ * is picked once for the whole process: the widest the processor has, unless
+ * advent_isa says otherwise. Each set but the portable one implies those
+ * before it.
+ */
+typedef enum {
+	ISA_GENERIC,
+	ISA_SSE2,
+	ISA_AVX2,
+	ISA_AVX512,
+	NISAS
+} Isa;
+
+/* Number of bits set in `mask` and in each of the `n` words at `w` */
+uintmax_t countbits(const uint64_t *w, size_t n, uint64_t mask);
+
+/*
+ * Counters spread over `planes` arrays of `n` words, the first holding bit 0
+ * of the count of each bit position, the next bit 1 and so on. carrybits adds
+ * the bits of the words at `add` to them, and sumbits the counters `add` of
+ * `addplanes` arrays; counts which outgrow the planes wrap around. rangebits
+ * sets the bits of `dst` whose count is between `lo` and `hi`.
+ */
+void carrybits(uint64_t *const plane[],
+               size_t planes,
+               const uint64_t *add,
+               size_t n);
+void sumbits(uint64_t *const plane[],
+             size_t planes,
+             const uint64_t *const add[],
+             size_t addplanes,
+             size_t n);
+void rangebits(uint64_t *dst,
+               const uint64_t *const plane[],
+               size_t planes,
+               unsigned lo,
+               unsigned hi,
+               size_t n);
@@ -0,0 +1,464 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+#include "pages.h"
+#include "snapshot.h"
+
+static int (*const days[ADVENT_DAYS])(Input *, AdventResult *) = {
+	day01,
+	day02,
+	day03,
+	day04,
+	day05,
+	day06,
+	day07,
+	day08,
+	day09,
+	day10,
+	day11,
+	day12,
+	day13,
+	day14,
+	day15,
+	day16,
+	day17,
+	day18,
+	day19,
+	day20,
+	day21,
+	day22,
+	day23,
+	day24,
+	day25
+};
+
+/* Days which can fold their input as it is read */
+static const Stream *const streams[ADVENT_DAYS] = {
+	[1] = &stream02,
+	[3] = &stream04,
+	[4] = &stream05,
+	[5] = &stream06,
+	[11] = &stream12,
+	[17] = &stream18
+};
+
+/* Most large tables a day may hold at once */
+#define SOLVE_TABLES 4
+
+/* Days with several engines */
+static const Engine *const engines[ADVENT_DAYS] = {
+	[0] = engines01,
+	[21] = engines22
+};
+
+/*
+ * A day's answers, the scratch memory and large tables it allocates while
+ * solving, where its phases go if it is traced, and its input and snapshot if
+ * it was loaded
+ */
+typedef struct {
+	AdventResult res;
+	Arena arena;
+	Pages table[SOLVE_TABLES];
+	size_t ntables;
+	AdventTrace *trace;
+	double begin;
+	unsigned day;
+	const char *buf;
+	size_t len;
+	uint64_t hash;
+	bool hashed;
+	Snapshot snap;
+} Solve;
+
+/* Where snapshots of parsed input go, if anywhere */
+static const char *snapdir;
+
+/* Engine days run if they have one of that name */
+static const char *enginename;
+
+/* Largest pages large tables may be backed by */
+static AdventPages bestpages = ADVENT_PAGES_HUGETLB;
+
+static const char *const pagesname[] = {
+	[ADVENT_PAGES_NONE] = "-",
+	[ADVENT_PAGES_HUGETLB] = "hugetlb",
+	[ADVENT_PAGES_THP] = "thp",
+	[ADVENT_PAGES_MALLOC] = "malloc"
+};
+
+static double
+now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double) t.tv_sec + 1e-9 * (double) t.tv_nsec;
+}
+
+/* Until the day returns, `parse` holds the time at which parsed was called */
+void
+parsed(AdventResult *const res)
+{
+	res->parse = now();
+}
+
+/* Days are only ever handed the result inside a Solve */
+Arena *
+scratch(AdventResult *const res)
+{
+	return &((Solve *) res)->arena;
+}
+
+void *
+bigtable(AdventResult *const res, const size_t size)
+{
+	Solve *const s = (Solve *) res;
+	if (s->ntables == SOLVE_TABLES) {
+		fputs("Too many large tables\n", stderr);
+		return NULL;
+	}
+	Pages *const pg = &s->table[s->ntables];
+	if (!pagesalloc(pg, size, bestpages))
+		return NULL;
+	s->ntables++;
+	if (pg->backing > res->pages)
+		res->pages = pg->backing;
+	res->tables += pg->len;
+	return pg->p;
+}
+
+void
+advent_pages(const AdventPages best)
+{
+	bestpages = best == ADVENT_PAGES_NONE? ADVENT_PAGES_HUGETLB : best;
+}
+
+const char *
+advent_pagesname(const AdventPages pages)
+{
+	return pagesname[pages];
+}
+
+size_t
+tracebegin(AdventResult *const restrict res, const char *const restrict name)
+{
+	Solve *const s = (Solve *) res;
+	if (s->trace == NULL || s->trace->n == ADVENT_SPANS)
+		return ADVENT_SPANS;
+	s->trace->span[s->trace->n] = (AdventSpan) {
+		.name = name,
+		.begin = now() - s->begin,
+		.end = 0
+	};
+	return s->trace->n++;
+}
+
+void
+traceend(AdventResult *const res, const size_t i)
+{
+	Solve *const s = (Solve *) res;
+	if (s->trace != NULL && i < s->trace->n)
+		s->trace->span[i].end = now() - s->begin;
+}
+
+void
+advent_snapshots(const char *const dir)
+{
+	snapdir = dir;
+}
+
+static SnapshotKey
+snapkey(Solve *const s, const unsigned version)
+{
+	if (!s->hashed)
+		s->hash = snaphash(s->buf, s->len);
+	s->hashed = true;
+	return (SnapshotKey) {
+		.day = s->day,
+		.version = version,
+		.hash = s->hash,
+		.len = s->len
+	};
+}
+
+const void *
+snapload(AdventResult *const res, const unsigned version, size_t *const size)
+{
+	Solve *const s = (Solve *) res;
+	if (snapdir == NULL || s->buf == NULL)
+		return NULL;
+	snapunmap(&s->snap);
+	return snapmap(&s->snap, snapdir, snapkey(s, version), size);
+}
+
+void
+snapsave(AdventResult *const restrict res,
+         const unsigned version,
+         const void *const restrict buf,
+         const size_t size)
+{
+	Solve *const s = (Solve *) res;
+	if (snapdir != NULL && s->buf != NULL)
+		snapwrite(snapdir, snapkey(s, version), buf, size);
+}
+
+static void
+setanswer(AdventResult *const restrict res,
+          const unsigned part,
+          const char *const restrict label,
+          const AdventType type)
+{
+	if (res->part[part].type == ADVENT_STR)
+		free(res->part[part].val.s);
+	res->part[part].type = type;
+	res->part[part].label = label;
+}
+
+void
+answeruint(AdventResult *const restrict res,
+           const unsigned part,
+           const char *const restrict label,
+           const uintmax_t val)
+{
+	setanswer(res, part, label, ADVENT_UINT);
+	res->part[part].val.u = val;
+}
+
+void
+answerint(AdventResult *const restrict res,
+          const unsigned part,
+          const char *const restrict label,
+          const intmax_t val)
+{
+	setanswer(res, part, label, ADVENT_INT);
+	res->part[part].val.i = val;
+}
+
+bool
+answerstr(AdventResult *const restrict res,
+          const unsigned part,
+          const char *const restrict label,
+          const char *const restrict val)
+{
+	char *const s = malloc(strlen(val) + 1);
+	if (s == NULL) {
+		perror("Could not copy answer");
+		return false;
+	}
+	strcpy(s, val);
+	setanswer(res, part, label, ADVENT_STR);
+	res->part[part].val.s = s;
+	return true;
+}
+
+int
+advent_solve(const unsigned day,
+             const char *const buf,
+             const size_t len,
+             AdventResult *const out)
+{
+	return advent_trace(day, buf, len, out, NULL);
+}
+
+/* Answers nothing yet, with no time or memory spent */
+static void
+setup(Solve *const s, AdventTrace *const trace)
+{
+	*s = (Solve) {
+		.arena = { .block = NULL },
+		.ntables = 0,
+		.trace = trace,
+		.buf = NULL,
+		.hashed = false,
+		.snap = { .map = NULL }
+	};
+	if (trace != NULL)
+		trace->n = 0;
+	for (unsigned p = 0; p < 2; p++) {
+		s->res.part[p].type = ADVENT_NONE;
+		s->res.part[p].label = NULL;
+	}
+	s->res.parse = s->res.solve = 0;
+	s->res.allocs = s->res.bytes = 0;
+	s->res.pages = ADVENT_PAGES_NONE;
+	s->res.tables = 0;
+}
+
+/* Releases the scratch memory of a day which has returned, and times it */
+static int
+conclude(Solve *const s, const int status, AdventResult *const out)
+{
+	arrelease(&s->arena);
+	for (size_t i = 0; i < s->ntables; i++)
+		pagesfree(&s->table[i]);
+	snapunmap(&s->snap);
+	const double end = now();
+	*out = s->res;
+	if (out->parse == 0) {
+		out->solve = end - s->begin;
+	} else {
+		out->solve = end - out->parse;
+		out->parse -= s->begin;
+	}
+	out->allocs = s->arena.allocs;
+	out->bytes = s->arena.bytes;
+	return status;
+}
+
+/* Solves a day with the engine asked for if it has it, or else its last */
+static int
+solveday(const unsigned day, Input *const in, AdventResult *const res)
+{
+	const Engine *const e = engines[day - 1];
+	if (e == NULL)
+		return days[day - 1](in, res);
+	size_t i = 0;
+	while (e[i + 1].name != NULL
+	       && (enginename == NULL || strcmp(e[i].name, enginename) != 0))
+		i++;
+	return e[i].solve(in, res);
+}
+
+const char *
+advent_engines(const unsigned day, const unsigned i)
+{
+	if (day < 1 || day > ADVENT_DAYS)
+		return NULL;
+	if (engines[day - 1] == NULL)
+		return i == 0? "reference" : NULL;
+	for (unsigned j = 0; engines[day - 1][j].name != NULL; j++) {
+		if (j == i)
+			return engines[day - 1][j].name;
+	}
+	return NULL;
+}
+
+bool
+advent_engine(const char *const name)
+{
+	enginename = NULL;
+	if (name == NULL)
+		return true;
+	for (unsigned day = 1; day <= ADVENT_DAYS; day++) {
+		const char *e;
+		for (unsigned i = 0; (e = advent_engines(day, i)) != NULL;
+		     i++) {
+			if (strcmp(e, name) == 0) {
+				enginename = name;
+				return true;
+			}
+		}
+	}
+	fprintf(stderr, "Unknown engine: %s\n", name);
+	return false;
+}
+
+int
+advent_trace(const unsigned day,
+             const char *const buf,
+             const size_t len,
+             AdventResult *const out,
+             AdventTrace *const trace)
+{
+	Solve s;
+	setup(&s, trace);
+	if (day < 1 || day > ADVENT_DAYS) {
+		*out = s.res;
+		fprintf(stderr,
+		        "Day must be an integer between 1 and %d\n",
+		        ADVENT_DAYS);
+		return EXIT_FAILURE;
+	}
+	/* Empty input may come as a null pointer, which memchr rejects */
+	Input in = { .p = len > 0? buf : "" };
+	in.end = in.p + len;
+	s.day = day;
+	s.buf = in.p;
+	s.len = len;
+	s.begin = now();
+	return conclude(&s, solveday(day, &in, &s.res), out);
+}
+
+/*
+ * Folds the records of `in` into the state of a day, or those read from `fd`
+ * if `in` is a null pointer, then answers
+ */
+static int
+fold(const Stream *const st,
+     Input *const in,
+     const int fd,
+     AdventResult *const out)
+{
+	void *const state = aralloc(scratch(out), st->size);
+	if (state == NULL) {
+		fputs("Could not allocate the state of the day\n", stderr);
+		return EXIT_FAILURE;
+	}
+	memset(state, 0, st->size);
+	if (st->begin != NULL && !st->begin(state, out))
+		return EXIT_FAILURE;
+	int status = EXIT_FAILURE;
+	if (in != NULL? st->fold(state, in)
+	              : streamfeed(fd, st->sep, st->fold, state)) {
+		parsed(out);
+		status = st->finish(state, out);
+	}
+	if (st->release != NULL)
+		st->release(state);
+	return status;
+}
+
+int
+foldinput(const Stream *const st, Input *const in, AdventResult *const out)
+{
+	return fold(st, in, -1, out);
+}
+
+int
+advent_stream(const unsigned day, const int fd, AdventResult *const out)
+{
+	if (day < 1 || day > ADVENT_DAYS || streams[day - 1] == NULL) {
+		AdventInput in;
+		if (advent_load(fd, &in) != EXIT_SUCCESS) {
+			Solve s;
+			setup(&s, NULL);
+			*out = s.res;
+			return EXIT_FAILURE;
+		}
+		const int status = advent_solve(day, in.buf, in.len, out);
+		advent_unload(&in);
+		return status;
+	}
+	Solve s;
+	setup(&s, NULL);
+	s.begin = now();
+	return conclude(&s, fold(streams[day - 1], NULL, fd, &s.res), out);
+}
+
+void
+advent_free(AdventResult *const res)
+{
+	for (unsigned p = 0; p < 2; p++) {
+		if (res->part[p].type == ADVENT_STR)
+			free(res->part[p].val.s);
+		res->part[p].type = ADVENT_NONE;
+	}
+}
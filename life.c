@@ -0,0 +1,342 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "grid.h"
+#include "life.h"
+#include "parallel.h"
+
+/* Bits counting the cells of a box 3 cells wide on a plane */
+#define BOX_PLANES 4
+
+static const ptrdiff_t square[8][2] = {
+	{ -1, -1 }, { 0, -1 }, { 1, -1 }, { -1, 0 },
+	{ 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 }
+};
+
+static const ptrdiff_t hex[6][2] = {
+	{ 1, 0 }, { -1, 0 }, { 0, 1 }, { -1, 1 }, { 1, -1 }, { 0, -1 }
+};
+
+/* Bits holding counts up to `n` */
+static size_t
+bits(const uintmax_t n)
+{
+	size_t b = 0;
+	while (b < sizeof(n) * CHAR_BIT && n >> b != 0)
+		b++;
+	return b;
+}
+
+/* Position of plane `p` along dimension `k`, from the third one on */
+static size_t
+coord(const Life * const l, size_t p, const size_t k)
+{
+	for (size_t d = 2; d < k; d++)
+		p /= l->size[d];
+	return p % l->size[k];
+}
+
+/*
+ * Lays the grids of the cells, of the next ones, of those which stay alive, of
+ * the counters and of the boxes of each plane of `size` over words of their
+ * own, releasing the previous ones
+ */
+static bool
+allocgrids(Life * const l, const size_t size[])
+{
+	size_t planes = 1;
+	for (size_t k = 2; k < l->dims; k++) {
+		if (size[k] > SIZE_MAX / planes) {
+			fputs("Too many planes of cells\n", stderr);
+			return false;
+		}
+		planes *= size[k];
+	}
+	const size_t boxes = l->topology == LIFE_CUBE? BOX_PLANES : 0;
+	const size_t each = 3 + l->countplanes + boxes;
+	const size_t words = gridwords(size[0], size[1]);
+	const size_t n = planes <= SIZE_MAX / each? planes * each : 0;
+	Grid * const grid = n > 0 && n <= SIZE_MAX / sizeof(Grid)
+	                    ? malloc(n * sizeof(Grid)) : NULL;
+	uint64_t * const w = words > 0 && n > 0
+	                     && n <= SIZE_MAX / sizeof(uint64_t) / words
+	                     ? malloc(n * words * sizeof(uint64_t)) : NULL;
+	if (grid == NULL || w == NULL) {
+		fputs("Could not allocate cells\n", stderr);
+		free(grid);
+		free(w);
+		return false;
+	}
+	for (size_t i = 0; i < n; i++)
+		gridinit(&grid[i], w + i * words, size[0], size[1]);
+	lifefree(l);
+	for (size_t k = 0; k < l->dims; k++)
+		l->size[k] = size[k];
+	l->planes = planes;
+	l->grid = grid;
+	l->cell = grid;
+	l->next = l->cell + planes;
+	l->keep = l->next + planes;
+	l->counter = l->keep + planes;
+	l->box = l->counter + l->countplanes * planes;
+	return true;
+}
+
+bool
+lifeinit(Life * const l, const Grid * const pattern)
+{
+	l->grid = NULL;
+	l->generations = 0;
+	/* Edges are found on the last row and column, which must exist */
+	if (pattern->width == 0 || pattern->height == 0) {
+		fputs("Bad input format: no cells\n", stderr);
+		return false;
+	}
+	switch (l->topology) {
+	case LIFE_SQUARE:
+		l->dims = 2;
+		l->countplanes = bits(8);
+		break;
+	case LIFE_HEX:
+		l->dims = 2;
+		l->countplanes = bits(6);
+		break;
+	case LIFE_CUBE:
+		if (l->dims < 2 || l->dims > LIFE_DIMS) {
+			fprintf(stderr,
+			        "No cubes of %zu dimensions\n",
+			        l->dims);
+			return false;
+		}
+		l->countplanes = 1;
+		for (size_t k = 0; k < l->dims; k++)
+			l->countplanes *= 3;
+		l->countplanes = bits(l->countplanes);
+		break;
+	case LIFE_GRAPH:
+		l->dims = 2;
+		l->countplanes = bits(l->degree);
+		break;
+	}
+	size_t size[LIFE_DIMS] = { pattern->width, pattern->height };
+	for (size_t k = 2; k < l->dims; k++)
+		size[k] = 1;
+	if (!allocgrids(l, size))
+		return false;
+	gridcopy(&l->cell[0], pattern);
+	return true;
+}
+
+/* Counts the box around each cell of the planes [lo, hi), the cell included */
+static void
+boxplanes(void * const arg, const size_t lo, const size_t hi)
+{
+	const Life * const l = arg;
+	for (size_t p = lo; p < hi; p++) {
+		Grid * const box = &l->box[BOX_PLANES * p];
+		for (size_t b = 0; b < BOX_PLANES; b++)
+			gridclear(&box[b]);
+		for (ptrdiff_t dy = -1; dy <= 1; dy++) {
+			for (ptrdiff_t dx = -1; dx <= 1; dx++)
+				gridadd(box, BOX_PLANES, &l->cell[p], dx, dy);
+		}
+	}
+}
+
+/* Sums the boxes of the planes around plane `p`, its own included */
+static void
+sumboxes(const Life * const l, const size_t p, Grid count[])
+{
+	size_t at[LIFE_DIMS], from[LIFE_DIMS], to[LIFE_DIMS];
+	for (size_t k = 2; k < l->dims; k++) {
+		const size_t c = coord(l, p, k);
+		from[k] = at[k] = c > 0? c - 1 : 0;
+		to[k] = c + 1 < l->size[k]? c + 1 : c;
+	}
+	for (;;) {
+		size_t q = 0;
+		for (size_t k = l->dims; k-- > 2;)
+			q = q * l->size[k] + at[k];
+		gridsum(count,
+		        l->countplanes,
+		        &l->box[BOX_PLANES * q],
+		        BOX_PLANES);
+		size_t k = 2;
+		while (k < l->dims && at[k] == to[k]) {
+			at[k] = from[k];
+			k++;
+		}
+		if (k == l->dims)
+			return;
+		at[k]++;
+	}
+}
+
+/* Counts the neighbors of the cells of planes [lo, hi) and applies the rule */
+static void
+stepplanes(void * const arg, const size_t lo, const size_t hi)
+{
+	const Life * const l = arg;
+	const LifeRule * const r = &l->rule;
+	const size_t n = l->countplanes;
+	/* Counts of cubes take the cell in */
+	const unsigned self = l->topology == LIFE_CUBE;
+	const unsigned staylo = r->staylo + self;
+	const unsigned stayhi = r->stayhi < UINT_MAX? r->stayhi + self
+	                        : UINT_MAX;
+	for (size_t p = lo; p < hi; p++) {
+		Grid * const count = &l->counter[n * p];
+		Grid * const next = &l->next[p], * const keep = &l->keep[p];
+		if (l->topology == LIFE_SQUARE) {
+			for (size_t b = 0; b < n; b++)
+				gridclear(&count[b]);
+			for (size_t d = 0; d < 8; d++)
+				gridadd(count,
+				        n,
+				        &l->cell[p],
+				        square[d][0],
+				        square[d][1]);
+		} else if (l->topology == LIFE_HEX) {
+			for (size_t b = 0; b < n; b++)
+				gridclear(&count[b]);
+			for (size_t d = 0; d < 6; d++)
+				gridadd(count,
+				        n,
+				        &l->cell[p],
+				        hex[d][0],
+				        hex[d][1]);
+		} else if (l->topology == LIFE_CUBE) {
+			for (size_t b = 0; b < n; b++)
+				gridclear(&count[b]);
+			sumboxes(l, p, count);
+		}
+		gridrange(next, count, n, r->bornlo, r->bornhi);
+		gridandnot(next, next, &l->cell[p]);
+		gridrange(keep, count, n, staylo, stayhi);
+		gridand(keep, keep, &l->cell[p]);
+		gridor(next, next, keep);
+		if (l->mask != NULL)
+			gridand(next, next, l->mask);
+	}
+}
+
+static bool
+rowlive(const Grid * const g, const size_t y)
+{
+	for (size_t i = 0; i < g->stride; i++) {
+		if (gridrow(g, y)[i] != 0)
+			return true;
+	}
+	return false;
+}
+
+/* Finds the dimensions in which a live cell lies on an edge */
+static void
+edges(const Life * const l, bool edge[])
+{
+	Grid * const all = &l->next[0];
+	gridclear(all);
+	for (size_t k = 0; k < l->dims; k++)
+		edge[k] = false;
+	for (size_t p = 0; p < l->planes; p++) {
+		if (gridpopcount(&l->cell[p]) == 0)
+			continue;
+		gridor(all, all, &l->cell[p]);
+		for (size_t k = 2; k < l->dims; k++) {
+			const size_t c = coord(l, p, k);
+			edge[k] |= c == 0 || c == l->size[k] - 1;
+		}
+	}
+	edge[1] = rowlive(all, 0) || rowlive(all, all->height - 1);
+	for (size_t y = 0; y < all->height && !edge[0]; y++)
+		edge[0] = gridget(all, 0, y) || gridget(all, all->width - 1, y);
+}
+
+/* Grows by a cell on both sides of each dimension with a live cell on edge */
+static bool
+grow(Life * const l)
+{
+	bool edge[LIFE_DIMS], grows = false;
+	size_t size[LIFE_DIMS];
+	edges(l, edge);
+	for (size_t k = 0; k < l->dims; k++) {
+		if (l->size[k] > SIZE_MAX - 2) {
+			fputs("Cells grow too far\n", stderr);
+			return false;
+		}
+		size[k] = l->size[k] + 2 * edge[k];
+		grows |= edge[k];
+	}
+	if (!grows)
+		return true;
+	Life old = *l;
+	l->grid = NULL;
+	if (!allocgrids(l, size)) {
+		*l = old;
+		return false;
+	}
+	for (size_t p = 0; p < old.planes; p++) {
+		size_t q = 0;
+		for (size_t k = l->dims; k-- > 2;)
+			q = q * size[k] + coord(&old, p, k) + edge[k];
+		gridput(&l->cell[q], &old.cell[p], edge[0], edge[1]);
+	}
+	lifefree(&old);
+	return true;
+}
+
+bool
+liferun(Life * const l, const uintmax_t steps)
+{
+	for (uintmax_t i = 0; i < steps; i++) {
+		if (l->grow && !grow(l))
+			return false;
+		if (l->topology == LIFE_CUBE)
+			parallelfor(0, l->planes, 1, boxplanes, l);
+		if (l->topology == LIFE_GRAPH) {
+			for (size_t b = 0; b < l->countplanes; b++)
+				gridclear(&l->counter[b]);
+			l->count(l->arg, l->cell, l->counter, l->countplanes);
+		}
+		parallelfor(0, l->planes, 1, stepplanes, l);
+		bool changed = false;
+		for (size_t p = 0; p < l->planes && !changed; p++)
+			changed = !gridsame(&l->next[p], &l->cell[p]);
+		Grid * const cell = l->next;
+		l->next = l->cell;
+		l->cell = cell;
+		if (!changed)
+			break;
+		l->generations++;
+	}
+	return true;
+}
+
+uintmax_t
+lifepopcount(const Life * const l)
+{
+	uintmax_t live = 0;
+	for (size_t p = 0; p < l->planes; p++)
+		live += gridpopcount(&l->cell[p]);
+	return live;
+}
+
+void
+lifefree(Life * const l)
+{
+	if (l->grid != NULL)
+		free(l->grid[0].w);
+	free(l->grid);
+	l->grid = NULL;
+}
@@ -0,0 +1,80 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/* Requires <stdbool.h>, <stddef.h>, <stdint.h> and "grid.h" */
+
+/* Most dimensions of a cube */
+#define LIFE_DIMS 8
+
+/*
+ * Neighbors of a cell: the 8 around it on a plane, the 6 around it on a plane
+ * of hexagons in axial coordinates, whose rows are shifted by half a cell to
+ * the west from one to the next, the 3^dims - 1 around it in a cube of `dims`
+ * dimensions, or those a callback counts, such as cells in sight
+ */
+typedef enum {
+	LIFE_SQUARE,
+	LIFE_HEX,
+	LIFE_CUBE,
+	LIFE_GRAPH
+} LifeTopology;
+
+/*
+ * Dead cells with between `bornlo` and `bornhi` live neighbors come to life,
+ * and live cells with between `staylo` and `stayhi` stay alive
+ */
+typedef struct {
+	unsigned bornlo, bornhi, staylo, stayhi;
+} LifeRule;
+
+/*
+ * A cellular automaton, which the caller sets up to `degree` and lifeinit
+ * fills in. Cells lie in planes of `size[0]` by `size[1]`, one per position
+ * along the further dimensions of a cube, the third one varying fastest.
+ *
+ * Cube planes are shared among threads. A graph has one plane: `count` adds 1
+ * to the counters of the `planes` grids `count` for each live neighbor of a
+ * cell in `cells`, as gridadd does, the counters being clear and wide enough
+ * for `degree`, the most neighbors a cell has. If `mask` is given, cells
+ * outside it never live. If `grow` is set, the automaton grows by a cell on
+ * both sides of each dimension in which a live cell reaches the edge, and
+ * takes no mask.
+ */
+typedef struct {
+	LifeTopology topology;
+	size_t dims;
+	LifeRule rule;
+	const Grid *mask;
+	bool grow;
+	void (*count)(void *arg,
+	              const Grid *cells,
+	              Grid count[],
+	              size_t planes);
+	void *arg;
+	unsigned degree;
+	size_t size[LIFE_DIMS], planes, countplanes;
+	Grid *grid, *cell, *next, *keep, *counter, *box;
+	uintmax_t generations;
+} Life;
+
+/*
+ * Lays `pattern` on a plane of its size, the first along each dimension.
+ * Returns false if the pattern has no cells or memory is exhausted; the
+ * automaton must be released with lifefree either way.
+ */
+bool lifeinit(Life *, const Grid *pattern);
+
+/*
+ * Runs `steps` generations, or stops at the first one which changes nothing,
+ * as all the next ones would be the same. `generations` counts those which
+ * changed something. Returns false if memory is exhausted.
+ */
+bool liferun(Life *, uintmax_t steps);
+
+uintmax_t lifepopcount(const Life *);
+void lifefree(Life *);
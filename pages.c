@@ -0,0 +1,129 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "advent.h"
+#include "pages.h"
+
+/* Huge pages are assumed to be of the usual 2 MiB of x86-64 and arm64 */
+#define HUGE_PAGE ((size_t) 1 << 21)
+
+#ifdef MAP_HUGETLB
+/* Fails unless the system reserved huge pages, as in vm.nr_hugepages */
+static bool
+maphugetlb(Pages * const pg, const size_t len)
+{
+	void * const p = mmap(NULL,
+	                      len,
+	                      PROT_READ | PROT_WRITE,
+	                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+	                      -1,
+	                      0);
+	if (p == MAP_FAILED)
+		return false;
+	*pg = (Pages) { .p = p, .len = len, .backing = ADVENT_PAGES_HUGETLB };
+	return true;
+}
+#endif
+
+#ifdef MADV_HUGEPAGE
+/*
+ * Whether the kernel gives transparent huge pages to those asking with
+ * madvise, which still succeeds when they are turned off. Kernels without the
+ * setting are left for madvise to turn down.
+ */
+static bool
+thpenabled(void)
+{
+	char mode[64] = "";
+	FILE * const f = fopen("/sys/kernel/mm/transparent_hugepage/enabled",
+	                       "r");
+	if (f == NULL)
+		return true;
+	const bool read = fgets(mode, sizeof(mode), f) != NULL;
+	fclose(f);
+	return !read || strstr(mode, "[never]") == NULL;
+}
+
+/*
+ * Maps a huge page more than needed and trims it, so that the table starts on
+ * a huge page boundary, then asks for transparent huge pages, which fails if
+ * the kernel has none
+ */
+static bool
+mapadvised(Pages * const pg, const size_t len)
+{
+	char * const p = mmap(NULL,
+	                      len + HUGE_PAGE,
+	                      PROT_READ | PROT_WRITE,
+	                      MAP_PRIVATE | MAP_ANONYMOUS,
+	                      -1,
+	                      0);
+	if (p == MAP_FAILED)
+		return false;
+	const size_t skip = (HUGE_PAGE - (uintptr_t) p % HUGE_PAGE)
+	                    % HUGE_PAGE;
+	if (skip > 0)
+		munmap(p, skip);
+	munmap(p + skip + len, HUGE_PAGE - skip);
+	if (madvise(p + skip, len, MADV_HUGEPAGE) != 0) {
+		munmap(p + skip, len);
+		return false;
+	}
+	*pg = (Pages) {
+		.p = p + skip,
+		.len = len,
+		.backing = ADVENT_PAGES_THP
+	};
+	return true;
+}
+#endif
+
+bool
+pagesalloc(Pages * const pg, const size_t size, const AdventPages best)
+{
+	if (size > SIZE_MAX - 2 * HUGE_PAGE)
+		return false;
+	const size_t len = (size + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+#if !defined(MAP_HUGETLB) && !defined(MADV_HUGEPAGE)
+	(void) len;
+	(void) best;
+#endif
+#ifdef MAP_HUGETLB
+	if (best <= ADVENT_PAGES_HUGETLB && maphugetlb(pg, len))
+		return true;
+#endif
+#ifdef MADV_HUGEPAGE
+	if (best <= ADVENT_PAGES_THP && thpenabled() && mapadvised(pg, len))
+		return true;
+#endif
+	*pg = (Pages) {
+		.p = malloc(size),
+		.len = 0,
+		.backing = ADVENT_PAGES_MALLOC
+	};
+	return pg->p != NULL;
+}
+
+void
+pagesfree(Pages * const pg)
+{
+	if (pg->len > 0)
+		munmap(pg->p, pg->len);
+	else
+		free(pg->p);
+	pg->p = NULL;
+}
@@ -0,0 +1,25 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/* Requires "advent.h" */
+
+/* Memory of a large table, mapped if `len` is not 0, and how it is backed */
+typedef struct {
+	void *p;
+	size_t len;
+	AdventPages backing;
+} Pages;
+
+/*
+ * Allocates `size` uninitialized bytes for a table reached at random, backed
+ * by the largest pages available that are no better than `best`: huge pages
+ * reserved by the system, then transparent huge pages unless the kernel turned
+ * them off, then whatever malloc gives. Returns false if memory is exhausted.
+ */
+bool pagesalloc(Pages *, size_t size, AdventPages best);
+void pagesfree(Pages *);
@@ -0,0 +1,291 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#define _DEFAULT_SOURCE
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "advent.h"
+#include "parallel.h"
+
+/* Most threads, counting the callers, and tasks each of them may queue */
+#define MAX_THREADS 64
+#define MAX_TASKS 256
+
+/* Ranges parallelfor cuts per thread, so that idle threads find some left */
+#define RANGES_PER_THREAD 4
+
+typedef struct {
+	void (*fn)(void *);
+	void *arg;
+	TaskGroup *group;
+} Task;
+
+/*
+ * The owner of a deque pushes and pops at its bottom, other threads steal
+ * from its top, so each thread goes depth first in its own work and thieves
+ * take the largest pieces. C99 has no atomics, so each deque has a lock.
+ */
+typedef struct {
+	pthread_mutex_t lock;
+	Task task[MAX_TASKS];
+	size_t top, bottom;
+} Deque;
+
+typedef struct {
+	void (*body)(void *, size_t, size_t);
+	void *ctx;
+	size_t lo, hi;
+} Range;
+
+/*
+ * Pool threads each own a deque past the first, which any other thread
+ * pushes into. `queued` counts tasks in the deques; it may briefly drop below
+ * zero when a task is taken before its push is counted. Idle threads and
+ * joiners sleep on `wake` until there are tasks or a group is done.
+ */
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static pthread_key_t self;
+static unsigned wanted;
+static size_t nthreads = 1;
+static long queued;
+static Deque deque[MAX_THREADS];
+/* Kernel ids of the pool threads, or 0 until they are known */
+static long tid[MAX_THREADS];
+
+void
+advent_threads(const unsigned n)
+{
+	wanted = n;
+}
+
+static Deque *
+mydeque(void)
+{
+	Deque * const d = pthread_getspecific(self);
+	return d != NULL? d : &deque[0];
+}
+
+static bool
+push(const Task * const t)
+{
+	Deque * const d = mydeque();
+	pthread_mutex_lock(&d->lock);
+	const bool room = d->bottom - d->top < MAX_TASKS;
+	if (room)
+		d->task[d->bottom++ % MAX_TASKS] = *t;
+	pthread_mutex_unlock(&d->lock);
+	return room;
+}
+
+/* Pops the newest task of our deque, or steals the oldest of another */
+static bool
+take(Task * const t)
+{
+	Deque * const mine = mydeque();
+	const size_t first = mine - deque;
+	bool found = false;
+	for (size_t i = 0; !found && i < nthreads; i++) {
+		Deque * const d = &deque[(first + i) % nthreads];
+		pthread_mutex_lock(&d->lock);
+		if (d->bottom > d->top) {
+			*t = d == mine? d->task[--d->bottom % MAX_TASKS]
+			              : d->task[d->top++ % MAX_TASKS];
+			found = true;
+		}
+		pthread_mutex_unlock(&d->lock);
+	}
+	if (found) {
+		pthread_mutex_lock(&lock);
+		queued--;
+		pthread_mutex_unlock(&lock);
+	}
+	return found;
+}
+
+static void
+run(const Task * const t)
+{
+	t->fn(t->arg);
+	pthread_mutex_lock(&lock);
+	if (--t->group->pending == 0)
+		pthread_cond_broadcast(&wake);
+	pthread_mutex_unlock(&lock);
+}
+
+static void *
+work(void * const d)
+{
+	pthread_setspecific(self, d);
+	/* Waits for start to count the threads */
+	pthread_mutex_lock(&lock);
+#ifdef __linux__
+	tid[(Deque *) d - deque] = syscall(SYS_gettid);
+#endif
+	pthread_mutex_unlock(&lock);
+	for (;;) {
+		Task t;
+		if (take(&t)) {
+			run(&t);
+			continue;
+		}
+		pthread_mutex_lock(&lock);
+		while (queued <= 0)
+			pthread_cond_wait(&wake, &lock);
+		pthread_mutex_unlock(&lock);
+	}
+	return NULL;
+}
+
+/*
+ * Threads are started on first use and live as long as the process; those
+ * which fail to start are done without
+ */
+static void
+start(void)
+{
+	long n = wanted > 0? (long) wanted : sysconf(_SC_NPROCESSORS_ONLN);
+	if (n < 1)
+		n = 1;
+	else if (n > MAX_THREADS)
+		n = MAX_THREADS;
+	if (pthread_key_create(&self, NULL) != 0)
+		return;
+	for (long i = 0; i < n; i++) {
+		pthread_mutex_init(&deque[i].lock, NULL);
+		deque[i].top = deque[i].bottom = 0;
+	}
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	size_t started = 1;
+	pthread_mutex_lock(&lock);
+	for (long i = 1; i < n; i++) {
+		pthread_t t;
+		if (pthread_create(&t, &attr, work, &deque[started]) == 0)
+			started++;
+	}
+	nthreads = started;
+	pthread_mutex_unlock(&lock);
+	pthread_attr_destroy(&attr);
+}
+
+size_t
+parallelthreads(void)
+{
+	pthread_once(&once, start);
+	return nthreads;
+}
+
+size_t
+paralleltids(long * const ids, const size_t max)
+{
+	size_t n = 0;
+	pthread_mutex_lock(&lock);
+	for (size_t i = 1; i < nthreads && n < max; i++) {
+		if (tid[i] != 0)
+			ids[n++] = tid[i];
+	}
+	pthread_mutex_unlock(&lock);
+	return n;
+}
+
+void
+groupspawn(TaskGroup * const g, void (* const fn)(void *), void * const arg)
+{
+	const Task t = { .fn = fn, .arg = arg, .group = g };
+	if (parallelthreads() == 1) {
+		fn(arg);
+		return;
+	}
+	pthread_mutex_lock(&lock);
+	g->pending++;
+	pthread_mutex_unlock(&lock);
+	if (!push(&t)) {
+		run(&t);
+		return;
+	}
+	pthread_mutex_lock(&lock);
+	queued++;
+	pthread_cond_signal(&wake);
+	pthread_mutex_unlock(&lock);
+}
+
+void
+groupjoin(TaskGroup * const g)
+{
+	for (;;) {
+		Task t;
+		pthread_mutex_lock(&lock);
+		const bool done = g->pending == 0;
+		pthread_mutex_unlock(&lock);
+		if (done)
+			return;
+		if (take(&t)) {
+			run(&t);
+			continue;
+		}
+		pthread_mutex_lock(&lock);
+		while (g->pending > 0 && queued <= 0)
+			pthread_cond_wait(&wake, &lock);
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+static void
+runrange(void * const arg)
+{
+	const Range * const r = arg;
+	r->body(r->ctx, r->lo, r->hi);
+}
+
+void
+parallelfor(const size_t begin,
+            const size_t end,
+            const size_t grain,
+            void (* const body)(void *, size_t, size_t),
+            void * const ctx)
+{
+	const size_t n = end > begin? end - begin : 0;
+	const size_t most = RANGES_PER_THREAD * parallelthreads();
+	size_t nranges = n / (grain > 0? grain : 1);
+	if (nranges > most)
+		nranges = most;
+	if (nranges <= 1) {
+		if (n > 0)
+			body(ctx, begin, end);
+		return;
+	}
+	Range range[nranges];
+	TaskGroup g = TASKGROUP;
+	const size_t q = n / nranges, r = n % nranges;
+	size_t lo = begin;
+	for (size_t i = 0; i < nranges; i++) {
+		const size_t hi = lo + q + (i < r);
+		range[i] = (Range) {
+			.body = body,
+			.ctx = ctx,
+			.lo = lo,
+			.hi = hi
+		};
+		lo = hi;
+	}
+	/* The caller takes the first range rather than wait idle */
+	for (size_t i = 1; i < nranges; i++)
+		groupspawn(&g, runrange, &range[i]);
+	runrange(&range[0]);
+	groupjoin(&g);
+}
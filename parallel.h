@@ -0,0 +1,51 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/* Requires <stddef.h> */
+
+/*
+ * Tasks spawned into a group, which its spawner waits for with groupjoin.
+ * Start groups as TASKGROUP and join them before they go out of scope.
+ */
+typedef struct {
+	size_t pending;
+} TaskGroup;
+
+#define TASKGROUP ((TaskGroup) { .pending = 0 })
+
+/*
+ * Queues fn(arg) on the threads shared by all days, or runs it at once if
+ * there is only one thread or the queue is full. Tasks may spawn and join
+ * groups of their own. They must not touch the scratch arena of the day,
+ * which is not shared; an Arena of their own is fine.
+ */
+void groupspawn(TaskGroup *, void (*)(void *), void *);
+
+/* Runs queued tasks until all those of the group are done */
+void groupjoin(TaskGroup *);
+
+/*
+ * Calls body(ctx, lo, hi) on disjoint ranges covering [begin, end) from as
+ * many threads as are useful, and returns once all are done. Ranges hold at
+ * least `grain` indices, so that a range is worth handing over to a thread.
+ */
+void parallelfor(size_t begin,
+                 size_t end,
+                 size_t grain,
+                 void (*body)(void *, size_t, size_t),
+                 void *ctx);
+
+/* Threads the days may run on, counting the caller */
+size_t parallelthreads(void);
+
+/*
+ * Stores up to `max` kernel thread ids of the pool threads running so far, not
+ * counting callers, and returns how many. Never starts the pool, and knows no
+ * ids but on Linux.
+ */
+size_t paralleltids(long *ids, size_t max);
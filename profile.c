@@ -0,0 +1,361 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#if defined(__linux__) && defined(__GLIBC__)
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PROFILING
+#endif
+
+#include "profile.h"
+
+/* Samples kept, the oldest being overwritten first, and frames per sample */
+#define PROFILE_SAMPLES 16384
+#define PROFILE_DEPTH 16
+
+/* The handler and the signal trampoline sit on top of every stack */
+#define PROFILE_SKIP 2
+
+typedef struct {
+	void *pc[PROFILE_DEPTH];
+	int depth;
+} Sample;
+
+/* A function of the binary, or of a shared library if `size` is 0 */
+typedef struct {
+	uintptr_t addr;
+	size_t size;
+	const char *name;
+} Symbol;
+
+typedef struct {
+	Symbol *sym;
+	size_t n;
+	void *map;
+	size_t len;
+} SymbolTable;
+
+/* A function found in a sample, running it if `self` */
+typedef struct {
+	uintptr_t addr;
+	const char *name;
+	size_t sample;
+	bool self;
+} Hit;
+
+typedef struct {
+	const char *name;
+	size_t self, total;
+} Function;
+
+#ifdef PROFILING
+/*
+ * Written by the signal handler only, so that sampling never allocates. The
+ * timer signals whichever thread is running, one at a time, since a handler
+ * returns long before the next period. Pool threads are sampled as well,
+ * unlike hardware events, which counters.c must open for each of them.
+ */
+static Sample ring[PROFILE_SAMPLES];
+static volatile size_t taken;
+static unsigned rate;
+
+static void
+onsample(const int sig)
+{
+	(void) sig;
+	const int saved = errno;
+	void *pc[PROFILE_DEPTH + PROFILE_SKIP];
+	const int n = backtrace(pc, PROFILE_DEPTH + PROFILE_SKIP);
+	Sample * const s = &ring[taken % PROFILE_SAMPLES];
+	s->depth = n > PROFILE_SKIP? n - PROFILE_SKIP : 0;
+	memcpy(s->pc, pc + PROFILE_SKIP, s->depth * sizeof(void *));
+	taken++;
+	errno = saved;
+}
+#endif
+
+bool
+profstart(const unsigned hz)
+{
+#ifdef PROFILING
+	/* The first backtrace loads the unwinder, which allocates */
+	void *warm[1];
+	backtrace(warm, 1);
+	taken = 0;
+	rate = hz;
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = onsample;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	const long usec = 1000000L / (hz > 0? hz : 1);
+	const struct timeval period = {
+		.tv_sec = usec / 1000000,
+		.tv_usec = usec % 1000000
+	};
+	const struct itimerval it = {
+		.it_interval = period,
+		.it_value = period
+	};
+	if (hz == 0 || usec == 0) {
+		errno = EINVAL;
+		return false;
+	}
+	return sigaction(SIGPROF, &sa, NULL) == 0
+	       && setitimer(ITIMER_PROF, &it, NULL) == 0;
+#else
+	(void) hz;
+	errno = ENOSYS;
+	return false;
+#endif
+}
+
+void
+profstop(void)
+{
+#ifdef PROFILING
+	const struct itimerval it = { .it_value = { .tv_sec = 0 } };
+	setitimer(ITIMER_PROF, &it, NULL);
+	signal(SIGPROF, SIG_IGN);
+#endif
+}
+
+#ifdef PROFILING
+static int
+cmpsymbol(const void * const x, const void * const y)
+{
+	const Symbol * const a = x, * const b = y;
+	return (a->addr > b->addr) - (a->addr < b->addr);
+}
+
+/*
+ * Reads the functions of the binary from its own symbol table, since dladdr
+ * only knows the few it exports. Returns false if it was stripped.
+ */
+static bool
+loadsymbols(SymbolTable * const t)
+{
+	const int fd = open("/proc/self/exe", O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) < 0
+	    || (size_t) st.st_size < sizeof(ElfW(Ehdr))) {
+		if (fd >= 0)
+			close(fd);
+		return false;
+	}
+	t->len = st.st_size;
+	t->map = mmap(NULL, t->len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (t->map == MAP_FAILED) {
+		t->map = NULL;
+		return false;
+	}
+	const char * const base = t->map;
+	const ElfW(Ehdr) * const eh = t->map;
+	if (memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0
+	    || eh->e_shoff > t->len
+	    || eh->e_shnum > (t->len - eh->e_shoff) / sizeof(ElfW(Shdr)))
+		return false;
+	/* Position-independent binaries are mapped where dladdr says */
+	Dl_info info;
+	uintptr_t load = 0;
+	if (eh->e_type == ET_DYN && dladdr((void *) profstart, &info) != 0)
+		load = (uintptr_t) info.dli_fbase;
+	const ElfW(Shdr) * const sh = (const void *) (base + eh->e_shoff);
+	for (size_t i = 0; i < eh->e_shnum; i++) {
+		if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum)
+			continue;
+		const ElfW(Shdr) * const str = &sh[sh[i].sh_link];
+		if (sh[i].sh_offset > t->len
+		    || sh[i].sh_size > t->len - sh[i].sh_offset
+		    || str->sh_offset > t->len
+		    || str->sh_size > t->len - str->sh_offset)
+			return false;
+		const char * const strtab = base + str->sh_offset;
+		const void * const symtab = base + sh[i].sh_offset;
+		const ElfW(Sym) * const sym = symtab;
+		const size_t nsym = sh[i].sh_size / sizeof(ElfW(Sym));
+		t->sym = malloc(nsym * sizeof(Symbol));
+		if (t->sym == NULL)
+			return false;
+		for (size_t j = 0; j < nsym; j++) {
+			/* Both classes share the same symbol type bits */
+			if (ELF64_ST_TYPE(sym[j].st_info) != STT_FUNC
+			    || sym[j].st_value == 0
+			    || sym[j].st_name >= str->sh_size)
+				continue;
+			t->sym[t->n++] = (Symbol) {
+				.addr = load + sym[j].st_value,
+				.size = sym[j].st_size,
+				.name = strtab + sym[j].st_name
+			};
+		}
+		qsort(t->sym, t->n, sizeof(Symbol), cmpsymbol);
+		return true;
+	}
+	return false;
+}
+
+static void
+freesymbols(SymbolTable * const t)
+{
+	free(t->sym);
+	if (t->map != NULL)
+		munmap(t->map, t->len);
+}
+
+/*
+ * Finds the function holding `pc` in the binary, or else asks dladdr about
+ * shared libraries; their functions which dladdr cannot name count as the
+ * library itself
+ */
+static Symbol
+resolve(const SymbolTable * const t, const uintptr_t pc)
+{
+	size_t lo = 0, hi = t->n;
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+		if (t->sym[mid].addr <= pc)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo > 0 && pc - t->sym[lo - 1].addr < t->sym[lo - 1].size)
+		return t->sym[lo - 1];
+	Dl_info info;
+	if (dladdr((void *) pc, &info) == 0 || info.dli_fname == NULL)
+		return (Symbol) { .addr = 0, .name = "?" };
+	if (info.dli_sname != NULL)
+		return (Symbol) {
+			.addr = (uintptr_t) info.dli_saddr,
+			.name = info.dli_sname
+		};
+	const char * const slash = strrchr(info.dli_fname, '/');
+	return (Symbol) {
+		.addr = (uintptr_t) info.dli_fbase,
+		.name = slash != NULL? slash + 1 : info.dli_fname
+	};
+}
+
+static int
+cmphit(const void * const x, const void * const y)
+{
+	const Hit * const a = x, * const b = y;
+	if (a->addr != b->addr)
+		return (a->addr > b->addr) - (a->addr < b->addr);
+	return (a->sample > b->sample) - (a->sample < b->sample);
+}
+
+static int
+cmpfunction(const void * const x, const void * const y)
+{
+	const Function * const a = x, * const b = y;
+	if (a->self != b->self)
+		return (a->self < b->self) - (a->self > b->self);
+	return (a->total < b->total) - (a->total > b->total);
+}
+
+/*
+ * Hits come sorted by function, then by sample, so that a recursive function
+ * counts once per sample in its total.
+ */
+static size_t
+tally(const Hit * const hit, const size_t nhits, Function * const f)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < nhits; i++) {
+		if (i == 0 || hit[i].addr != hit[i - 1].addr)
+			f[n++] = (Function) { .name = hit[i].name };
+		Function * const last = &f[n - 1];
+		last->self += hit[i].self;
+		if (i == 0 || hit[i].addr != hit[i - 1].addr
+		    || hit[i].sample != hit[i - 1].sample)
+			last->total++;
+	}
+	qsort(f, n, sizeof(Function), cmpfunction);
+	return n;
+}
+#endif
+
+void
+profprint(FILE * const out, const size_t top)
+{
+#ifdef PROFILING
+	const size_t nsamples = taken < PROFILE_SAMPLES? taken
+	                                                : PROFILE_SAMPLES;
+	fprintf(out,
+	        "Profile (%zu samples at %u Hz, %zu overwritten)\n",
+	        nsamples,
+	        rate,
+	        taken - nsamples);
+	if (nsamples == 0)
+		return;
+	SymbolTable t = { .sym = NULL, .n = 0, .map = NULL };
+	if (!loadsymbols(&t))
+		t.n = 0;
+	size_t nhits = 0;
+	for (size_t i = 0; i < nsamples; i++)
+		nhits += ring[i].depth;
+	Hit * const hit = malloc(nhits * sizeof(Hit));
+	Function * const f = malloc(nhits * sizeof(Function));
+	if (hit == NULL || f == NULL) {
+		fputs("Could not allocate profile\n", out);
+		free(hit);
+		free(f);
+		freesymbols(&t);
+		return;
+	}
+	nhits = 0;
+	for (size_t i = 0; i < nsamples; i++) {
+		for (int j = 0; j < ring[i].depth; j++) {
+			/* Callers are known by the address they return to */
+			const Symbol s = resolve(&t,
+			                         (uintptr_t) ring[i].pc[j]
+			                         - (j > 0));
+			hit[nhits++] = (Hit) {
+				.addr = s.addr,
+				.name = s.name,
+				.sample = i,
+				.self = j == 0
+			};
+		}
+	}
+	qsort(hit, nhits, sizeof(Hit), cmphit);
+	const size_t nf = tally(hit, nhits, f);
+	fputs("Self %\tTotal %\tSamples\tFunction\n", out);
+	for (size_t i = 0; i < nf && i < top; i++) {
+		fprintf(out,
+		        "%6.2lf\t%6.2lf\t%zu\t%s\n",
+		        100. * (double) f[i].self / (double) nsamples,
+		        100. * (double) f[i].total / (double) nsamples,
+		        f[i].self,
+		        f[i].name);
+	}
+	free(hit);
+	free(f);
+	freesymbols(&t);
+#else
+	(void) out;
+	(void) top;
+#endif
+}
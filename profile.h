@@ -0,0 +1,22 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/* Requires <stdbool.h>, <stddef.h> and <stdio.h> */
+
+/*
+ * Samples the call stack `hz` times per second of CPU time the process uses,
+ * until profstop. Returns false and sets errno if sampling is not supported.
+ */
+bool profstart(unsigned hz);
+void profstop(void);
+
+/*
+ * Prints the `top` functions found running in the most samples, with the
+ * share of samples they were running in and the share they were on the stack
+ */
+void profprint(FILE *, size_t top);
@@ -0,0 +1,173 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "input.h"
+
+#define RUNS 5
+
+typedef struct {
+	const char *name;
+	char sep;
+	unsigned maxdigits;
+} Case;
+
+static const Case cases[] = {
+	{ .name = "lines of 1-4 digits", .sep = '\n', .maxdigits = 4 },
+	{ .name = "lines of 1-19 digits", .sep = '\n', .maxdigits = 19 },
+	{ .name = "commas, 1-4 digits", .sep = ',', .maxdigits = 4 },
+	{ .name = "commas, 1-19 digits", .sep = ',', .maxdigits = 19 }
+};
+
+static double
+now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double) t.tv_sec + 1e-9 * (double) t.tv_nsec;
+}
+
+/* xorshift64, good enough to vary the digit count */
+static uint64_t
+next(uint64_t * const state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+/* Writes `n` numbers separated by `sep`; `buf` must hold 20 bytes each */
+static size_t
+fill(char * const buf, const size_t n, const Case * const c)
+{
+	uint64_t state = UINT64_C(0x9e3779b97f4a7c15);
+	size_t len = 0;
+	for (size_t i = 0; i < n; i++) {
+		const unsigned digits = 1 + next(&state) % c->maxdigits;
+		buf[len++] = '1' + next(&state) % 9;
+		for (unsigned d = 1; d < digits; d++)
+			buf[len++] = '0' + next(&state) % 10;
+		buf[len++] = c->sep;
+	}
+	buf[len] = 0;
+	return len;
+}
+
+static bool
+scancursor(const char * const buf,
+           const size_t len,
+           const char sep,
+           uintmax_t * const sum)
+{
+	Input in = { .p = buf, .end = buf + len };
+	uintmax_t x;
+	*sum = 0;
+	while (inuint(&in, &x)) {
+		*sum += x;
+		if (!inchar(&in, sep))
+			return false;
+	}
+	return ineof(&in);
+}
+
+/* What the days did before, one library call per number */
+static bool
+scanstrtoumax(const char * const buf,
+              const size_t len,
+              const char sep,
+              uintmax_t * const sum)
+{
+	const char *it = buf;
+	char *end;
+	*sum = 0;
+	while (it < buf + len) {
+		errno = 0;
+		*sum += strtoumax(it, &end, 10);
+		if (errno != 0 || end == it || *end != sep)
+			return false;
+		it = end + 1;
+	}
+	return true;
+}
+
+static double
+best(bool (*scan)(const char *, size_t, char, uintmax_t *),
+     const char * const buf,
+     const size_t len,
+     const char sep,
+     uintmax_t * const sum)
+{
+	double min = 0;
+	for (unsigned r = 0; r < RUNS; r++) {
+		const double begin = now();
+		if (!scan(buf, len, sep, sum))
+			return -1;
+		const double t = now() - begin;
+		if (r == 0 || t < min)
+			min = t;
+	}
+	return min;
+}
+
+int
+main(int argc, char *argv[])
+{
+	size_t n = 1000000;
+	if (argc > 2 || (argc == 2 && (n = strtoul(argv[1], NULL, 10)) == 0)) {
+		fprintf(stderr, "usage: %s [numbers]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (n > (SIZE_MAX - 1) / 20) {
+		fputs("Too many numbers\n", stderr);
+		return EXIT_FAILURE;
+	}
+	char * const buf = malloc(20 * n + 1);
+	if (buf == NULL) {
+		perror("Could not allocate the numbers");
+		return EXIT_FAILURE;
+	}
+	puts("Input\tScanner\tM numbers/s\tMB/s");
+	for (size_t c = 0; c < sizeof(cases) / sizeof(Case); c++) {
+		const size_t len = fill(buf, n, cases + c);
+		uintmax_t fast, slow;
+		const double tfast = best(scancursor,
+		                          buf,
+		                          len,
+		                          cases[c].sep,
+		                          &fast);
+		const double tslow = best(scanstrtoumax,
+		                          buf,
+		                          len,
+		                          cases[c].sep,
+		                          &slow);
+		if (tfast < 0 || tslow < 0 || fast != slow) {
+			fprintf(stderr, "Scanners disagree on %s\n", cases[c].name);
+			free(buf);
+			return EXIT_FAILURE;
+		}
+		printf("%s\tinuint\t%.1lf\t%.1lf\n",
+		       cases[c].name,
+		       1e-6 * (double) n / tfast,
+		       1e-6 * (double) len / tfast);
+		printf("%s\tstrtoumax\t%.1lf\t%.1lf\n",
+		       cases[c].name,
+		       1e-6 * (double) n / tslow,
+		       1e-6 * (double) len / tslow);
+	}
+	free(buf);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,192 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+
+/* Bumped whenever the header changes */
+#define SNAPSHOT_FORMAT 1
+
+/* Contents start past the header, aligned for any type a day may save */
+#define SNAPSHOT_OFFSET 64
+
+/* Room for "/NN-", 16 hexadecimal digits, ".snap" and ".NNNNNNNNNN" */
+#define SNAPSHOT_NAME 40
+
+static const char magic[8] = "AOCSNAP";
+
+/*
+ * Days save their structures as they lie in memory, so a snapshot is only
+ * read back by a build which lays them out the same way
+ */
+typedef struct {
+	char magic[8];
+	uint32_t format, order, sizes, day, version;
+	uint64_t hash, len, size;
+} Header;
+
+static uint32_t
+sizes(void)
+{
+	return sizeof(size_t) | sizeof(uintmax_t) << 8 | sizeof(int) << 16
+	       | sizeof(bool) << 24;
+}
+
+static Header
+header(const SnapshotKey key, const size_t size)
+{
+	Header h = {
+		.format = SNAPSHOT_FORMAT,
+		.order = 0x01020304,
+		.sizes = sizes(),
+		.day = key.day,
+		.version = key.version,
+		.hash = key.hash,
+		.len = key.len,
+		.size = size
+	};
+	memcpy(h.magic, magic, sizeof(magic));
+	return h;
+}
+
+static void
+snappath(char * const path, const char * const dir, const SnapshotKey key)
+{
+	sprintf(path,
+	        "%s/%02u-%016jx.snap",
+	        dir,
+	        key.day,
+	        (uintmax_t) key.hash);
+}
+
+/* FNV-1a, which is plenty to tell apart the few inputs of a day */
+uint64_t
+snaphash(const char * const buf, const size_t len)
+{
+	uint64_t h = UINT64_C(0xcbf29ce484222325);
+	for (size_t i = 0; i < len; i++) {
+		h ^= (unsigned char) buf[i];
+		h *= UINT64_C(0x100000001b3);
+	}
+	return h;
+}
+
+const void *
+snapmap(Snapshot * const s,
+        const char * const dir,
+        const SnapshotKey key,
+        size_t * const size)
+{
+	char path[strlen(dir) + SNAPSHOT_NAME];
+	snappath(path, dir, key);
+	s->map = NULL;
+	const int fd = open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0 || st.st_size < SNAPSHOT_OFFSET
+	    || (uintmax_t) st.st_size > SIZE_MAX) {
+		close(fd);
+		return NULL;
+	}
+	void * const map = mmap(NULL,
+	                        st.st_size,
+	                        PROT_READ,
+	                        MAP_PRIVATE,
+	                        fd,
+	                        0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+	const Header want = header(key, st.st_size - SNAPSHOT_OFFSET);
+	const Header * const got = map;
+	if (memcmp(got->magic, want.magic, sizeof(magic)) != 0
+	    || got->format != want.format || got->order != want.order
+	    || got->sizes != want.sizes || got->day != want.day
+	    || got->version != want.version || got->hash != want.hash
+	    || got->len != want.len || got->size != want.size) {
+		munmap(map, st.st_size);
+		return NULL;
+	}
+	s->map = map;
+	s->maplen = st.st_size;
+	*size = got->size;
+	return (const char *) map + SNAPSHOT_OFFSET;
+}
+
+void
+snapunmap(Snapshot * const s)
+{
+	if (s->map != NULL)
+		munmap(s->map, s->maplen);
+	s->map = NULL;
+}
+
+static bool
+writeall(const int fd, const void * const buf, const size_t len)
+{
+	const char *p = buf;
+	for (size_t left = len; left > 0;) {
+		const ssize_t n = write(fd, p, left);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return false;
+		p += n;
+		left -= n;
+	}
+	return true;
+}
+
+/*
+ * Writes a file of its own, then renames it over the snapshot, so that days
+ * running at once never read half of one
+ */
+bool
+snapwrite(const char * const dir,
+          const SnapshotKey key,
+          const void * const buf,
+          const size_t size)
+{
+	char path[strlen(dir) + SNAPSHOT_NAME];
+	char tmp[strlen(dir) + SNAPSHOT_NAME];
+	snappath(path, dir, key);
+	sprintf(tmp, "%s.%ld", path, (long) getpid());
+	if (mkdir(dir, 0777) < 0 && errno != EEXIST) {
+		perror(dir);
+		return false;
+	}
+	const int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+		perror(tmp);
+		return false;
+	}
+	char head[SNAPSHOT_OFFSET] = { 0 };
+	const Header h = header(key, size);
+	memcpy(head, &h, sizeof(h));
+	const bool ok = writeall(fd, head, sizeof(head))
+	                && writeall(fd, buf, size);
+	if (close(fd) < 0 || !ok || rename(tmp, path) < 0) {
+		perror(tmp);
+		unlink(tmp);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,35 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/* Requires <stdbool.h>, <stddef.h> and <stdint.h> */
+
+/* What a snapshot was taken of: a version of a day's parse of an input */
+typedef struct {
+	unsigned day, version;
+	uint64_t hash;
+	size_t len;
+} SnapshotKey;
+
+/* A snapshot mapped into memory, if `map` is not a null pointer */
+typedef struct {
+	void *map;
+	size_t maplen;
+} Snapshot;
+
+/* Hashes puzzle input into the key of its snapshots */
+uint64_t snaphash(const char *, size_t);
+
+/*
+ * Maps the snapshot saved in `dir` under `key` and returns its contents,
+ * setting `size`, or returns NULL if there is none that this build can read
+ */
+const void *snapmap(Snapshot *, const char *dir, SnapshotKey, size_t *size);
+void snapunmap(Snapshot *);
+
+/* Saves `size` bytes under `key` in `dir`, which is created if need be */
+bool snapwrite(const char *dir, SnapshotKey, const void *, size_t size);
@@ -0,0 +1,250 @@
+/*
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "advent.h"
+#include "arena.h"
+#include "input.h"
+#include "days.h"
+
+/*
+ * Buffers the reader fills ahead of the fold, and their size. Pipes hand over
+ * far less than a buffer per read, which is passed on as soon as it comes.
+ */
+#define STREAM_BUFFERS 4
+#define STREAM_BUFFER (1 << 20)
+
+/*
+ * Buffers go round in order: the reader fills buffer `filled` modulo their
+ * number while the fold is not `STREAM_BUFFERS` behind, and the fold takes
+ * buffer `folded` once the reader is past it
+ */
+typedef struct {
+	int fd;
+	char *buf;
+	size_t len[STREAM_BUFFERS];
+	size_t filled, folded;
+	bool eof;
+	int err;
+	pthread_mutex_t lock;
+	pthread_cond_t moved;
+} Feed;
+
+/* Bytes of the records not yet ended, and the fold they go to */
+typedef struct {
+	const char *sep;
+	size_t seplen;
+	bool (*fold)(void *, Input *);
+	void *state;
+	bool failed;
+	char *buf;
+	size_t len, cap;
+} Carry;
+
+static void *
+readinput(void * const arg)
+{
+	Feed * const f = arg;
+	for (bool more = true; more;) {
+		pthread_mutex_lock(&f->lock);
+		while (f->filled - f->folded == STREAM_BUFFERS)
+			pthread_cond_wait(&f->moved, &f->lock);
+		const size_t slot = f->filled % STREAM_BUFFERS;
+		pthread_mutex_unlock(&f->lock);
+		char * const buf = f->buf + slot * STREAM_BUFFER;
+		ssize_t n;
+		do
+			n = read(f->fd, buf, STREAM_BUFFER);
+		while (n < 0 && errno == EINTR);
+		pthread_mutex_lock(&f->lock);
+		if (n > 0) {
+			f->len[slot] = n;
+			f->filled++;
+		} else {
+			f->eof = true;
+			f->err = n < 0? errno : 0;
+			more = false;
+		}
+		pthread_cond_signal(&f->moved);
+		pthread_mutex_unlock(&f->lock);
+	}
+	return NULL;
+}
+
+static void
+foldspan(Carry * const c, const char * const p, const size_t len)
+{
+	Input in = { .p = p, .end = p + len };
+	if (!c->failed && len > 0 && !c->fold(c->state, &in))
+		c->failed = true;
+}
+
+static bool
+append(Carry * const c, const char * const p, const size_t len)
+{
+	/* The buffer is still null until a first byte is carried */
+	if (len == 0)
+		return true;
+	if (len > c->cap - c->len) {
+		size_t cap = c->cap > 0? c->cap : STREAM_BUFFER;
+		while (len > cap - c->len)
+			cap *= 2;
+		char * const buf = realloc(c->buf, cap);
+		if (buf == NULL) {
+			perror("Could not hold a record of the input");
+			return false;
+		}
+		c->buf = buf;
+		c->cap = cap;
+	}
+	memcpy(c->buf + c->len, p, len);
+	c->len += len;
+	return true;
+}
+
+static bool
+sepat(const Carry * const c, const char * const p)
+{
+	return memcmp(p, c->sep, c->seplen) == 0;
+}
+
+/*
+ * Where the first separator ends in the `len` bytes at `p`, counting one
+ * which begins at the end of the carry, or 0 if none does
+ */
+static size_t
+firstend(const Carry * const c, const char * const p, const size_t len)
+{
+	for (size_t k = c->seplen - 1; k > 0; k--) {
+		if (k <= c->len && c->seplen - k <= len
+		    && memcmp(c->buf + c->len - k, c->sep, k) == 0
+		    && memcmp(p, c->sep + k, c->seplen - k) == 0)
+			return c->seplen - k;
+	}
+	for (size_t i = 0; i + c->seplen <= len; i++) {
+		if (sepat(c, p + i))
+			return i + c->seplen;
+	}
+	return 0;
+}
+
+/* Where the last separator ends in the `len` bytes at `p`, or 0 */
+static size_t
+lastend(const Carry * const c, const char * const p, const size_t len)
+{
+	for (size_t i = len; i >= c->seplen; i--) {
+		if (sepat(c, p + i - c->seplen))
+			return i;
+	}
+	return 0;
+}
+
+/*
+ * Folds the records which `len` more bytes end, the first one from the carry
+ * if any, and carries the rest
+ */
+static bool
+consume(Carry * const c, const char * const p, const size_t len)
+{
+	size_t first = 0;
+	if (c->len > 0) {
+		first = firstend(c, p, len);
+		if (first == 0)
+			return append(c, p, len);
+		if (!append(c, p, first))
+			return false;
+		foldspan(c, c->buf, c->len);
+		c->len = 0;
+	}
+	const size_t last = first + lastend(c, p + first, len - first);
+	foldspan(c, p + first, last - first);
+	return append(c, p + last, len - last);
+}
+
+bool
+streamfeed(const int fd,
+           const char * const sep,
+           bool (* const fold)(void *, Input *),
+           void * const state)
+{
+	Feed f = {
+		.fd = fd,
+		.len = { 0 },
+		.filled = 0,
+		.folded = 0,
+		.eof = false,
+		.err = 0
+	};
+	Carry c = {
+		.sep = sep,
+		.seplen = strlen(sep),
+		.fold = fold,
+		.state = state,
+		.failed = false,
+		.buf = NULL,
+		.len = 0,
+		.cap = 0
+	};
+	f.buf = malloc(STREAM_BUFFERS * STREAM_BUFFER);
+	if (f.buf == NULL) {
+		perror("Could not allocate input buffers");
+		return false;
+	}
+	pthread_mutex_init(&f.lock, NULL);
+	pthread_cond_init(&f.moved, NULL);
+	pthread_t reader;
+	const int err = pthread_create(&reader, NULL, readinput, &f);
+	if (err != 0) {
+		fprintf(stderr, "Could not start reading: %s\n", strerror(err));
+		pthread_cond_destroy(&f.moved);
+		pthread_mutex_destroy(&f.lock);
+		free(f.buf);
+		return false;
+	}
+	/* After a failure, input is still read to its end like it would be */
+	bool ok = true;
+	for (;;) {
+		pthread_mutex_lock(&f.lock);
+		while (f.filled == f.folded && !f.eof)
+			pthread_cond_wait(&f.moved, &f.lock);
+		const bool done = f.filled == f.folded;
+		const size_t slot = f.folded % STREAM_BUFFERS;
+		const size_t len = f.len[slot];
+		pthread_mutex_unlock(&f.lock);
+		if (done)
+			break;
+		if (ok && !c.failed)
+			ok = consume(&c, f.buf + slot * STREAM_BUFFER, len);
+		pthread_mutex_lock(&f.lock);
+		f.folded++;
+		pthread_cond_signal(&f.moved);
+		pthread_mutex_unlock(&f.lock);
+	}
+	pthread_join(reader, NULL);
+	if (f.err != 0) {
+		fprintf(stderr, "Could not read input: %s\n", strerror(f.err));
+		ok = false;
+	}
+	if (ok)
+		foldspan(&c, c.buf, c.len);
+	pthread_cond_destroy(&f.moved);
+	pthread_mutex_destroy(&f.lock);
+	free(c.buf);
+	free(f.buf);
+	return ok && !c.failed;
+}